@@ -21,8 +21,11 @@
 
 #include "actracktive/ActracktiveApp.h"
 #include "actracktive/AppInfo.h"
+#include "actracktive/processing/BatchProcessor.h"
+#include "actracktive/processing/GeometryFusion.h"
 #include "actracktive/processing/GraphBuilder.h"
 #include "actracktive/processing/GraphRecorder.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/format.hpp>
 #include <log4cplus/logger.h>
 
@@ -84,6 +87,22 @@ void ActracktiveApp::start()
 	processingThread = boost::thread(boost::bind(&ActracktiveApp::run, this));
 }
 
+void ActracktiveApp::startBatch()
+{
+	if (running) {
+		return;
+	}
+
+	if (graph == NULL) {
+		LOG4CPLUS_ERROR(logger, "Cannot start batch processing, because no graph has been loaded!");
+		return;
+	}
+
+	running = true;
+
+	processingThread = boost::thread(boost::bind(&ActracktiveApp::runBatch, this));
+}
+
 void ActracktiveApp::stop()
 {
 	if (!running) {
@@ -124,11 +143,37 @@ void ActracktiveApp::run()
 {
 	graph->start();
 
-	while (running) {
-		graph->step();
+	{
+		GeometryFusion fusion(*graph);
+
+		while (running) {
+			fusion.update();
+			graph->step();
+		}
+	}
+
+	graph->stop();
+}
+
+void ActracktiveApp::runBatch()
+{
+	graph->start();
+
+	try {
+		boost::posix_time::ptime startTime = boost::posix_time::microsec_clock::local_time();
+
+		BatchProcessor processor(*graph);
+		unsigned long frames = processor.run(running);
+
+		double seconds = (boost::posix_time::microsec_clock::local_time() - startTime).total_milliseconds() / 1000.0;
+		LOG4CPLUS_INFO(logger, boost::format("Batch processing finished after %i frames in %.1f s") % frames % seconds);
+	} catch (const BatchError& e) {
+		LOG4CPLUS_ERROR(logger, boost::format("Batch processing failed! (%s)") % e.what());
 	}
 
 	graph->stop();
+
+	running = false;
 }
 
 const boost::filesystem::path& ActracktiveApp::getGraphConfigFile() const
@@ -40,6 +40,7 @@ public:
 	const std::string& getName() const;
 
 	void start();
+	void startBatch();
 	void stop();
 	bool isRunning();
 	void waitForStop();
@@ -60,6 +61,7 @@ private:
 	ActracktiveApp(const boost::filesystem::path& graphConfigFile);
 	void setUpProcessingGraph();
 	void run();
+	void runBatch();
 
 };
 
@@ -29,16 +29,18 @@
 
 static const std::string CONFIG_DEFAULT = "config.xml";
 static const bool HEADLESS_DEFAULT = false;
+static const bool BATCH_DEFAULT = false;
 static const std::string LOGGING_CONFIG_DEFAULT = "log4cplus.properties";
 static const std::string GRAPH_CONFIG_DEFAULT = "processing-graph.xml";
 static const int TIMER_OUTPUT_DEFAULT = 5;
 
 static const struct option OPTIONS[] = { { "help", no_argument, NULL, 'i' }, { "config", required_argument, NULL, 'c' }, { "logging-config",
 	required_argument, NULL, 'l' }, { "graph-config", required_argument, NULL, 'g' }, { "headless", no_argument, NULL, 'h' }, {
-	"no-headless", no_argument, NULL, 'H' }, { "timer-output", required_argument, NULL, 't' }, { NULL, no_argument, NULL, 0 } };
+	"no-headless", no_argument, NULL, 'H' }, { "batch", no_argument, NULL, 'b' }, { "timer-output", required_argument, NULL, 't' }, {
+	NULL, no_argument, NULL, 0 } };
 
 Options::Options(int argc, char* argv[])
-	: helpMode(false), config(filesystem::toData(CONFIG_DEFAULT)), headless(HEADLESS_DEFAULT),
+	: helpMode(false), config(filesystem::toData(CONFIG_DEFAULT)), headless(HEADLESS_DEFAULT), batch(BATCH_DEFAULT),
 		loggingConfig(filesystem::relative(config, LOGGING_CONFIG_DEFAULT)),
 		graphConfig(filesystem::relative(config, GRAPH_CONFIG_DEFAULT)), timerOutput(TIMER_OUTPUT_DEFAULT), errorMessages(),
 		numberOfArguments(argc), arguments(argv)
@@ -84,6 +86,10 @@ void Options::printHelp(std::ostream& os)
 	os << " --no-headless" << std::endl;
 	os << "  -H                     Start _with_ GUI, even if disabled in configuration" << std::endl;
 	os << std::endl;
+	os << " --batch" << std::endl;
+	os << "  -b                     Process the video of the graph's playback source as fast" << std::endl;
+	os << "                         as possible and exit afterwards (implies --headless)" << std::endl;
+	os << std::endl;
 	os << " --timer-output <n>" << std::endl;
 	os << "  -t <n>                 Print performance timer output every <n> seconds; n = 0" << std::endl;
 	os << "                         disables output (only used in headless mode)" << std::endl;
@@ -107,6 +113,7 @@ void Options::parseOptions()
 			xml_parser::read_xml(config.string(), properties);
 
 			headless = properties.get<bool>("config.headless", HEADLESS_DEFAULT);
+			batch = properties.get<bool>("config.batch", BATCH_DEFAULT);
 			loggingConfig = filesystem::relative(config, properties.get<std::string>("config.logging-config", LOGGING_CONFIG_DEFAULT));
 			graphConfig = filesystem::relative(config, properties.get<std::string>("config.graph-config", GRAPH_CONFIG_DEFAULT));
 			timerOutput = properties.get<int>("config.timer-output", TIMER_OUTPUT_DEFAULT);
@@ -122,6 +129,10 @@ void Options::parseOptions()
 
 		readGraphConfigFileArgument();
 
+		if (batch) {
+			headless = true;
+		}
+
 		loggingConfig = filesystem::coalesceFiles(loggingConfig, filesystem::toResource(LOGGING_CONFIG_DEFAULT));
 	}
 }
@@ -182,6 +193,10 @@ void Options::readAllOptions()
 				headless = false;
 				break;
 
+			case 'b':
+				batch = true;
+				break;
+
 			case 'l':
 				loggingConfig = boost::filesystem::path(boost::lexical_cast<std::string>(optarg));
 				break;
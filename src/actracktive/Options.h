@@ -36,6 +36,7 @@
  * <?xml version="1.0" ?>
  * <config>
  * 	<headless>false</headless>
+ * 	<batch>false</batch>
  * 	<logging-config>log4cplus.properties</logging-config>
  * 	<graph-config>processing-graph.xml</graph-config>
  * 	<timer-output>5</timer-output>
@@ -50,6 +51,7 @@ public:
 	boost::filesystem::path config;
 
 	bool headless;
+	bool batch;
 	boost::filesystem::path loggingConfig;
 	boost::filesystem::path graphConfig;
 	int timerOutput;
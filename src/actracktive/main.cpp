@@ -106,7 +106,13 @@ int main(int argc, char* argv[])
 	LOG4CPLUS_INFO(logger, "Initialization complete!");
 
 	ActracktiveApp& app = ActracktiveApp::getInstance();
-	if (opts.headless) {
+	if (opts.batch) {
+		DaemonFrontend daemon;
+		daemon.setTimerOutput(opts.timerOutput);
+
+		app.startBatch();
+		app.waitForStop();
+	} else if (opts.headless) {
 		DaemonFrontend daemon;
 		daemon.setTimerOutput(opts.timerOutput);
 
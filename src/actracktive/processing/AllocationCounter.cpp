@@ -0,0 +1,393 @@
+/*
+ * AllocationCounter.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+#include <pthread.h>
+
+namespace
+{
+
+	const unsigned int MAX_SLOTS = 1024;
+	const unsigned int NO_SLOT = MAX_SLOTS;
+
+	/*
+	 * The counts live in a statically allocated table rather than in the
+	 * counters themselves, so that memory outliving its counter can still be
+	 * freed safely: the generation of a slot is increased whenever a counter
+	 * releases it, which invalidates all allocations still referring to it.
+	 */
+	struct Slot
+	{
+		volatile int used;
+		volatile unsigned int generation;
+		volatile unsigned long allocations;
+		volatile unsigned long bytes;
+		volatile long liveBytes;
+		volatile long peakLiveBytes;
+	};
+
+	Slot slots[MAX_SLOTS];
+	volatile int slotsLock = 0;
+
+	pthread_once_t currentSlotKeyOnce = PTHREAD_ONCE_INIT;
+	pthread_key_t currentSlotKey;
+
+	void createCurrentSlotKey()
+	{
+		pthread_key_create(&currentSlotKey, NULL);
+	}
+
+	unsigned int getCurrentSlot()
+	{
+		pthread_once(&currentSlotKeyOnce, createCurrentSlotKey);
+
+		// The key stores the slot index plus one, so that the initial value
+		// (NULL) of each thread refers to no slot.
+		std::size_t value = reinterpret_cast<std::size_t>(pthread_getspecific(currentSlotKey));
+		return (value > 0 && value <= MAX_SLOTS) ? (unsigned int) (value - 1) : NO_SLOT;
+	}
+
+	void setCurrentSlot(unsigned int slot)
+	{
+		pthread_once(&currentSlotKeyOnce, createCurrentSlotKey);
+
+		std::size_t value = (slot < MAX_SLOTS) ? slot + 1 : 0;
+		pthread_setspecific(currentSlotKey, reinterpret_cast<void*>(value));
+	}
+
+	unsigned int acquireSlot()
+	{
+		while (__sync_lock_test_and_set(&slotsLock, 1)) {
+		}
+
+		unsigned int slot = 0;
+		while (slot < MAX_SLOTS && slots[slot].used) {
+			++slot;
+		}
+
+		if (slot < MAX_SLOTS) {
+			slots[slot].used = 1;
+			slots[slot].allocations = 0;
+			slots[slot].bytes = 0;
+			slots[slot].liveBytes = 0;
+			slots[slot].peakLiveBytes = 0;
+		}
+
+		__sync_lock_release(&slotsLock);
+
+		return (slot < MAX_SLOTS) ? slot : NO_SLOT;
+	}
+
+	void releaseSlot(unsigned int slot)
+	{
+		if (slot >= MAX_SLOTS) {
+			return;
+		}
+
+		while (__sync_lock_test_and_set(&slotsLock, 1)) {
+		}
+
+		__sync_fetch_and_add(&slots[slot].generation, 1);
+		slots[slot].used = 0;
+
+		__sync_lock_release(&slotsLock);
+	}
+
+}
+
+#ifdef ACTRACKTIVE_TRACK_ALLOCATIONS
+
+namespace
+{
+
+	/*
+	 * Each tracked allocation is prefixed with a header which records its
+	 * size and owning slot. The header is padded to 16 bytes to keep the
+	 * alignment guarantees of malloc.
+	 */
+	struct AllocationHeader
+	{
+		std::size_t size;
+		unsigned int slot;
+		unsigned int generation;
+	};
+
+	const std::size_t HEADER_SIZE = 16;
+
+	void* allocate(std::size_t size)
+	{
+		unsigned char* memory = static_cast<unsigned char*>(std::malloc(size + HEADER_SIZE));
+		if (memory == NULL) {
+			return NULL;
+		}
+
+		AllocationHeader* header = reinterpret_cast<AllocationHeader*>(memory);
+		header->size = size;
+		header->slot = getCurrentSlot();
+		header->generation = 0;
+
+		if (header->slot != NO_SLOT) {
+			Slot& slot = slots[header->slot];
+			header->generation = slot.generation;
+
+			__sync_fetch_and_add(&slot.allocations, 1);
+			__sync_fetch_and_add(&slot.bytes, size);
+			long liveBytes = __sync_add_and_fetch(&slot.liveBytes, (long) size);
+
+			long peakLiveBytes = slot.peakLiveBytes;
+			while (liveBytes > peakLiveBytes) {
+				long previous = __sync_val_compare_and_swap(&slot.peakLiveBytes, peakLiveBytes, liveBytes);
+				if (previous == peakLiveBytes) {
+					break;
+				}
+				peakLiveBytes = previous;
+			}
+		}
+
+		return memory + HEADER_SIZE;
+	}
+
+	void* allocateOrThrow(std::size_t size)
+	{
+		for (;;) {
+			void* memory = allocate(size);
+			if (memory != NULL) {
+				return memory;
+			}
+
+			std::new_handler handler = std::set_new_handler(NULL);
+			std::set_new_handler(handler);
+
+			if (handler == NULL) {
+				throw std::bad_alloc();
+			}
+
+			handler();
+		}
+	}
+
+	void deallocate(void* memory)
+	{
+		if (memory == NULL) {
+			return;
+		}
+
+		unsigned char* block = static_cast<unsigned char*>(memory) - HEADER_SIZE;
+		const AllocationHeader* header = reinterpret_cast<const AllocationHeader*>(block);
+
+		if (header->slot != NO_SLOT && slots[header->slot].generation == header->generation) {
+			__sync_fetch_and_sub(&slots[header->slot].liveBytes, (long) header->size);
+		}
+
+		std::free(block);
+	}
+
+}
+
+void* operator new(std::size_t size) throw (std::bad_alloc)
+{
+	return allocateOrThrow(size);
+}
+
+void* operator new[](std::size_t size) throw (std::bad_alloc)
+{
+	return allocateOrThrow(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) throw ()
+{
+	try {
+		return allocateOrThrow(size);
+	} catch (...) {
+		return NULL;
+	}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) throw ()
+{
+	try {
+		return allocateOrThrow(size);
+	} catch (...) {
+		return NULL;
+	}
+}
+
+void operator delete(void* memory) throw ()
+{
+	deallocate(memory);
+}
+
+void operator delete[](void* memory) throw ()
+{
+	deallocate(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) throw ()
+{
+	deallocate(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) throw ()
+{
+	deallocate(memory);
+}
+
+bool AllocationCounter::isEnabled()
+{
+	return true;
+}
+
+#else
+
+bool AllocationCounter::isEnabled()
+{
+	return false;
+}
+
+#endif
+
+const AllocationCounter::Token AllocationCounter::NONE = NO_SLOT;
+
+AllocationCounter::Scope::Scope(const AllocationCounter& counter)
+	: previous(counter.activate())
+{
+}
+
+AllocationCounter::Scope::Scope(Token token)
+	: previous(getCurrentSlot())
+{
+	setCurrentSlot(token);
+}
+
+AllocationCounter::Scope::~Scope()
+{
+	setCurrentSlot(previous);
+}
+
+AllocationCounter::Token AllocationCounter::getActive()
+{
+	return getCurrentSlot();
+}
+
+AllocationCounter::AllocationCounter()
+	: slot(NO_SLOT), lastAllocations(0), lastBytes(0), executionCount(0), nextExecution(0),
+		averageAllocations(0), averageBytes(0)
+{
+	if (isEnabled()) {
+		slot = acquireSlot();
+	}
+
+	reset();
+}
+
+AllocationCounter::~AllocationCounter()
+{
+	releaseSlot(slot);
+}
+
+/*
+ * The previously active slot is handed back to the caller instead of being
+ * stored in the counter, as the counter may be active on several threads.
+ */
+AllocationCounter::Token AllocationCounter::activate() const
+{
+	unsigned int previous = getCurrentSlot();
+	if (slot != NO_SLOT) {
+		setCurrentSlot(slot);
+	}
+
+	return previous;
+}
+
+void AllocationCounter::deactivate(Token previous) const
+{
+	if (slot != NO_SLOT) {
+		setCurrentSlot(previous);
+	}
+}
+
+void AllocationCounter::finishExecution()
+{
+	if (slot == NO_SLOT) {
+		return;
+	}
+
+	unsigned long allocations = slots[slot].allocations;
+	unsigned long bytes = slots[slot].bytes;
+
+	executionAllocations[nextExecution] = allocations - lastAllocations;
+	executionBytes[nextExecution] = bytes - lastBytes;
+	nextExecution = (nextExecution + 1) % EXECUTIONS_WINDOW;
+	if (executionCount < EXECUTIONS_WINDOW) {
+		++executionCount;
+	}
+
+	lastAllocations = allocations;
+	lastBytes = bytes;
+
+	unsigned long allocationsSum = 0;
+	unsigned long bytesSum = 0;
+	for (unsigned int i = 0; i < executionCount; ++i) {
+		allocationsSum += executionAllocations[i];
+		bytesSum += executionBytes[i];
+	}
+
+	averageAllocations = double(allocationsSum) / executionCount;
+	averageBytes = double(bytesSum) / executionCount;
+}
+
+void AllocationCounter::reset()
+{
+	executionCount = 0;
+	nextExecution = 0;
+	averageAllocations = 0;
+	averageBytes = 0;
+
+	if (slot == NO_SLOT) {
+		return;
+	}
+
+	lastAllocations = slots[slot].allocations;
+	lastBytes = slots[slot].bytes;
+	slots[slot].peakLiveBytes = slots[slot].liveBytes;
+}
+
+double AllocationCounter::getAverageAllocations() const
+{
+	return averageAllocations;
+}
+
+double AllocationCounter::getAverageBytes() const
+{
+	return averageBytes;
+}
+
+std::size_t AllocationCounter::getLiveBytes() const
+{
+	return (slot != NO_SLOT && slots[slot].liveBytes > 0) ? slots[slot].liveBytes : 0;
+}
+
+std::size_t AllocationCounter::getPeakLiveBytes() const
+{
+	return (slot != NO_SLOT && slots[slot].peakLiveBytes > 0) ? slots[slot].peakLiveBytes : 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * AllocationCounter.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ALLOCATIONCOUNTER_H_
+#define ALLOCATIONCOUNTER_H_
+
+#include <cstddef>
+#include <boost/noncopyable.hpp>
+
+/**
+ * Counts the heap allocations done by a thread while the counter is active on
+ * it. Counters can be nested: deactivating a counter re-activates the one
+ * which was active before on that thread. The same counter may be active on
+ * several threads at once. Memory is attributed to the counter which was
+ * active when it was allocated, regardless of which thread frees it.
+ *
+ * Counting is only available if the application has been compiled with
+ * ACTRACKTIVE_TRACK_ALLOCATIONS defined, otherwise all counters stay zero.
+ */
+class AllocationCounter: public boost::noncopyable
+{
+public:
+	/**
+	 * Identifies the counter active on a thread (if any).
+	 */
+	typedef unsigned int Token;
+
+	static const Token NONE;
+
+	/**
+	 * Makes a counter (or the counter identified by a token) active on the
+	 * calling thread for the lifetime of the scope.
+	 */
+	class Scope: public boost::noncopyable
+	{
+	public:
+		Scope(const AllocationCounter& counter);
+		Scope(Token token);
+		~Scope();
+
+	private:
+		Token previous;
+
+	};
+
+	static bool isEnabled();
+
+	/**
+	 * Returns the token of the counter active on the calling thread, e.g. to
+	 * continue counting for it on another thread.
+	 */
+	static Token getActive();
+
+	AllocationCounter();
+	~AllocationCounter();
+
+	/**
+	 * Activates the counter on the calling thread. Returns the token of the
+	 * previously active counter, which has to be passed to deactivate().
+	 */
+	Token activate() const;
+	void deactivate(Token previous) const;
+
+	void finishExecution();
+	void reset();
+
+	double getAverageAllocations() const;
+	double getAverageBytes() const;
+	std::size_t getLiveBytes() const;
+	std::size_t getPeakLiveBytes() const;
+
+private:
+	static const unsigned int EXECUTIONS_WINDOW = 60;
+
+	unsigned int slot;
+
+	unsigned long lastAllocations;
+	unsigned long lastBytes;
+
+	unsigned long executionAllocations[EXECUTIONS_WINDOW];
+	unsigned long executionBytes[EXECUTIONS_WINDOW];
+	unsigned int executionCount;
+	unsigned int nextExecution;
+
+	double averageAllocations;
+	double averageBytes;
+
+};
+
+#endif
@@ -0,0 +1,451 @@
+/*
+ * BatchProcessor.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/BatchProcessor.h"
+#include "actracktive/processing/GeometryFusion.h"
+#include "actracktive/processing/NodeFactory.h"
+#include "actracktive/processing/nodes/TUIOSender.h"
+#include "actracktive/processing/nodes/sources/PlaybackSource.h"
+#include "actracktive/processing/nodes/sources/filter/ImageFilter.h"
+#include "tinyxml.h"
+#include <algorithm>
+#include <set>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <log4cplus/logger.h>
+
+static log4cplus::Logger logger = log4cplus::Logger::getInstance("BatchProcessor");
+
+/**
+ * Stands in for the playback source in the copies of the stateless prefix,
+ * delivering the frame read ahead by the batch processor.
+ */
+class FrameInjector: public ImageSource
+{
+public:
+	FrameInjector(const std::string& id)
+		: ImageSource(id, "Batch Input"), frame()
+	{
+	}
+
+	void setFrame(const cv::Mat& frame)
+	{
+		Lock lock(this);
+
+		this->frame = frame;
+	}
+
+protected:
+	virtual void fetch(cv::Mat& destination)
+	{
+		destination = frame;
+	}
+
+private:
+	cv::Mat frame;
+
+};
+
+BatchProcessor::BatchProcessor(ProcessingGraph& graph, WorkerPool& pool) throw (BatchError)
+	: graph(graph), pool(pool), root(NULL), prefix(), frontier(), steppedNodes(), reader(NULL), workers(), idleWorkers(), mutex(),
+		workerAvailable(), frameDone()
+{
+	analyseGraph();
+
+	if (frontier.empty()) {
+		LOG4CPLUS_WARN(logger, "No stateless image filters follow the playback source, processing frames sequentially");
+	} else {
+		try {
+			createWorkers();
+		} catch (...) {
+			deleteWorkers();
+			throw;
+		}
+
+		LOG4CPLUS_INFO(logger,
+			boost::format("Processing %i stateless nodes concurrently using %i workers, %i nodes sequentially") % prefix.size()
+				% workers.size() % steppedNodes.size());
+	}
+
+	const std::list<Node*>& nodes = graph.getNodes();
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+		TUIOSender* sender = dynamic_cast<TUIOSender*>(*node);
+		if (sender != NULL && !sender->isCapturing()) {
+			LOG4CPLUS_WARN(logger,
+				boost::format("TUIO sender '%s' has no capture file, its output is sent over the network") % sender->getId());
+		}
+	}
+}
+
+BatchProcessor::~BatchProcessor()
+{
+	deleteWorkers();
+}
+
+unsigned long BatchProcessor::run(const bool& running)
+{
+	unsigned long frameCount = 0;
+
+	if (frontier.empty()) {
+		GeometryFusion fusion(graph);
+
+		while (running && !root->isFinished()) {
+			fusion.update();
+			graph.step();
+			++frameCount;
+		}
+
+		return frameCount;
+	}
+
+	// Frames are read ahead and processed concurrently, but always completed
+	// in order. Limiting the number of pending frames keeps memory bounded if
+	// the sequential part of the graph is the bottleneck.
+	const std::size_t maxPendingFrames = 2 * workers.size();
+
+	WorkerPool::Group group(pool);
+	std::deque<Frame*> pendingFrames;
+	bool endOfInput = false;
+
+	while (running) {
+		while (!endOfInput && pendingFrames.size() < maxPendingFrames) {
+			Frame* frame = new Frame();
+			frame->done = false;
+
+			if (!readFrame(*frame)) {
+				delete frame;
+				endOfInput = true;
+				break;
+			}
+
+			pendingFrames.push_back(frame);
+			group.run(boost::bind(&BatchProcessor::processFrame, this, frame));
+		}
+
+		if (pendingFrames.empty()) {
+			break;
+		}
+
+		Frame* frame = pendingFrames.front();
+		{
+			boost::unique_lock<boost::mutex> lock(mutex);
+			while (!frame->done) {
+				frameDone.wait(lock);
+			}
+		}
+
+		finishFrame(*frame);
+		++frameCount;
+
+		pendingFrames.pop_front();
+		delete frame;
+	}
+
+	group.wait();
+
+	for (std::deque<Frame*>::iterator frame = pendingFrames.begin(); frame != pendingFrames.end(); ++frame) {
+		delete *frame;
+	}
+
+	return frameCount;
+}
+
+void BatchProcessor::analyseGraph() throw (BatchError)
+{
+	const std::list<Node*>& nodes = graph.getNodes();
+
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+		PlaybackSource* playback = dynamic_cast<PlaybackSource*>(*node);
+		if (playback != NULL) {
+			if (root != NULL) {
+				throw BatchError("Batch processing requires a single playback source, but the graph contains several!");
+			}
+
+			root = playback;
+		}
+	}
+
+	if (root == NULL) {
+		throw BatchError("Batch processing requires a playback source, but the graph contains none!");
+	}
+
+	// The prefix consists of all stateless filters which (transitively) depend
+	// on nothing but the playback source. As the graph does not keep its
+	// nodes in topological order, it is extended until no further filter
+	// qualifies, which leaves the prefix itself in topological order.
+	std::set<Node*> inputs;
+	inputs.insert(root);
+
+	bool extended = true;
+	while (extended) {
+		extended = false;
+
+		for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+			ImageFilter* filter = dynamic_cast<ImageFilter*>(*node);
+			if (filter == NULL || inputs.count(filter) > 0 || !filter->isStateless() || filter->isRateLimited()
+				|| filter->getSource() == NULL) {
+				continue;
+			}
+
+			bool qualifies = true;
+			const Node::NodeConnections::Values& connections = filter->getConnections().getAll();
+			for (Node::NodeConnections::Values::const_iterator connection = connections.begin(); connection != connections.end();
+				++connection) {
+				Node* target = (*connection)->getNode();
+				if (target != NULL && inputs.count(target) == 0) {
+					qualifies = false;
+				}
+			}
+
+			if (qualifies) {
+				inputs.insert(filter);
+				prefix.push_back(filter);
+				extended = true;
+			}
+		}
+	}
+
+	// The frontier consists of the prefix nodes whose output is consumed by
+	// the sequential part of the graph.
+	bool rootConsumed = false;
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+		if (inputs.count(*node) > 0) {
+			continue;
+		}
+
+		const Node::NodeConnections::Values& connections = (*node)->getConnections().getAll();
+		for (Node::NodeConnections::Values::const_iterator connection = connections.begin(); connection != connections.end();
+			++connection) {
+			Node* target = (*connection)->getNode();
+			if (target == root) {
+				rootConsumed = true;
+			} else if (target != NULL && inputs.count(target) > 0) {
+				ImageFilter* filter = static_cast<ImageFilter*>(target);
+				if (std::find(frontier.begin(), frontier.end(), filter) == frontier.end()) {
+					frontier.push_back(filter);
+				}
+			}
+		}
+	}
+
+	if (frontier.empty()) {
+		prefix.clear();
+		steppedNodes = nodes;
+		return;
+	}
+
+	// The frontier nodes stay in the sequential part, delivering the injected
+	// results. The playback source only does so if it is consumed directly,
+	// reading the same frames as the batch processor in lockstep.
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+		if (*node == root) {
+			if (rootConsumed) {
+				steppedNodes.push_back(*node);
+			}
+		} else if (inputs.count(*node) == 0 || std::find(frontier.begin(), frontier.end(), *node) != frontier.end()) {
+			steppedNodes.push_back(*node);
+		}
+	}
+}
+
+void BatchProcessor::createWorkers() throw (BatchError)
+{
+	reader = static_cast<PlaybackSource*>(cloneNode(root, "batch-reader", std::map<Node*, Node*>()));
+	reader->start();
+
+	const unsigned int workerCount = pool.getThreadCount() + 1;
+	for (unsigned int i = 0; i < workerCount; ++i) {
+		Worker* worker = new Worker();
+		worker->input = new FrameInjector((boost::format("batch-%i-input") % i).str());
+		workers.push_back(worker);
+
+		std::map<Node*, Node*> replacements;
+		replacements[root] = worker->input;
+
+		for (std::list<Node*>::const_iterator node = prefix.begin(); node != prefix.end(); ++node) {
+			Node* clone = cloneNode(*node, (boost::format("batch-%i-%s") % i % (*node)->getId()).str(), replacements);
+			worker->nodes.push_back(clone);
+			replacements[*node] = clone;
+		}
+
+		for (std::vector<ImageFilter*>::const_iterator output = frontier.begin(); output != frontier.end(); ++output) {
+			worker->outputs.push_back(static_cast<ImageFilter*>(replacements[*output]));
+		}
+
+		worker->input->start();
+		for (std::list<Node*>::const_iterator node = worker->nodes.begin(); node != worker->nodes.end(); ++node) {
+			(*node)->start();
+		}
+
+		// The copies are only connected among each other, so their chains
+		// are fused once and for all
+		worker->fusion = new GeometryFusion(worker->nodes);
+
+		idleWorkers.push_back(worker);
+	}
+}
+
+Node* BatchProcessor::cloneNode(Node* node, const std::string& id, const std::map<Node*, Node*>& replacements)
+	throw (BatchError)
+{
+	Node* clone = NULL;
+	try {
+		clone = NodeFactory::getInstance().createNode(node->getType(), id, node->getName());
+	} catch (const FactoryError& e) {
+		throw BatchError((boost::format("Cannot copy node '%s': %s") % node->getId() % e.what()).str());
+	}
+
+	try {
+		TiXmlElement config("node");
+		ConfigurationContext context(&config, &graph);
+		node->save(context);
+		clone->configure(context);
+	} catch (const ConfigurationError& e) {
+		delete clone;
+		throw BatchError((boost::format("Cannot copy node '%s': %s") % node->getId() % e.what()).str());
+	}
+
+	const Node::NodeConnections::Values& connections = clone->getConnections().getAll();
+	for (Node::NodeConnections::Values::const_iterator connection = connections.begin(); connection != connections.end();
+		++connection) {
+		std::map<Node*, Node*>::const_iterator replacement = replacements.find((*connection)->getNode());
+		if (replacement != replacements.end()) {
+			(*connection)->setNode(replacement->second);
+		}
+	}
+
+	return clone;
+}
+
+void BatchProcessor::deleteWorkers()
+{
+	for (std::vector<Worker*>::iterator worker = workers.begin(); worker != workers.end(); ++worker) {
+		delete (*worker)->fusion;
+
+		std::list<Node*>& nodes = (*worker)->nodes;
+		for (std::list<Node*>::reverse_iterator node = nodes.rbegin(); node != nodes.rend(); ++node) {
+			if ((*node)->isRunning()) {
+				(*node)->stop();
+			}
+			delete *node;
+		}
+
+		if ((*worker)->input->isRunning()) {
+			(*worker)->input->stop();
+		}
+		delete (*worker)->input;
+
+		delete *worker;
+	}
+
+	workers.clear();
+	idleWorkers.clear();
+
+	if (reader != NULL) {
+		if (reader->isRunning()) {
+			reader->stop();
+		}
+		delete reader;
+		reader = NULL;
+	}
+}
+
+bool BatchProcessor::readFrame(Frame& frame)
+{
+	reader->beforeStep();
+	const cv::Mat& image = reader->get();
+
+	if (reader->isFinished()) {
+		return false;
+	}
+
+	image.copyTo(frame.input);
+	return true;
+}
+
+void BatchProcessor::processFrame(Frame* frame)
+{
+	Worker* worker = acquireWorker();
+
+	try {
+		worker->input->beforeStep();
+		worker->input->setFrame(frame->input);
+
+		for (std::list<Node*>::const_iterator node = worker->nodes.begin(); node != worker->nodes.end(); ++node) {
+			(*node)->beforeStep();
+		}
+
+		// The outputs have to be copied, as the filters reuse their buffers
+		// for the next frame.
+		frame->outputs.resize(worker->outputs.size());
+		for (std::size_t i = 0; i < worker->outputs.size(); ++i) {
+			worker->outputs[i]->get().copyTo(frame->outputs[i]);
+		}
+
+		for (std::list<Node*>::const_iterator node = worker->nodes.begin(); node != worker->nodes.end(); ++node) {
+			(*node)->afterStep();
+		}
+	} catch (const std::exception& e) {
+		LOG4CPLUS_ERROR(logger, boost::format("Processing frame failed: %s") % e.what());
+	}
+
+	releaseWorker(worker);
+
+	{
+		boost::lock_guard<boost::mutex> lock(mutex);
+		frame->done = true;
+	}
+
+	frameDone.notify_all();
+}
+
+void BatchProcessor::finishFrame(Frame& frame)
+{
+	for (std::size_t i = 0; i < frontier.size(); ++i) {
+		frontier[i]->injectFrame(i < frame.outputs.size() ? frame.outputs[i] : cv::Mat());
+	}
+
+	graph.step(steppedNodes);
+}
+
+BatchProcessor::Worker* BatchProcessor::acquireWorker()
+{
+	boost::unique_lock<boost::mutex> lock(mutex);
+
+	while (idleWorkers.empty()) {
+		workerAvailable.wait(lock);
+	}
+
+	Worker* worker = idleWorkers.back();
+	idleWorkers.pop_back();
+
+	return worker;
+}
+
+void BatchProcessor::releaseWorker(Worker* worker)
+{
+	{
+		boost::lock_guard<boost::mutex> lock(mutex);
+		idleWorkers.push_back(worker);
+	}
+
+	workerAvailable.notify_one();
+}
@@ -0,0 +1,119 @@
+/*
+ * BatchProcessor.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHPROCESSOR_H_
+#define BATCHPROCESSOR_H_
+
+#include "actracktive/processing/Node.h"
+#include "actracktive/processing/ProcessingGraph.h"
+#include "actracktive/util/WorkerPool.h"
+#include "opencv2/opencv.hpp"
+#include <deque>
+#include <list>
+#include <map>
+#include <stdexcept>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+class BatchError: public std::runtime_error
+{
+public:
+	BatchError(std::string msg = "BatchError")
+		: runtime_error(msg)
+	{
+	}
+
+};
+
+class PlaybackSource;
+class ImageFilter;
+class FrameInjector;
+class GeometryFusion;
+
+/**
+ * Processes a recording (played back by the single PlaybackSource of a
+ * started graph) as fast as possible. The stateless image filters directly
+ * following the playback form the prefix of the graph which is applied to
+ * several frames concurrently, using one copy of these filters per worker.
+ * Their results are fed in order into the remaining (stateful) nodes of the
+ * graph, which are stepped as usual.
+ */
+class BatchProcessor: private boost::noncopyable
+{
+public:
+	BatchProcessor(ProcessingGraph& graph, WorkerPool& pool = WorkerPool::getShared()) throw (BatchError);
+	~BatchProcessor();
+
+	/**
+	 * Processes all frames of the recording, or until running becomes false.
+	 * Returns the number of processed frames.
+	 */
+	unsigned long run(const bool& running);
+
+private:
+	struct Worker
+	{
+		FrameInjector* input;
+		std::list<Node*> nodes;
+		std::vector<ImageFilter*> outputs;
+		GeometryFusion* fusion;
+	};
+
+	struct Frame
+	{
+		cv::Mat input;
+		std::vector<cv::Mat> outputs;
+		bool done;
+	};
+
+	ProcessingGraph& graph;
+	WorkerPool& pool;
+
+	PlaybackSource* root;
+	std::list<Node*> prefix;
+	std::vector<ImageFilter*> frontier;
+	std::list<Node*> steppedNodes;
+
+	PlaybackSource* reader;
+	std::vector<Worker*> workers;
+	std::vector<Worker*> idleWorkers;
+
+	boost::mutex mutex;
+	boost::condition_variable workerAvailable;
+	boost::condition_variable frameDone;
+
+	void analyseGraph() throw (BatchError);
+	void createWorkers() throw (BatchError);
+	Node* cloneNode(Node* node, const std::string& id, const std::map<Node*, Node*>& replacements) throw (BatchError);
+	void deleteWorkers();
+
+	bool readFrame(Frame& frame);
+	void processFrame(Frame* frame);
+	void finishFrame(Frame& frame);
+
+	Worker* acquireWorker();
+	void releaseWorker(Worker* worker);
+
+};
+
+#endif
@@ -0,0 +1,157 @@
+/*
+ * GeometryFusion.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/GeometryFusion.h"
+#include "actracktive/processing/nodes/sources/filter/ImageFilter.h"
+#include <map>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <log4cplus/logger.h>
+
+static log4cplus::Logger logger = log4cplus::Logger::getInstance("GeometryFusion");
+
+static bool isFusible(ImageFilter* filter)
+{
+	return filter != NULL && filter->isStateless() && !filter->isRateLimited();
+}
+
+static bool isGeometric(ImageFilter* filter)
+{
+	cv::Size size;
+	cv::Mat transform;
+
+	// Only the source connection is allowed, as the filter must not depend
+	// on anything else.
+	return filter->getConnections().getAll().size() == 1 && filter->getGeometry(cv::Size(640, 480), size, transform);
+}
+
+GeometryFusion::GeometryFusion(ProcessingGraph& graph)
+	: nodes(graph.getNodes()), fusedFilters(), connectionsChanged(false)
+{
+	connect();
+	fuse();
+}
+
+GeometryFusion::GeometryFusion(const std::list<Node*>& nodes)
+	: nodes(nodes), fusedFilters(), connectionsChanged(false)
+{
+	connect();
+	fuse();
+}
+
+GeometryFusion::~GeometryFusion()
+{
+	disconnect();
+	unfuse();
+}
+
+void GeometryFusion::update()
+{
+	if (!connectionsChanged) {
+		return;
+	}
+
+	connectionsChanged = false;
+
+	unfuse();
+	fuse();
+}
+
+void GeometryFusion::connect()
+{
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+		const Node::NodeConnections::Values& connections = (*node)->getConnections().getAll();
+		for (Node::NodeConnections::Values::const_iterator connection = connections.begin(); connection != connections.end();
+			++connection) {
+			(*connection)->onChange.connect(boost::bind(&GeometryFusion::handleConnectionChange, this));
+		}
+	}
+}
+
+void GeometryFusion::disconnect()
+{
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+		const Node::NodeConnections::Values& connections = (*node)->getConnections().getAll();
+		for (Node::NodeConnections::Values::const_iterator connection = connections.begin(); connection != connections.end();
+			++connection) {
+			(*connection)->onChange.disconnect(boost::bind(&GeometryFusion::handleConnectionChange, this));
+		}
+	}
+}
+
+void GeometryFusion::handleConnectionChange()
+{
+	// Connections are changed while the nodes are locked, so the chains are
+	// only marked here and fused again by the next update
+	connectionsChanged = true;
+}
+
+void GeometryFusion::fuse()
+{
+	std::map<Node*, std::vector<Node*> > consumers;
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+		const Node::NodeConnections::Values& connections = (*node)->getConnections().getAll();
+		for (Node::NodeConnections::Values::const_iterator connection = connections.begin(); connection != connections.end();
+			++connection) {
+			Node* target = (*connection)->getNode();
+			if (target != NULL) {
+				consumers[target].push_back(*node);
+			}
+		}
+	}
+
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+		ImageFilter* head = dynamic_cast<ImageFilter*>(*node);
+		if (!isFusible(head) || !head->canApplyRemap()) {
+			continue;
+		}
+
+		std::vector<ImageFilter*> chain(1, head);
+		while (consumers[chain.back()].size() == 1) {
+			ImageFilter* next = dynamic_cast<ImageFilter*>(consumers[chain.back()].front());
+			if (!isFusible(next) || next->getSource() != chain.back() || !isGeometric(next)) {
+				break;
+			}
+
+			chain.push_back(next);
+		}
+
+		if (chain.size() > 1) {
+			ImageFilter* tail = chain.back();
+			chain.pop_back();
+
+			tail->fuse(chain);
+			fusedFilters.push_back(tail);
+
+			LOG4CPLUS_DEBUG(logger,
+				boost::format("Fused %i filters following '%s' into its remap") % chain.size() % head->getId());
+		}
+	}
+}
+
+void GeometryFusion::unfuse()
+{
+	for (std::vector<ImageFilter*>::iterator filter = fusedFilters.begin(); filter != fusedFilters.end(); ++filter) {
+		(*filter)->unfuse();
+	}
+
+	fusedFilters.clear();
+}
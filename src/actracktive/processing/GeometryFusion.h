@@ -0,0 +1,71 @@
+/*
+ * GeometryFusion.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GEOMETRYFUSION_H_
+#define GEOMETRYFUSION_H_
+
+#include "actracktive/processing/ProcessingGraph.h"
+#include <list>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+class ImageFilter;
+
+/**
+ * Fuses chains of geometric filters (like cropping or mirroring) into the
+ * remap of a preceding filter supporting this (like undistortion), for as
+ * long as it exists. A chain is only fused if each of its filters is
+ * stateless, not rate limited and consumed by nothing but the next filter of
+ * the chain. The filters inside a fused chain are then only fetched on demand
+ * (see ImageFilter::fuse()), so their outputs stay valid for anything
+ * requesting them anyway.
+ *
+ * As the connections of the nodes may change at any time, the chains are
+ * checked again by update(), which has to be called between steps.
+ */
+class GeometryFusion: private boost::noncopyable
+{
+public:
+	GeometryFusion(ProcessingGraph& graph);
+	GeometryFusion(const std::list<Node*>& nodes);
+	~GeometryFusion();
+
+	/**
+	 * Fuses the chains again, if any connection of the nodes has been changed
+	 * since the last update.
+	 */
+	void update();
+
+private:
+	const std::list<Node*> nodes;
+	std::vector<ImageFilter*> fusedFilters;
+	volatile bool connectionsChanged;
+
+	void connect();
+	void disconnect();
+	void handleConnectionChange();
+
+	void fuse();
+	void unfuse();
+
+};
+
+#endif
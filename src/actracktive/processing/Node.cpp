@@ -83,6 +83,10 @@ Node::Node(const std::string& id, const std::string& name)
 {
 }
 
+Node::~Node()
+{
+}
+
 const std::string& Node::getId() const
 {
 	return id;
@@ -98,6 +102,16 @@ bool Node::isRunning() const
 	return running;
 }
 
+bool Node::isIdle() const
+{
+	return false;
+}
+
+bool Node::isOnlyNeededByConsumers() const
+{
+	return false;
+}
+
 Node::NodeConnections& Node::getConnections()
 {
 	return connections;
@@ -173,10 +173,25 @@ public:
 	static const Type& TYPE();
 	virtual const Type& getType() const;
 
+	virtual ~Node();
+
 	virtual const std::string& getId() const;
 	virtual const std::string& getName() const;
 	virtual bool isRunning() const;
 
+	/**
+	 * Returns true if this node does not process anything in the current step
+	 * (only valid after beforeStep()).
+	 */
+	virtual bool isIdle() const;
+
+	/**
+	 * Returns true if this node only has to be stepped to provide data for
+	 * the nodes connected to it, so that it can be left out of steps in which
+	 * all of them are idle.
+	 */
+	virtual bool isOnlyNeededByConsumers() const;
+
 	virtual NodeConnections& getConnections();
 	virtual Properties& getSettings();
 
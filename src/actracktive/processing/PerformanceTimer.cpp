@@ -26,7 +26,8 @@ const unsigned int PerformanceTimer::EXECUTION_TIMES_WINDOW = 60;
 
 PerformanceTimer::PerformanceTimer()
 	: executionTimes(), executionTimestamps(), executionTimeSum(0, 0, 0, 0), executionTime(0, 0, 0, 0), startTime(),
-		averageExecutionTime(0), executionsPerSecond(0)
+		averageExecutionTime(0), executionsPerSecond(0), allocations(),
+		previousAllocations(AllocationCounter::NONE)
 {
 	reset();
 }
@@ -51,6 +52,8 @@ void PerformanceTimer::pause()
 
 	executionTime += (pauseTime - startTime);
 	startTime = boost::posix_time::ptime();
+
+	allocations.deactivate(previousAllocations);
 }
 
 void PerformanceTimer::resume()
@@ -59,6 +62,8 @@ void PerformanceTimer::resume()
 		return;
 	}
 
+	previousAllocations = allocations.activate();
+
 	startTime = boost::posix_time::ptime(boost::posix_time::microsec_clock::local_time());
 }
 
@@ -70,6 +75,7 @@ void PerformanceTimer::stop()
 
 	pause();
 
+	allocations.finishExecution();
 	updateExecutionTimes(executionTime);
 	executionTime = boost::posix_time::time_duration(boost::posix_time::not_a_date_time);
 }
@@ -81,6 +87,7 @@ void PerformanceTimer::reset()
 	executionTimeSum = boost::posix_time::time_duration(0, 0, 0, 0);
 	averageExecutionTime = 0;
 	executionsPerSecond = 0;
+	allocations.reset();
 
 	onUpdate();
 }
@@ -95,6 +102,11 @@ double PerformanceTimer::getExecutionsPerSecond() const
 	return executionsPerSecond;
 }
 
+const AllocationCounter& PerformanceTimer::getAllocations() const
+{
+	return allocations;
+}
+
 void PerformanceTimer::updateExecutionTimes(boost::posix_time::time_duration executionTime)
 {
 	if (executionTimes.size() > EXECUTION_TIMES_WINDOW) {
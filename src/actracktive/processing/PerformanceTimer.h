@@ -22,6 +22,7 @@
 #ifndef PERFORMANCETIMER_H_
 #define PERFORMANCETIMER_H_
 
+#include "actracktive/processing/AllocationCounter.h"
 #include <boost/signals2/signal.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <list>
@@ -41,6 +42,7 @@ public:
 
 	double getAverageExecutionTime() const;
 	double getExecutionsPerSecond() const;
+	const AllocationCounter& getAllocations() const;
 
 private:
 	static const unsigned int EXECUTION_TIMES_WINDOW;
@@ -55,6 +57,9 @@ private:
 	double averageExecutionTime;
 	double executionsPerSecond;
 
+	AllocationCounter allocations;
+	AllocationCounter::Token previousAllocations;
+
 	void updateExecutionTimes(boost::posix_time::time_duration executionTime);
 
 };
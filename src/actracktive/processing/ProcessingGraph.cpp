@@ -21,6 +21,7 @@
 
 #include "actracktive/processing/ProcessingGraph.h"
 #include <utility>
+#include <vector>
 #include <boost/lexical_cast.hpp>
 
 static const std::string ID_PREFIX = "__node-";
@@ -133,6 +134,11 @@ void ProcessingGraph::start()
 }
 
 void ProcessingGraph::step()
+{
+	step(nodeOrder);
+}
+
+void ProcessingGraph::step(const std::list<Node*>& nodes)
 {
 	if (!started) {
 		return;
@@ -140,9 +146,9 @@ void ProcessingGraph::step()
 
 	timer.start();
 
-	doBeforeStep();
-	doStep();
-	doAfterStep();
+	doBeforeStep(nodes);
+	doStep(nodes);
+	doAfterStep(nodes);
 
 	timer.stop();
 }
@@ -166,26 +172,82 @@ void ProcessingGraph::doStart()
 	started = true;
 }
 
-void ProcessingGraph::doBeforeStep()
+void ProcessingGraph::doBeforeStep(const std::list<Node*>& nodes)
 {
-	for (std::list<Node*>::iterator node = nodeOrder.begin(); node != nodeOrder.end(); ++node) {
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
 		(*node)->timer.start();
 		(*node)->beforeStep();
 		(*node)->timer.pause();
 	}
 }
 
-void ProcessingGraph::doStep()
+void ProcessingGraph::doStep(const std::list<Node*>& nodes)
 {
-	for (std::list<Node*>::iterator node = nodeOrder.begin(); node != nodeOrder.end(); ++node) {
-		(*node)->step();
+	const std::set<Node*> skippedNodes = findSkippedNodes(nodes);
+
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+		if (skippedNodes.count(*node) == 0) {
+			(*node)->step();
+		}
+	}
+}
+
+std::set<Node*> ProcessingGraph::findSkippedNodes(const std::list<Node*>& nodes) const
+{
+	std::set<Node*> idleNodes;
+	std::map<Node*, std::vector<Node*> > consumers;
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+		if ((*node)->isIdle()) {
+			idleNodes.insert(*node);
+		}
+
+		const Node::NodeConnections::Values& connections = (*node)->getConnections().getAll();
+		for (Node::NodeConnections::Values::const_iterator connection = connections.begin(); connection != connections.end();
+			++connection) {
+			Node* target = (*connection)->getNode();
+			if (target != NULL) {
+				consumers[target].push_back(*node);
+			}
+		}
+	}
+
+	std::set<Node*> skippedNodes;
+	if (idleNodes.empty()) {
+		return skippedNodes;
 	}
+
+	// Skipping a node may allow skipping the nodes it consumes, so this is
+	// repeated until nothing changes (the graph is usually small and shallow)
+	bool changed = true;
+	while (changed) {
+		changed = false;
+
+		for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+			const std::vector<Node*>& nodeConsumers = consumers[*node];
+			if (nodeConsumers.empty() || skippedNodes.count(*node) > 0 || !(*node)->isOnlyNeededByConsumers()) {
+				continue;
+			}
+
+			bool needed = false;
+			for (std::vector<Node*>::const_iterator consumer = nodeConsumers.begin(); consumer != nodeConsumers.end() && !needed;
+				++consumer) {
+				needed = idleNodes.count(*consumer) == 0 && skippedNodes.count(*consumer) == 0;
+			}
+
+			if (!needed) {
+				skippedNodes.insert(*node);
+				changed = true;
+			}
+		}
+	}
+
+	return skippedNodes;
 }
 
-void ProcessingGraph::doAfterStep()
+void ProcessingGraph::doAfterStep(const std::list<Node*>& nodes)
 {
 	double nodeExecutionTimeSum = 0;
-	for (std::list<Node*>::iterator node = nodeOrder.begin(); node != nodeOrder.end(); ++node) {
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
 		(*node)->timer.resume();
 		(*node)->afterStep();
 		(*node)->timer.stop();
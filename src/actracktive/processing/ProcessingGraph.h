@@ -26,6 +26,7 @@
 #include "actracktive/processing/PerformanceTimer.h"
 #include <map>
 #include <list>
+#include <set>
 
 class ProcessingGraph
 {
@@ -52,7 +53,15 @@ public:
 	bool isEmpty() const;
 
 	void start();
+	/**
+	 * Steps the given nodes (or all). Nodes which are only needed by their
+	 * consumers (see Node::isOnlyNeededByConsumers()) are left out of the
+	 * step if all of their consumers are idle or left out themselves, e.g.
+	 * the filters only feeding a rate limited detector whose fetch is not
+	 * due. Such nodes are still fetched if requested anyway.
+	 */
 	void step();
+	void step(const std::list<Node*>& nodes);
 	void stop();
 
 private:
@@ -65,9 +74,10 @@ private:
 	unsigned int currentId;
 
 	void doStart();
-	void doBeforeStep();
-	void doStep();
-	void doAfterStep();
+	void doBeforeStep(const std::list<Node*>& nodes);
+	void doStep(const std::list<Node*>& nodes);
+	std::set<Node*> findSkippedNodes(const std::list<Node*>& nodes) const;
+	void doAfterStep(const std::list<Node*>& nodes);
 	void doStop();
 
 };
@@ -21,10 +21,10 @@
 
 #include "actracktive/processing/nodes/GridTransformer.h"
 #include "actracktive/processing/NodeFactory.h"
-#include <cmath>
-#include <limits>
+#include "actracktive/util/GridMapping.h"
+#include <algorithm>
 #include <stdexcept>
-#include <boost/numeric/conversion/cast.hpp>
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <log4cplus/logger.h>
 
@@ -43,47 +43,94 @@ const Node::Type& GridTransformer::getType() const
 
 static const Rectangle NORMALIZED_BOUNDS = Rectangle(0.0, 0.0, 1.0, 1.0);
 
+class GridSnapshot: public Transformer::Snapshot
+{
+public:
+	GridSnapshot(unsigned int rows, unsigned int columns, const std::vector<Vector2D>& input, const Rectangle& inputBounds,
+		const std::vector<Vector2D>& output, const Vector2D& outputScale)
+		: mapping(rows, columns, input, inputBounds, output, outputScale)
+	{
+	}
+
+	virtual Vector2D transform(const Vector2D& point) const
+	{
+		if (!mapping.getInputBounds().isPointInside(point)) {
+			LOG4CPLUS_WARN(logger, "Transforming point outside pre-mapped area!");
+		}
+
+		return mapping.map(point);
+	}
+
+	virtual void transformPoints(const Vector2D* input, Vector2D* output, std::size_t count) const
+	{
+		std::size_t outside = mapping.map(input, output, count);
+		if (outside > 0) {
+			LOG4CPLUS_WARN(logger, "Transforming " << outside << " points outside pre-mapped area!");
+		}
+	}
+
+	virtual double transformAngle(const double& angle) const
+	{
+		return angle; // TODO determine if angles have to be reversed or not
+	}
+
+private:
+	GridMapping mapping;
+
+};
+
 GridTransformer::GridTransformer(const std::string& id, const std::string& name)
 	: Transformer(id, name), enabled("enabled", "Enabled", mutex, true), normalize("normalize", "Normalize Output", mutex, false),
 		source("source", "Source", mutex), rows(0), columns(0), inputBounds(0, 0, 640, 480), inputPoints(), outputBounds(0, 0, 640, 480),
-		outputPoints(), inputToOutput(), inputToOutputStride(0)
+		outputPoints(), snapshot(NULL), snapshotReaders(0), updateMutex(), updateThread(), updateRequestMutex(), updateRequested(),
+		updatePending(false), stopping(false)
 {
 	settings.add(enabled);
 	settings.add(normalize);
 	connections.add(source);
 
-	enabled.onChange.connect(boost::bind(&GridTransformer::updateInputToOutput, this));
-	normalize.onChange.connect(boost::bind(&GridTransformer::updateInputToOutput, this));
+	enabled.onChange.connect(boost::bind(&GridTransformer::requestUpdate, this));
+	normalize.onChange.connect(boost::bind(&GridTransformer::requestUpdate, this));
 }
 
-Vector2D GridTransformer::transform(const Vector2D& point) const
+GridTransformer::~GridTransformer()
 {
-	Lock lock(this);
-
-	if (!enabled || rows == 0 || columns == 0 || inputToOutput.empty()) {
-		return point;
+	{
+		boost::mutex::scoped_lock lock(updateRequestMutex);
+		stopping = true;
 	}
 
-	if (inputBounds.isPointInside(point)) {
-		Vector2D localPoint = point - inputBounds.getMin();
+	updateRequested.notify_all();
+	updateThread.join();
+
+	installSnapshot(NULL);
+}
 
-		int x = int(localPoint.x);
-		double xBlend = 1.0 - (localPoint.x - x);
+Vector2D GridTransformer::transform(const Vector2D& point) const
+{
+	// Readers are counted before loading the snapshot, see installSnapshot()
+	__sync_fetch_and_add(&snapshotReaders, 1);
 
-		int y = int(localPoint.y);
-		double yBlend = 1.0 - (localPoint.y - y);
+	const Snapshot::Ptr* current = snapshot;
+	Vector2D result = (current != NULL) ? (*current)->transform(point) : point;
 
-		const Vector2D& a = inputToOutput[y * inputToOutputStride + x];
-		const Vector2D& b = inputToOutput[y * inputToOutputStride + (x + 1)];
-		const Vector2D& c = inputToOutput[(y + 1) * inputToOutputStride + x];
-		const Vector2D& d = inputToOutput[(y + 1) * inputToOutputStride + (x + 1)];
+	__sync_fetch_and_sub(&snapshotReaders, 1);
 
-		return a * (xBlend * yBlend) + b * ((1 - xBlend) * yBlend) + c * (xBlend * (1 - yBlend)) + d * ((1 - xBlend) * (1 - yBlend));
-	} else {
-		LOG4CPLUS_WARN(logger, "Transforming point outside pre-mapped area!");
+	return result;
+}
 
-		return transformToOutput(point);
+void GridTransformer::transformPoints(const Vector2D* input, Vector2D* output, std::size_t count) const
+{
+	__sync_fetch_and_add(&snapshotReaders, 1);
+
+	const Snapshot::Ptr* current = snapshot;
+	if (current != NULL) {
+		(*current)->transformPoints(input, output, count);
+	} else if (input != output) {
+		std::copy(input, input + count, output);
 	}
+
+	__sync_fetch_and_sub(&snapshotReaders, 1);
 }
 
 Rectangle GridTransformer::transform(const Rectangle& rectangle) const
@@ -93,34 +140,56 @@ Rectangle GridTransformer::transform(const Rectangle& rectangle) const
 
 double GridTransformer::transformAngle(const double& angle) const
 {
-	return angle; // TODO determine if angles have to be reversed or not
+	__sync_fetch_and_add(&snapshotReaders, 1);
+
+	const Snapshot::Ptr* current = snapshot;
+	double result = (current != NULL) ? (*current)->transformAngle(angle) : angle;
+
+	__sync_fetch_and_sub(&snapshotReaders, 1);
+
+	return result;
+}
+
+Transformer::Snapshot::Ptr GridTransformer::getSnapshot() const
+{
+	__sync_fetch_and_add(&snapshotReaders, 1);
+
+	const Snapshot::Ptr* current = snapshot;
+	Snapshot::Ptr result = (current != NULL) ? *current : Snapshot::Ptr();
+
+	__sync_fetch_and_sub(&snapshotReaders, 1);
+
+	return result;
 }
 
 void GridTransformer::configure(ConfigurationContext& context) throw (ConfigurationError)
 {
 	Transformer::configure(context);
 
-	Lock lock(this);
+	{
+		Lock lock(this);
 
-	rows = context.getValue("rows", rows);
-	columns = context.getValue("columns", columns);
-	inputBounds = context.getValue("inputBounds", inputBounds);
+		rows = context.getValue("rows", rows);
+		columns = context.getValue("columns", columns);
+		inputBounds = context.getValue("inputBounds", inputBounds);
 
-	inputPoints.resize((rows + 1) * (columns + 1));
-	std::istringstream inputPointsValue(context.getValue("inputPoints", ""));
-	for (std::vector<Vector2D>::iterator point = inputPoints.begin(); point != inputPoints.end() && inputPointsValue.good(); ++point) {
-		inputPointsValue >> *point;
-	}
+		inputPoints.resize((rows + 1) * (columns + 1));
+		std::istringstream inputPointsValue(context.getValue("inputPoints", ""));
+		for (std::vector<Vector2D>::iterator point = inputPoints.begin(); point != inputPoints.end() && inputPointsValue.good(); ++point) {
+			inputPointsValue >> *point;
+		}
 
-	outputBounds = context.getValue("outputBounds", outputBounds);
+		outputBounds = context.getValue("outputBounds", outputBounds);
 
-	outputPoints.resize((rows + 1) * (columns + 1));
-	std::istringstream outputPointsValue(context.getValue("outputPoints", ""));
-	for (std::vector<Vector2D>::iterator point = outputPoints.begin(); point != outputPoints.end() && outputPointsValue.good(); ++point) {
-		outputPointsValue >> *point;
+		outputPoints.resize((rows + 1) * (columns + 1));
+		std::istringstream outputPointsValue(context.getValue("outputPoints", ""));
+		for (std::vector<Vector2D>::iterator point = outputPoints.begin(); point != outputPoints.end() && outputPointsValue.good(); ++point) {
+			outputPointsValue >> *point;
+		}
 	}
 
-	updateInputToOutput();
+	// The mapping is built right away, so it is available once the graph runs
+	updateMapping();
 }
 
 void GridTransformer::save(ConfigurationContext& context) throw (ConfigurationError)
@@ -217,100 +286,115 @@ void GridTransformer::updatePoints(unsigned int rows, unsigned int columns, cons
 	this->outputPoints = output;
 	this->outputBounds = outputBounds;
 
-	updateInputToOutput();
+	requestUpdate();
 }
 
-void GridTransformer::updateInputToOutput()
+void GridTransformer::requestUpdate()
 {
-	if (rows == 0 || columns == 0) {
+	boost::mutex::scoped_lock lock(updateRequestMutex);
+
+	if (stopping) {
 		return;
 	}
 
-	unsigned int width = boost::numeric_cast<unsigned int>(inputBounds.getWidth() + 0.5) + 1;
-	unsigned int height = boost::numeric_cast<unsigned int>(inputBounds.getHeight() + 0.5) + 1;
-
-	inputToOutput.resize(width * height);
-	inputToOutputStride = width;
-
-	for (unsigned int y = 0; y < height; ++y) {
-		for (unsigned int x = 0; x < width; ++x) {
-			inputToOutput[y * inputToOutputStride + x] = transformToOutput(inputBounds.getMin() + Vector2D(x, y));
-		}
+	updatePending = true;
+	if (updateThread.get_id() == boost::thread::id()) {
+		updateThread = boost::thread(boost::bind(&GridTransformer::runUpdates, this));
 	}
 
-	transformerUpdated(*this);
+	updateRequested.notify_one();
 }
 
-Vector2D GridTransformer::transformToOutput(const Vector2D& input) const
+/*
+ * Runs on the update thread. Requests arriving while a mapping is built are
+ * combined into a single further update.
+ */
+void GridTransformer::runUpdates()
 {
-	std::pair<Triangle, Triangle> mapping = findTriangleMapping(input);
+	boost::mutex::scoped_lock lock(updateRequestMutex);
 
-	Vector2D outputPoint = mapping.second.getPointForBarycentricCoordinates(mapping.first.getBarycentricCoordinates(input));
-	if (normalize) {
-		return outputPoint.scale(1.0 / outputBounds.getMax().x, 1.0 / outputBounds.getMax().y);
-	} else {
-		return outputPoint;
+	while (!stopping) {
+		if (!updatePending) {
+			updateRequested.wait(lock);
+			continue;
+		}
+
+		updatePending = false;
+
+		lock.unlock();
+		updateMapping();
+		lock.lock();
 	}
 }
 
-std::pair<Triangle, Triangle> GridTransformer::findTriangleMapping(const Vector2D& point) const
+/*
+ * The node is only locked while copying the grid, the mapping itself is built
+ * without holding the lock. Updates are serialized, so a later update always
+ * installs the mapping of a later state. Must not be called with the node
+ * locked.
+ */
+void GridTransformer::updateMapping()
 {
-	for (unsigned int row = 0; row < rows; ++row) {
-		for (unsigned int column = 0; column < columns; ++column) {
-			std::pair<Triangle, Triangle> upper = getUpperTriangle(row, column);
-			if (upper.first.isPointInside(point)) {
-				return upper;
-			}
-
-			std::pair<Triangle, Triangle> lower = getLowerTriangle(row, column);
-			if (lower.first.isPointInside(point)) {
-				return lower;
+	boost::mutex::scoped_lock lock(updateMutex);
+
+	bool mapped = false;
+	unsigned int gridRows = 0;
+	unsigned int gridColumns = 0;
+	std::vector<Vector2D> input;
+	Rectangle gridInputBounds;
+	std::vector<Vector2D> output;
+	Vector2D outputScale(1, 1);
+
+	{
+		Lock nodeLock(this);
+
+		mapped = enabled && rows != 0 && columns != 0;
+		if (mapped) {
+			gridRows = rows;
+			gridColumns = columns;
+			input = inputPoints;
+			gridInputBounds = inputBounds;
+			output = outputPoints;
+
+			if (normalize) {
+				outputScale = Vector2D(1.0 / outputBounds.getMax().x, 1.0 / outputBounds.getMax().y);
 			}
 		}
 	}
 
-	// No triangle includes the point, now find the closest one
-
-	double closestDistance = std::numeric_limits<double>::max();
-	unsigned int closestPointRow = 0;
-	unsigned int closestPointColumn = 0;
-
-	for (unsigned int row = 0; row < rows; ++row) {
-		for (unsigned int column = 0; column < columns; ++column) {
-			double distance = inputPoints[row * (columns + 1) + column].distanceSQ(point);
-			if (distance < closestDistance) {
-				closestDistance = distance;
-				closestPointRow = row;
-				closestPointColumn = column;
-			}
+	const Snapshot::Ptr* next = NULL;
+	if (mapped) {
+		try {
+			next = new Snapshot::Ptr(new GridSnapshot(gridRows, gridColumns, input, gridInputBounds, output, outputScale));
+		} catch (std::invalid_argument& e) {
+			LOG4CPLUS_ERROR(logger, "Could not update grid mapping: " << e.what());
 		}
 	}
 
-	return getUpperTriangle(closestPointRow, closestPointColumn);
-}
-
-inline std::pair<Triangle, Triangle> GridTransformer::getUpperTriangle(const unsigned int& row, const unsigned int& column) const
-{
-	unsigned int indexUpperLeft = row * (columns + 1) + column;
-	unsigned int indexUpperRight = indexUpperLeft + 1;
-	unsigned int indexLowerLeft = (row + 1) * (columns + 1) + column;
+	installSnapshot(next);
 
-	Triangle input(inputPoints[indexUpperLeft], inputPoints[indexUpperRight], inputPoints[indexLowerLeft]);
-	Triangle output(outputPoints[indexUpperLeft], outputPoints[indexUpperRight], outputPoints[indexLowerLeft]);
+	lock.unlock();
 
-	return std::make_pair(input, output);
+	transformerUpdated(*this);
 }
 
-inline std::pair<Triangle, Triangle> GridTransformer::getLowerTriangle(const unsigned int& row, const unsigned int& column) const
+/*
+ * Swaps in the next snapshot and releases the previous one once no reader can
+ * be using it anymore. Readers are counted before they load the snapshot, so
+ * every reader which may have loaded the previous one is still counted after
+ * the swap. Copies of the previous snapshot (see getSnapshot()) keep it alive.
+ */
+void GridTransformer::installSnapshot(const Snapshot::Ptr* next)
 {
-	unsigned int indexUpperRight = row * (columns + 1) + column + 1;
-	unsigned int indexLowerLeft = (row + 1) * (columns + 1) + column;
-	unsigned int indexLowerRight = indexLowerLeft + 1;
+	__sync_synchronize();
+	const Snapshot::Ptr* previous = __sync_lock_test_and_set(&snapshot, next);
+	__sync_synchronize();
 
-	Triangle input(inputPoints[indexUpperRight], inputPoints[indexLowerRight], inputPoints[indexLowerLeft]);
-	Triangle output(outputPoints[indexUpperRight], outputPoints[indexLowerRight], outputPoints[indexLowerLeft]);
+	while (snapshotReaders != 0) {
+		boost::this_thread::yield();
+	}
 
-	return std::make_pair(input, output);
+	delete previous;
 }
 
 static bool __registered = registerNodeType<GridTransformer>();
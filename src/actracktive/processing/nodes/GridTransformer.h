@@ -25,21 +25,39 @@
 #include "actracktive/processing/nodes/Transformer.h"
 #include "actracktive/processing/nodes/ObjectSource.h"
 #include "actracktive/util/Geometry.h"
-
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+/**
+ * Maps points through a calibrated grid. The mapping is precomputed into an
+ * immutable snapshot (holding a GridMapping), which is rebuilt by a background
+ * thread whenever the grid or the settings change and then swapped in
+ * atomically. Transforming points therefore never locks the node.
+ */
 class GridTransformer: public Transformer
 {
 public:
 	static const Node::Type& TYPE();
 	const Node::Type& getType() const;
 
+	/**
+	 * Emitted asynchronously by the update thread, once the mapping of a
+	 * changed grid has been installed. Handlers must lock the node to access
+	 * the grid, as it may be changed again concurrently.
+	 */
 	boost::signals2::signal<void(const GridTransformer&)> transformerUpdated;
 
 	GridTransformer(const std::string& id, const std::string& name = "Grid Transformer");
+	virtual ~GridTransformer();
 
 	virtual Vector2D transform(const Vector2D& point) const;
+	virtual void transformPoints(const Vector2D* input, Vector2D* output, std::size_t count) const;
 	virtual Rectangle transform(const Rectangle& rectangle) const;
 	virtual double transformAngle(const double& angle) const;
 
+	virtual Snapshot::Ptr getSnapshot() const;
+
 	virtual void configure(ConfigurationContext& context) throw (ConfigurationError);
 	virtual void save(ConfigurationContext& context) throw (ConfigurationError);
 
@@ -72,14 +90,20 @@ private:
 	Rectangle outputBounds;
 	std::vector<Vector2D> outputPoints;
 
-	std::vector<Vector2D> inputToOutput;
-	unsigned int inputToOutputStride;
+	const Snapshot::Ptr* volatile snapshot;
+	mutable volatile unsigned int snapshotReaders;
+	boost::mutex updateMutex;
+
+	boost::thread updateThread;
+	boost::mutex updateRequestMutex;
+	boost::condition_variable updateRequested;
+	bool updatePending;
+	bool stopping;
 
-	void updateInputToOutput();
-	Vector2D transformToOutput(const Vector2D& point) const;
-	std::pair<Triangle, Triangle> findTriangleMapping(const Vector2D& point) const;
-	std::pair<Triangle, Triangle> getUpperTriangle(const unsigned int& row, const unsigned int& column) const;
-	std::pair<Triangle, Triangle> getLowerTriangle(const unsigned int& row, const unsigned int& column) const;
+	void requestUpdate();
+	void runUpdates();
+	void updateMapping();
+	void installSnapshot(const Snapshot::Ptr* next);
 
 };
 
@@ -20,9 +20,22 @@
  */
 
 #include "actracktive/processing/nodes/Object.h"
+#include <boost/make_shared.hpp>
 
 const unsigned int Object::UNKNOWN_OBJECT_ID = 0;
 
+// Standard deviation of the unknown velocity of a new object (pixels/ms)
+static const double INITIAL_VELOCITY_DEVIATION = 2;
+
+/*
+ * Velocities are given per millisecond. Whole milliseconds are too coarse for
+ * frame intervals like 16.67 ms, so fractions are kept.
+ */
+static double toMilliseconds(const boost::posix_time::time_duration& duration)
+{
+	return duration.total_microseconds() / 1000.0;
+}
+
 bool Object::IsNew(const Object* o)
 {
 	return o->isNew();
@@ -41,7 +54,9 @@ bool Object::IsDead(const Object* o)
 Object::Object(unsigned int id, unsigned int objectId, const boost::posix_time::ptime& time, const Vector2D& position,
 	const std::vector<Vector2D>& outline)
 	: id(id), objectId(objectId), time(time), previousTime(time), position(position), previousPosition(position), velocity(0, 0),
-		acceleration(0, 0), outline(outline), bounds(), creationTime(time), state(NEW), framesLost(0)
+		acceleration(0, 0), outline(boost::make_shared<const std::vector<Vector2D> >(outline)), outlineTransformation(),
+		bounds(), creationTime(time), state(NEW), framesLost(0), motionModel(false),
+		accelerationNoise(0), measurementNoise(0), estimatedPosition(position), positionVariance(0), covariance(0), velocityVariance(0)
 {
 	updateBounds();
 }
@@ -98,26 +113,42 @@ const Vector2D& Object::getAcceleration() const
 
 const std::vector<Vector2D>& Object::getOutline() const
 {
-	return outline;
+	applyOutlineTransformation();
+	return *outline;
 }
 
 const Rectangle& Object::getBounds() const
 {
+	applyOutlineTransformation();
 	return bounds;
 }
 
-void Object::transform(const Transformer& t)
+void Object::transform(const Transformer::Snapshot::Ptr& snapshot)
 {
-	previousPosition = t.transform(previousPosition);
-	position = t.transform(position);
+	if (!snapshot) {
+		return;
+	}
+
+	// The estimated velocity and acceleration are transformed as the
+	// displacements they cause within one millisecond
+	Vector2D points[5] = { previousPosition, position, estimatedPosition, estimatedPosition + velocity,
+		estimatedPosition + acceleration };
+	snapshot->transformPoints(points, points, motionModel ? 5 : 2);
 
-	updateAccelerationAndVelocity();
+	previousPosition = points[0];
+	position = points[1];
 
-	for (std::vector<Vector2D>::iterator point = outline.begin(); point != outline.end(); ++point) {
-		*point = t.transform(*point);
+	if (motionModel) {
+		estimatedPosition = points[2];
+		velocity = points[3] - estimatedPosition;
+		acceleration = points[4] - estimatedPosition;
+	} else {
+		updateAccelerationAndVelocity();
 	}
 
-	updateBounds();
+	// A pending transformation has to be applied before the next one
+	applyOutlineTransformation();
+	outlineTransformation = snapshot;
 }
 
 boost::posix_time::time_duration Object::getAge() const
@@ -162,8 +193,8 @@ void Object::update(const Object& from)
 		throw std::runtime_error("Cannot update from incompatible object!");
 	}
 
-	boost::posix_time::time_duration dt = from.time - this->time;
-	if (dt.total_milliseconds() <= 0) {
+	double dt = toMilliseconds(from.time - this->time);
+	if (dt <= 0) {
 		return;
 	}
 
@@ -175,9 +206,14 @@ void Object::update(const Object& from)
 	previousPosition = position;
 	position = from.position;
 
-	updateAccelerationAndVelocity();
+	if (motionModel) {
+		updateMotionModel(position, dt);
+	} else {
+		updateAccelerationAndVelocity();
+	}
 
 	outline = from.outline;
+	outlineTransformation = from.outlineTransformation;
 	bounds = from.bounds;
 
 	framesLost = 0;
@@ -186,6 +222,41 @@ void Object::update(const Object& from)
 	doUpdate(from);
 }
 
+void Object::setMotionModel(double accelerationNoise, double measurementNoise)
+{
+	this->accelerationNoise = accelerationNoise;
+	this->measurementNoise = measurementNoise;
+
+	if (!motionModel) {
+		motionModel = true;
+
+		estimatedPosition = position;
+		positionVariance = measurementNoise * measurementNoise;
+		covariance = 0;
+		velocityVariance = INITIAL_VELOCITY_DEVIATION * INITIAL_VELOCITY_DEVIATION;
+	}
+}
+
+bool Object::hasMotionModel() const
+{
+	return motionModel;
+}
+
+Vector2D Object::predictPosition(const boost::posix_time::ptime& time) const
+{
+	double dt = toMilliseconds(time - this->time);
+	return (motionModel ? estimatedPosition : position) + velocity * dt;
+}
+
+double Object::getPredictionVariance(const boost::posix_time::ptime& time) const
+{
+	double dt = toMilliseconds(time - this->time);
+	double q = accelerationNoise * accelerationNoise;
+
+	return positionVariance + 2 * dt * covariance + dt * dt * velocityVariance + q * dt * dt * dt * dt / 4
+		+ measurementNoise * measurementNoise;
+}
+
 boost::posix_time::time_duration Object::getDeltaTime() const
 {
 	return time - previousTime;
@@ -196,13 +267,33 @@ Vector2D Object::getDeltaPosition() const
 	return position - previousPosition;
 }
 
-void Object::updateBounds()
+/*
+ * The transformed outline replaces the shared one, so copies of this object
+ * are not affected.
+ */
+void Object::applyOutlineTransformation() const
 {
-	if (outline.empty()) {
+	if (!outlineTransformation) {
+		return;
+	}
+
+	if (!outline->empty()) {
+		boost::shared_ptr<std::vector<Vector2D> > transformed = boost::make_shared<std::vector<Vector2D> >(outline->size());
+		outlineTransformation->transformPoints(&(*outline)[0], &(*transformed)[0], outline->size());
+		outline = transformed;
+	}
+
+	outlineTransformation.reset();
+	updateBounds();
+}
+
+void Object::updateBounds() const
+{
+	if (outline->empty()) {
 		bounds = Rectangle();
 	} else {
-		bounds = Rectangle(outline[0], outline[0]);
-		for (std::vector<Vector2D>::iterator point = outline.begin(); point != outline.end(); ++point) {
+		bounds = Rectangle(outline->front(), outline->front());
+		for (std::vector<Vector2D>::const_iterator point = outline->begin(); point != outline->end(); ++point) {
 			bounds += *point;
 		}
 	}
@@ -210,12 +301,44 @@ void Object::updateBounds()
 
 void Object::updateAccelerationAndVelocity()
 {
-	boost::posix_time::time_duration dt = getDeltaTime();
-	Vector2D velocity = getDeltaPosition() / dt.total_milliseconds();
-	this->acceleration = (velocity - this->velocity) / dt.total_milliseconds();
+	double dt = toMilliseconds(getDeltaTime());
+	Vector2D velocity = getDeltaPosition() / dt;
+	this->acceleration = (velocity - this->velocity) / dt;
 	this->velocity = velocity;
 }
 
+/*
+ * Both axes share the same (independent) model, so a single covariance
+ * matrix of position and velocity is kept for them. The acceleration is
+ * modeled as white noise which is constant between two measurements.
+ */
+void Object::updateMotionModel(const Vector2D& measuredPosition, double dt)
+{
+	double q = accelerationNoise * accelerationNoise;
+
+	// Prediction
+	Vector2D predictedPosition = estimatedPosition + velocity * dt;
+	double predictedPositionVariance = positionVariance + 2 * dt * covariance + dt * dt * velocityVariance + q * dt * dt * dt * dt / 4;
+	double predictedCovariance = covariance + dt * velocityVariance + q * dt * dt * dt / 2;
+	double predictedVelocityVariance = velocityVariance + q * dt * dt;
+
+	// Correction
+	double innovationVariance = predictedPositionVariance + measurementNoise * measurementNoise;
+	double positionGain = innovationVariance > 0 ? predictedPositionVariance / innovationVariance : 1;
+	double velocityGain = innovationVariance > 0 ? predictedCovariance / innovationVariance : 0;
+
+	Vector2D innovation = measuredPosition - predictedPosition;
+	Vector2D previousVelocity = velocity;
+
+	estimatedPosition = predictedPosition + innovation * positionGain;
+	velocity = velocity + innovation * velocityGain;
+	acceleration = (velocity - previousVelocity) / dt;
+
+	positionVariance = (1 - positionGain) * predictedPositionVariance;
+	covariance = (1 - positionGain) * predictedCovariance;
+	velocityVariance = predictedVelocityVariance - velocityGain * predictedCovariance;
+}
+
 osc::OutboundPacketStream& operator<<(osc::OutboundPacketStream& ops, const Object* object)
 {
 	object->toOsc(ops);
@@ -29,12 +29,15 @@
 #include <vector>
 #include <functional>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/shared_ptr.hpp>
 
 class Object
 {
 public:
 	friend osc::OutboundPacketStream& operator<<(osc::OutboundPacketStream& ops, const Object* object);
 	friend osc::OutboundPacketStream& operator<<(osc::OutboundPacketStream& ops, const Object& object);
+	friend class ObjectStreamWriter;
+	friend class ObjectStreamReader;
 
 	static const unsigned int UNKNOWN_OBJECT_ID;
 
@@ -64,7 +67,12 @@ public:
 	virtual const std::vector<Vector2D>& getOutline() const;
 	virtual const Rectangle& getBounds() const;
 
-	virtual void transform(const Transformer& t);
+	/**
+	 * Transforms the positions (and the motion model) right away. The outline
+	 * is only transformed when it (or the bounds) is requested, as most
+	 * consumers never look at it. An empty snapshot leaves the object as is.
+	 */
+	virtual void transform(const Transformer::Snapshot::Ptr& snapshot);
 
 	virtual boost::posix_time::time_duration getAge() const;
 
@@ -77,6 +85,26 @@ public:
 
 	virtual void update(const Object& from);
 
+	/**
+	 * Estimates position and velocity with a Kalman filter for a constant
+	 * velocity model from now on, instead of taking finite differences of
+	 * the positions. The noise of the acceleration is given in pixels per
+	 * square millisecond, the noise of the measured positions in pixels.
+	 */
+	virtual void setMotionModel(double accelerationNoise, double measurementNoise);
+	virtual bool hasMotionModel() const;
+
+	/**
+	 * Extrapolates the position at the given time from the current velocity.
+	 */
+	virtual Vector2D predictPosition(const boost::posix_time::ptime& time) const;
+
+	/**
+	 * Returns the variance (per axis) of the distance between the predicted
+	 * and the measured position at the given time. Requires a motion model.
+	 */
+	virtual double getPredictionVariance(const boost::posix_time::ptime& time) const;
+
 	virtual void toOsc(osc::OutboundPacketStream& ops) const = 0;
 
 protected:
@@ -99,14 +127,26 @@ private:
 	Vector2D previousPosition;
 	Vector2D velocity;
 	Vector2D acceleration;
-	std::vector<Vector2D> outline;
-	Rectangle bounds;
+	// Outlines are shared between copies of an object and replaced as a whole
+	mutable boost::shared_ptr<const std::vector<Vector2D> > outline;
+	mutable Transformer::Snapshot::Ptr outlineTransformation;
+	mutable Rectangle bounds;
 	boost::posix_time::ptime creationTime;
 	State state;
 	unsigned int framesLost;
 
-	void updateBounds();
+	bool motionModel;
+	double accelerationNoise;
+	double measurementNoise;
+	Vector2D estimatedPosition;
+	double positionVariance;
+	double covariance;
+	double velocityVariance;
+
+	void applyOutlineTransformation() const;
+	void updateBounds() const;
 	void updateAccelerationAndVelocity();
+	void updateMotionModel(const Vector2D& measuredPosition, double dt);
 
 };
 
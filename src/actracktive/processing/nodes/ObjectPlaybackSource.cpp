@@ -0,0 +1,175 @@
+/*
+ * ObjectPlaybackSource.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/nodes/ObjectPlaybackSource.h"
+#include "actracktive/processing/NodeFactory.h"
+#include "actracktive/Filesystem.h"
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <log4cplus/logger.h>
+
+static log4cplus::Logger logger = log4cplus::Logger::getInstance("ObjectPlaybackSource");
+
+const Node::Type& ObjectPlaybackSource::TYPE()
+{
+	static const Node::Type type = Node::Type::of<ObjectPlaybackSource>("ObjectPlaybackSource", ObjectSource::TYPE());
+	return type;
+}
+
+const Node::Type& ObjectPlaybackSource::getType() const
+{
+	return TYPE();
+}
+
+ObjectPlaybackSource::ObjectPlaybackSource(const std::string& id, const std::string& name)
+	: ObjectSource(id, name), recordFile("recordFile", "Record File", mutex), speed("speed", "Speed", mutex, 1, Constraint<double>(0, 100)),
+		loop("loop", "Loop", mutex, false), reader()
+{
+	settings.add(recordFile);
+	settings.add(speed);
+	settings.add(loop);
+}
+
+void ObjectPlaybackSource::start()
+{
+	openRecordFile();
+
+	recordFile.onChange.connect(boost::bind(&ObjectPlaybackSource::propertyChanged, this));
+	speed.onChange.connect(boost::bind(&ObjectPlaybackSource::speedChanged, this));
+
+	ObjectSource::start();
+}
+
+void ObjectPlaybackSource::stop()
+{
+	ObjectSource::stop();
+
+	recordFile.onChange.disconnect(boost::bind(&ObjectPlaybackSource::propertyChanged, this));
+	speed.onChange.disconnect(boost::bind(&ObjectPlaybackSource::speedChanged, this));
+
+	Lock lock(this);
+
+	reader.close();
+}
+
+void ObjectPlaybackSource::fetch(Objects& destination)
+{
+	if (!reader.isOpen()) {
+		destination.clear();
+		return;
+	}
+
+	try {
+		if (!readFrame(destination) && loop) {
+			// Continue the timeline of the previous run, so that times keep
+			// increasing monotonically.
+			reader.rewind();
+			timeOffset = (lastFrameTime + lastFrameInterval) - firstFrameTime;
+			readFrame(destination);
+		}
+	} catch (ObjectStreamError& e) {
+		LOG4CPLUS_ERROR(logger, e.what());
+		reader.close();
+	}
+}
+
+void ObjectPlaybackSource::propertyChanged()
+{
+	Lock lock(this);
+
+	openRecordFile();
+}
+
+void ObjectPlaybackSource::speedChanged()
+{
+	Lock lock(this);
+
+	if (!lastFrameTime.is_not_a_date_time()) {
+		anchorTime = boost::posix_time::microsec_clock::local_time();
+		anchorFrameTime = lastFrameTime;
+	}
+}
+
+void ObjectPlaybackSource::openRecordFile()
+{
+	reader.close();
+
+	if (recordFile.getValue().empty()) {
+		return;
+	}
+
+	try {
+		reader.open(filesystem::toData(recordFile));
+
+		Objects firstFrame;
+		if (!reader.read(firstFrameTime, firstFrame)) {
+			LOG4CPLUS_WARN(logger, "Record file " << filesystem::toData(recordFile).string() << " does not contain any frames!");
+			reader.close();
+			return;
+		}
+		reader.rewind();
+
+		anchorTime = boost::posix_time::microsec_clock::local_time();
+		anchorFrameTime = anchorTime;
+		lastFrameTime = boost::posix_time::ptime();
+		lastFrameInterval = boost::posix_time::time_duration(0, 0, 0, 0);
+		timeOffset = anchorTime - firstFrameTime;
+	} catch (ObjectStreamError& e) {
+		LOG4CPLUS_ERROR(logger, e.what());
+		reader.close();
+	}
+}
+
+bool ObjectPlaybackSource::readFrame(Objects& destination)
+{
+	boost::posix_time::ptime frameTime;
+	if (!reader.read(frameTime, destination, timeOffset)) {
+		return false;
+	}
+
+	waitForFrame(frameTime);
+
+	if (!lastFrameTime.is_not_a_date_time()) {
+		lastFrameInterval = frameTime - lastFrameTime;
+	}
+	lastFrameTime = frameTime;
+
+	return true;
+}
+
+void ObjectPlaybackSource::waitForFrame(const boost::posix_time::ptime& frameTime)
+{
+	if (speed <= 0) {
+		return;
+	}
+
+	double offset = (frameTime - anchorFrameTime).total_microseconds() / speed;
+	boost::posix_time::ptime dueTime = anchorTime + boost::posix_time::microseconds((long) offset);
+	boost::posix_time::ptime now(boost::posix_time::microsec_clock::local_time());
+
+	if (dueTime > now) {
+		timer.pause();
+		boost::this_thread::sleep(dueTime - now);
+		timer.resume();
+	}
+}
+
+static bool __registered = registerNodeType<ObjectPlaybackSource>();
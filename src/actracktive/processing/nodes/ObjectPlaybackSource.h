@@ -0,0 +1,72 @@
+/*
+ * ObjectPlaybackSource.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBJECTPLAYBACKSOURCE_H_
+#define OBJECTPLAYBACKSOURCE_H_
+
+#include "actracktive/processing/nodes/ObjectSource.h"
+#include "actracktive/processing/nodes/ObjectStream.h"
+
+/**
+ * Replays objects recorded by an ObjectRecorder. All times are shifted so
+ * that the first frame appears to happen when playback starts, keeping the
+ * time differences between frames (and thus all velocities) as recorded. The
+ * speed only determines how fast frames are delivered; a speed of 0 delivers
+ * a new frame on every step. Without looping, no objects are delivered after
+ * the last frame.
+ */
+class ObjectPlaybackSource: public ObjectSource
+{
+public:
+	static const Node::Type& TYPE();
+	const Node::Type& getType() const;
+
+	ObjectPlaybackSource(const std::string& id, const std::string& name = "Object Playback");
+
+	virtual void start();
+	virtual void stop();
+
+protected:
+	virtual void fetch(Objects& destination);
+
+private:
+	ValueProperty<boost::filesystem::path> recordFile;
+	ValueProperty<double> speed;
+	ValueProperty<bool> loop;
+
+	ObjectStreamReader reader;
+
+	boost::posix_time::ptime anchorTime;
+	boost::posix_time::ptime anchorFrameTime;
+	boost::posix_time::ptime firstFrameTime;
+	boost::posix_time::ptime lastFrameTime;
+	boost::posix_time::time_duration lastFrameInterval;
+	boost::posix_time::time_duration timeOffset;
+
+	void propertyChanged();
+	void speedChanged();
+	void openRecordFile();
+	bool readFrame(Objects& destination);
+	void waitForFrame(const boost::posix_time::ptime& frameTime);
+
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * ObjectRecorder.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/nodes/ObjectRecorder.h"
+#include "actracktive/processing/NodeFactory.h"
+#include "actracktive/Filesystem.h"
+#include <boost/bind.hpp>
+#include <log4cplus/logger.h>
+
+static log4cplus::Logger logger = log4cplus::Logger::getInstance("ObjectRecorder");
+
+const Node::Type& ObjectRecorder::TYPE()
+{
+	static const Node::Type type = Node::Type::of<ObjectRecorder>("ObjectRecorder", Node::TYPE());
+	return type;
+}
+
+const Node::Type& ObjectRecorder::getType() const
+{
+	return TYPE();
+}
+
+ObjectRecorder::ObjectRecorder(const std::string& id, const std::string& name)
+	: Node(id, name), recording("recording", "Recording", mutex, false), recordFile("recordFile", "Record File", mutex),
+		source("source", "Source", mutex), writer()
+{
+	settings.add(recording);
+	settings.add(recordFile);
+	connections.add(source);
+}
+
+void ObjectRecorder::start()
+{
+	Node::start();
+
+	openRecordFile();
+
+	recording.onChange.connect(boost::bind(&ObjectRecorder::recordingChanged, this));
+	recordFile.onChange.connect(boost::bind(&ObjectRecorder::recordingChanged, this));
+}
+
+void ObjectRecorder::step()
+{
+	Node::step();
+
+	timer.resume();
+
+	Lock lock(this);
+
+	if (writer.isOpen() && source) {
+		Lock sourceLock(source);
+
+		timer.pause();
+		const Objects& objects = source->get();
+		timer.resume();
+
+		try {
+			writer.write(boost::posix_time::microsec_clock::local_time(), objects);
+		} catch (ObjectStreamError& e) {
+			LOG4CPLUS_ERROR(logger, e.what());
+			writer.close();
+		}
+	}
+
+	timer.pause();
+}
+
+void ObjectRecorder::stop()
+{
+	Node::stop();
+
+	recording.onChange.disconnect(boost::bind(&ObjectRecorder::recordingChanged, this));
+	recordFile.onChange.disconnect(boost::bind(&ObjectRecorder::recordingChanged, this));
+
+	Lock lock(this);
+
+	writer.close();
+}
+
+void ObjectRecorder::recordingChanged()
+{
+	Lock lock(this);
+
+	openRecordFile();
+}
+
+void ObjectRecorder::openRecordFile()
+{
+	writer.close();
+
+	if (!recording || recordFile.getValue().empty()) {
+		return;
+	}
+
+	try {
+		writer.open(filesystem::toData(recordFile));
+		LOG4CPLUS_INFO(logger, "Recording objects to " << filesystem::toData(recordFile).string());
+	} catch (ObjectStreamError& e) {
+		LOG4CPLUS_ERROR(logger, e.what());
+	}
+}
+
+static bool __registered = registerNodeType<ObjectRecorder>();
@@ -0,0 +1,329 @@
+/*
+ * ObjectStream.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/nodes/ObjectStream.h"
+#include "actracktive/processing/nodes/tracking/FingerDetector.h"
+#include "actracktive/processing/nodes/tracking/FiducialDetector.h"
+#include <algorithm>
+#include <boost/format.hpp>
+
+/*
+ * File layout (all values in host byte order):
+ *
+ *   header: magic "AOBJ", uint32 version
+ *   frame:  int64 time, 2 x float64 bounds min and max, uint32 object count,
+ *           objects
+ *   object: uint8 kind, uint8 state, uint32 id, uint32 object id,
+ *           int64 time, int64 previous time, int64 creation time,
+ *           2 x float64 position, previous position, velocity, acceleration,
+ *           uint32 frames lost, uint32 outline size, 2 x float32 per point,
+ *           fiducials only: 4 x float64 angle, previous angle, rotation
+ *           velocity and rotation acceleration
+ *
+ * Times are stored as microseconds since the epoch.
+ */
+
+static const char MAGIC[4] = { 'A', 'O', 'B', 'J' };
+static const boost::uint32_t VERSION = 1;
+
+static const boost::uint8_t KIND_FINGER = 1;
+static const boost::uint8_t KIND_FIDUCIAL = 2;
+
+// Outlines are contours of a single blob, larger sizes only occur in corrupt files
+static const boost::uint32_t MAX_OUTLINE_SIZE = 1 << 16;
+
+static const boost::posix_time::ptime EPOCH(boost::gregorian::date(1970, 1, 1));
+
+ObjectStreamWriter::ObjectStreamWriter()
+	: stream()
+{
+}
+
+ObjectStreamWriter::~ObjectStreamWriter()
+{
+	close();
+}
+
+void ObjectStreamWriter::open(const boost::filesystem::path& file) throw (ObjectStreamError)
+{
+	close();
+
+	stream.open(file.string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!stream) {
+		throw ObjectStreamError((boost::format("Could not open '%s' for writing!") % file.string()).str());
+	}
+
+	stream.write(MAGIC, sizeof(MAGIC));
+	writeValue(VERSION);
+}
+
+void ObjectStreamWriter::close()
+{
+	if (stream.is_open()) {
+		stream.close();
+	}
+
+	stream.clear();
+}
+
+bool ObjectStreamWriter::isOpen() const
+{
+	return stream.is_open();
+}
+
+void ObjectStreamWriter::write(const boost::posix_time::ptime& frameTime, const Objects& objects) throw (ObjectStreamError)
+{
+	Objects::Lock lock(objects);
+
+	writeTime(frameTime);
+
+	const Rectangle& bounds = objects.getBounds();
+	writeVector(bounds.getMin());
+	writeVector(bounds.getMax());
+
+	writeValue(boost::uint32_t(objects.getSize()));
+	for (Objects::ConstIterator object = objects.begin(); object != objects.end(); ++object) {
+		writeObject(**object);
+	}
+
+	if (!stream) {
+		throw ObjectStreamError("Writing objects failed!");
+	}
+}
+
+void ObjectStreamWriter::writeObject(const Object& object)
+{
+	const Fiducial* fiducial = dynamic_cast<const Fiducial*>(&object);
+
+	writeValue(fiducial != NULL ? KIND_FIDUCIAL : KIND_FINGER);
+	writeValue(boost::uint8_t(object.state));
+	writeValue(boost::uint32_t(object.id));
+	writeValue(boost::uint32_t(object.objectId));
+	writeTime(object.time);
+	writeTime(object.previousTime);
+	writeTime(object.creationTime);
+	writeVector(object.position);
+	writeVector(object.previousPosition);
+	writeVector(object.velocity);
+	writeVector(object.acceleration);
+	writeValue(boost::uint32_t(object.framesLost));
+
+	const std::vector<Vector2D>& outline = object.getOutline();
+	writeValue(boost::uint32_t(outline.size()));
+	for (std::vector<Vector2D>::const_iterator point = outline.begin(); point != outline.end(); ++point) {
+		writeValue(float(point->x));
+		writeValue(float(point->y));
+	}
+
+	if (fiducial != NULL) {
+		writeValue(fiducial->angle);
+		writeValue(fiducial->previousAngle);
+		writeValue(fiducial->rotationVelocity);
+		writeValue(fiducial->rotationAcceleration);
+	}
+}
+
+template<typename T>
+void ObjectStreamWriter::writeValue(const T& value)
+{
+	stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void ObjectStreamWriter::writeTime(const boost::posix_time::ptime& time)
+{
+	boost::int64_t microseconds = time.is_special() ? 0 : (time - EPOCH).total_microseconds();
+	writeValue(microseconds);
+}
+
+void ObjectStreamWriter::writeVector(const Vector2D& vector)
+{
+	writeValue(vector.x);
+	writeValue(vector.y);
+}
+
+ObjectStreamReader::ObjectStreamReader()
+	: stream(), firstFrame()
+{
+}
+
+ObjectStreamReader::~ObjectStreamReader()
+{
+	close();
+}
+
+void ObjectStreamReader::open(const boost::filesystem::path& file) throw (ObjectStreamError)
+{
+	close();
+
+	stream.open(file.string().c_str(), std::ios::in | std::ios::binary);
+	if (!stream) {
+		throw ObjectStreamError((boost::format("Could not open '%s' for reading!") % file.string()).str());
+	}
+
+	char magic[sizeof(MAGIC)];
+	stream.read(magic, sizeof(magic));
+	boost::uint32_t version = readValue<boost::uint32_t>();
+
+	if (!stream || !std::equal(magic, magic + sizeof(magic), MAGIC)) {
+		close();
+		throw ObjectStreamError((boost::format("'%s' is not an object stream!") % file.string()).str());
+	}
+
+	if (version != VERSION) {
+		close();
+		throw ObjectStreamError((boost::format("Unsupported object stream version %i in '%s'!") % version % file.string()).str());
+	}
+
+	firstFrame = stream.tellg();
+}
+
+void ObjectStreamReader::close()
+{
+	if (stream.is_open()) {
+		stream.close();
+	}
+
+	stream.clear();
+}
+
+bool ObjectStreamReader::isOpen() const
+{
+	return stream.is_open();
+}
+
+void ObjectStreamReader::rewind()
+{
+	if (stream.is_open()) {
+		stream.clear();
+		stream.seekg(firstFrame);
+	}
+}
+
+bool ObjectStreamReader::read(boost::posix_time::ptime& frameTime, Objects& destination,
+	const boost::posix_time::time_duration& timeOffset) throw (ObjectStreamError)
+{
+	Objects::Lock lock(destination);
+
+	destination.clear();
+
+	if (!stream.is_open() || stream.peek() == std::char_traits<char>::eof()) {
+		return false;
+	}
+
+	frameTime = readTime(timeOffset);
+
+	Vector2D boundsMin = readVector();
+	Vector2D boundsMax = readVector();
+
+	boost::uint32_t count = readValue<boost::uint32_t>();
+	for (boost::uint32_t i = 0; i < count && stream; ++i) {
+		Object* object = readObject(timeOffset);
+		if (object != NULL) {
+			destination.add(object);
+		}
+	}
+
+	if (!stream) {
+		destination.clear();
+		throw ObjectStreamError("Object stream is truncated or corrupt!");
+	}
+
+	destination.setBounds(Rectangle(boundsMin, boundsMax));
+
+	return true;
+}
+
+Object* ObjectStreamReader::readObject(const boost::posix_time::time_duration& timeOffset)
+{
+	boost::uint8_t kind = readValue<boost::uint8_t>();
+	boost::uint8_t state = readValue<boost::uint8_t>();
+	unsigned int id = readValue<boost::uint32_t>();
+	unsigned int objectId = readValue<boost::uint32_t>();
+	boost::posix_time::ptime time = readTime(timeOffset);
+	boost::posix_time::ptime previousTime = readTime(timeOffset);
+	boost::posix_time::ptime creationTime = readTime(timeOffset);
+	Vector2D position = readVector();
+	Vector2D previousPosition = readVector();
+	Vector2D velocity = readVector();
+	Vector2D acceleration = readVector();
+	unsigned int framesLost = readValue<boost::uint32_t>();
+
+	boost::uint32_t outlineSize = readValue<boost::uint32_t>();
+	if (!stream || outlineSize > MAX_OUTLINE_SIZE) {
+		stream.setstate(std::ios::failbit);
+		return NULL;
+	}
+
+	std::vector<Vector2D> outline;
+	outline.reserve(outlineSize);
+	for (boost::uint32_t i = 0; i < outlineSize && stream; ++i) {
+		float px = readValue<float>();
+		float py = readValue<float>();
+		outline.push_back(Vector2D(px, py));
+	}
+
+	Object* object = NULL;
+	if (kind == KIND_FIDUCIAL) {
+		Fiducial* fiducial = new Fiducial(id, objectId, time, position, 0, outline);
+		fiducial->angle = readValue<double>();
+		fiducial->previousAngle = readValue<double>();
+		fiducial->rotationVelocity = readValue<double>();
+		fiducial->rotationAcceleration = readValue<double>();
+		object = fiducial;
+	} else if (kind == KIND_FINGER) {
+		object = new Finger(id, time, position, outline);
+		object->objectId = objectId;
+	} else {
+		stream.setstate(std::ios::failbit);
+		return NULL;
+	}
+
+	object->previousTime = previousTime;
+	object->creationTime = creationTime;
+	object->previousPosition = previousPosition;
+	object->velocity = velocity;
+	object->acceleration = acceleration;
+	object->framesLost = framesLost;
+	object->state = Object::State(std::min<unsigned int>(state, Object::DEAD));
+
+	return object;
+}
+
+template<typename T>
+T ObjectStreamReader::readValue()
+{
+	T value = T();
+	stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+	return value;
+}
+
+boost::posix_time::ptime ObjectStreamReader::readTime(const boost::posix_time::time_duration& timeOffset)
+{
+	boost::int64_t microseconds = readValue<boost::int64_t>();
+	return EPOCH + boost::posix_time::microseconds(microseconds) + timeOffset;
+}
+
+Vector2D ObjectStreamReader::readVector()
+{
+	double x = readValue<double>();
+	double y = readValue<double>();
+	return Vector2D(x, y);
+}
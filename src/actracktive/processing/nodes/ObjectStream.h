@@ -0,0 +1,105 @@
+/*
+ * ObjectStream.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBJECTSTREAM_H_
+#define OBJECTSTREAM_H_
+
+#include "actracktive/processing/nodes/ObjectSource.h"
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+class ObjectStreamError: public std::runtime_error
+{
+public:
+	ObjectStreamError(std::string msg = "ObjectStreamError")
+		: runtime_error(msg)
+	{
+	}
+
+};
+
+/**
+ * Writes frames of objects to a compact binary file. Each frame consists of
+ * the frame time, the bounds and the complete state of all objects (including
+ * tracking state, velocity and outline), so a replay is indistinguishable
+ * from the original stream for all consumers.
+ */
+class ObjectStreamWriter
+{
+public:
+	ObjectStreamWriter();
+	~ObjectStreamWriter();
+
+	void open(const boost::filesystem::path& file) throw (ObjectStreamError);
+	void close();
+	bool isOpen() const;
+
+	void write(const boost::posix_time::ptime& frameTime, const Objects& objects) throw (ObjectStreamError);
+
+private:
+	std::ofstream stream;
+
+	void writeObject(const Object& object);
+
+	template<typename T>
+	void writeValue(const T& value);
+	void writeTime(const boost::posix_time::ptime& time);
+	void writeVector(const Vector2D& vector);
+
+};
+
+class ObjectStreamReader
+{
+public:
+	ObjectStreamReader();
+	~ObjectStreamReader();
+
+	void open(const boost::filesystem::path& file) throw (ObjectStreamError);
+	void close();
+	bool isOpen() const;
+	void rewind();
+
+	/**
+	 * Reads the next frame into destination (clearing it before) and shifts
+	 * all times by timeOffset. Returns false if the end of the stream has been
+	 * reached.
+	 */
+	bool read(boost::posix_time::ptime& frameTime, Objects& destination,
+		const boost::posix_time::time_duration& timeOffset = boost::posix_time::time_duration(0, 0, 0, 0)) throw (ObjectStreamError);
+
+private:
+	std::ifstream stream;
+	std::streampos firstFrame;
+
+	Object* readObject(const boost::posix_time::time_duration& timeOffset);
+
+	template<typename T>
+	T readValue();
+	boost::posix_time::ptime readTime(const boost::posix_time::time_duration& timeOffset);
+	Vector2D readVector();
+
+};
+
+#endif
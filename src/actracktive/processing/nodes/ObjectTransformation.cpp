@@ -42,12 +42,27 @@ ObjectTransformation::ObjectTransformation(const std::string& id, const std::str
 	connections.add(transformer);
 }
 
+/*
+ * Copying the objects is cheap, as their outlines are shared with the source.
+ * Only the positions are transformed here, the outlines are transformed by
+ * the objects once they are requested.
+ */
 void ObjectTransformation::fetch(Objects& destination)
 {
 	if (!source) {
 		return;
 	}
 
+	// A single snapshot per step, so all objects are transformed consistently
+	// even if the transformer changes meanwhile
+	bool transforming = enabled && transformer;
+	Transformer::Snapshot::Ptr snapshot;
+	Rectangle bounds;
+	if (transforming) {
+		snapshot = transformer->getSnapshot();
+		bounds = transformer->getOutputBounds();
+	}
+
 	{
 		Lock lock(source);
 
@@ -58,12 +73,14 @@ void ObjectTransformation::fetch(Objects& destination)
 		destination = objects;
 	}
 
-	if (enabled && transformer) {
-		Transformer& t = *transformer;
+	if (snapshot) {
 		for (Objects::Iterator object = destination.begin(); object != destination.end(); ++object) {
-			(*object)->transform(t);
+			(*object)->transform(snapshot);
 		}
-		destination.setBounds(t.getOutputBounds());
+	}
+
+	if (transforming) {
+		destination.setBounds(bounds);
 	}
 }
 
@@ -24,6 +24,7 @@
 
 #include "actracktive/processing/Node.h"
 #include <boost/signals2/signal.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 template<typename T>
 struct DataAllocator
@@ -67,7 +68,10 @@ public:
 
 		if (isRunning()) {
 			if (!fetched) {
-				fetch(data);
+				if (fetchDue) {
+					fetch(data);
+					++sequenceNumber;
+				}
 				fetched = true;
 
 				sourceDataUpdated(*this);
@@ -84,6 +88,46 @@ public:
 		return data;
 	}
 
+	/**
+	 * Returns the number of times new data has been fetched. If the source
+	 * skips a step due to its rate settings, it republishes its previous data
+	 * and the number stays the same, so consumers can detect reused data.
+	 */
+	unsigned long getSequenceNumber() const
+	{
+		Lock lock(this);
+
+		return sequenceNumber;
+	}
+
+	/**
+	 * Returns true if the source does not fetch new data in every step.
+	 */
+	bool isRateLimited() const
+	{
+		return rateDivisor > 1 || maxRate > 0;
+	}
+
+	/**
+	 * A running source is idle in a step in which its fetch is not due due to
+	 * its rate settings (decided by beforeStep()).
+	 */
+	virtual bool isIdle() const
+	{
+		Lock lock(this);
+
+		return isRunning() && !fetchDue;
+	}
+
+	/**
+	 * Unless its data updates are observed (e.g. by a preview), a source is
+	 * only stepped for its consumers.
+	 */
+	virtual bool isOnlyNeededByConsumers() const
+	{
+		return sourceDataUpdated.empty();
+	}
+
 	virtual bool hasData()
 	{
 		return isRunning();
@@ -101,6 +145,9 @@ public:
 		Lock lock(this);
 
 		dataAllocator.initialize(data);
+		fetchDue = true;
+		stepsSinceFetch = 0;
+		lastFetchTime = boost::posix_time::ptime();
 		sourceDataUpdated(*this);
 	}
 
@@ -111,6 +158,7 @@ public:
 		Lock lock(this);
 
 		fetched = false;
+		fetchDue = isFetchDue();
 	}
 
 	virtual void step()
@@ -132,17 +180,53 @@ public:
 
 protected:
 	Source(const std::string& id, const std::string& name)
-		: Node(id, name), data(), dataAllocator(), fetched(false)
+		: Node(id, name), rateDivisor("rateDivisor", "Rate Divisor", mutex, 1, Constraint<unsigned int>(1, 60)),
+			maxRate("maxRate", "Max. Rate (Hz)", mutex, 0, Constraint<double>(0, 200)), data(), dataAllocator(), fetched(false),
+			fetchDue(true), sequenceNumber(0), stepsSinceFetch(0), lastFetchTime()
 	{
+		settings.add(rateDivisor);
+		settings.add(maxRate);
 	}
 
 	virtual void fetch(T& destination) = 0;
 
 private:
+	ValueProperty<unsigned int> rateDivisor;
+	ValueProperty<double> maxRate;
+
 	T data;
 	DataAllocator<T> dataAllocator;
 
 	bool fetched;
+	bool fetchDue;
+	unsigned long sequenceNumber;
+	unsigned int stepsSinceFetch;
+	boost::posix_time::ptime lastFetchTime;
+
+	/*
+	 * New data is fetched only every rateDivisor-th step and at most maxRate
+	 * times per second (0 disables the limit). This is decided once per step
+	 * by beforeStep(), so that the processing graph knows which sources are
+	 * idle before stepping any node, and can leave out the nodes upstream
+	 * which only idle nodes consume (see ProcessingGraph::step()).
+	 */
+	bool isFetchDue()
+	{
+		boost::posix_time::ptime now(boost::posix_time::microsec_clock::local_time());
+
+		bool due = lastFetchTime.is_not_a_date_time()
+			|| (stepsSinceFetch + 1 >= rateDivisor
+				&& (maxRate <= 0 || (now - lastFetchTime).total_microseconds() >= 1000000.0 / maxRate));
+
+		if (due) {
+			stepsSinceFetch = 0;
+			lastFetchTime = now;
+		} else {
+			++stepsSinceFetch;
+		}
+
+		return due;
+	}
 
 };
 
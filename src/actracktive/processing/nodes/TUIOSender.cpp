@@ -23,6 +23,7 @@
 #include "actracktive/processing/NodeFactory.h"
 #include "actracktive/util/NetUtil.h"
 #include "actracktive/AppInfo.h"
+#include "actracktive/Filesystem.h"
 #include "ip/UdpSocket.h"
 #include "osc/OscOutboundPacketStream.h"
 #include <boost/format.hpp>
@@ -83,14 +84,15 @@ const Node::Type& TUIOSender::getType() const
 TUIOSender::TUIOSender(const std::string& id, const std::string& name)
 	: Node(id, name), enabled("enabled", "Enabled", mutex, true), oscAddress("oscAddress", "OSC Address", mutex, "/tuio"),
 		host("host", "Host", mutex, "127.0.0.1"), port("port", "Port", mutex, 3333, Constraint<unsigned short>(0, 65535)),
-		idleRate("idleRate", "Idle Rate", mutex, 10, Constraint<unsigned int>(1, 60)), source("source", "Source", mutex), socket(),
-		sourceId(), frameSequenceNumber(0), idleCount(0)
+		idleRate("idleRate", "Idle Rate", mutex, 10, Constraint<unsigned int>(1, 60)), captureFile("captureFile", "Capture File", mutex),
+		source("source", "Source", mutex), socket(), capture(), sourceId(), frameSequenceNumber(0), idleCount(0)
 {
 	settings.add(enabled);
 	settings.add(oscAddress);
 	settings.add(host);
 	settings.add(port);
 	settings.add(idleRate);
+	settings.add(captureFile);
 	connections.add(source);
 }
 
@@ -104,9 +106,11 @@ void TUIOSender::start()
 	sourceId.setVersion(AppInfo::VERSION);
 
 	setupSocket();
+	setupCapture();
 
 	host.onChange.connect(boost::bind(&TUIOSender::setupSocket, this));
 	port.onChange.connect(boost::bind(&TUIOSender::setupSocket, this));
+	captureFile.onChange.connect(boost::bind(&TUIOSender::setupCapture, this));
 }
 
 void TUIOSender::step()
@@ -141,6 +145,12 @@ void TUIOSender::stop()
 
 	host.onChange.disconnect(boost::bind(&TUIOSender::setupSocket, this));
 	port.onChange.disconnect(boost::bind(&TUIOSender::setupSocket, this));
+	captureFile.onChange.disconnect(boost::bind(&TUIOSender::setupCapture, this));
+
+	Mutex::scoped_lock lock(mutex);
+
+	capture.close();
+	capture.clear();
 }
 
 void TUIOSender::setupSocket()
@@ -162,11 +172,39 @@ void TUIOSender::setupSocket()
 	}
 }
 
+bool TUIOSender::isCapturing() const
+{
+	Mutex::scoped_lock lock(mutex);
+
+	return capture.is_open();
+}
+
+void TUIOSender::setupCapture()
+{
+	Mutex::scoped_lock lock(mutex);
+
+	capture.close();
+	capture.clear();
+
+	if (captureFile.getValue().empty()) {
+		return;
+	}
+
+	capture.open(filesystem::toData(captureFile).string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (capture) {
+		LOG4CPLUS_INFO(logger, "Capturing TUIO packets to " << filesystem::toData(captureFile).string() << " instead of sending them");
+	} else {
+		capture.close();
+		capture.clear();
+		LOG4CPLUS_ERROR(logger, "Could not open capture file " << filesystem::toData(captureFile).string());
+	}
+}
+
 void TUIOSender::send(const Objects& objects)
 {
 	Mutex::scoped_lock lock(mutex);
 
-	if (!socket) {
+	if (!socket && !capture.is_open()) {
 		return;
 	}
 
@@ -197,7 +235,16 @@ void TUIOSender::send(const Objects& objects)
 
 		p << osc::EndBundle;
 
-		socket->Send(p.Data(), p.Size());
+		if (capture.is_open()) {
+			// Packets are framed like OSC packets in stream based transports:
+			// prefixed by their size as big-endian 32 bit integer.
+			unsigned long size = p.Size();
+			char sizePrefix[4] = { char(size >> 24), char(size >> 16), char(size >> 8), char(size) };
+			capture.write(sizePrefix, sizeof(sizePrefix));
+			capture.write(p.Data(), p.Size());
+		} else {
+			socket->Send(p.Data(), p.Size());
+		}
 	} catch (osc::OutOfBufferMemoryException& e) {
 		LOG4CPLUS_ERROR(logger, "Sending objects failed, too many objects to send (" << objects.getSize() << ")");
 	}
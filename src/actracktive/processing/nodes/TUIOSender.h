@@ -26,6 +26,7 @@
 #include "actracktive/processing/nodes/ObjectSource.h"
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <fstream>
 #include <string>
 
 class TUIOSourceId
@@ -65,21 +66,30 @@ public:
 	virtual void step();
 	virtual void stop();
 
+	/**
+	 * Returns true if packets are written to the capture file instead of being
+	 * sent over the network.
+	 */
+	bool isCapturing() const;
+
 private:
 	ValueProperty<bool> enabled;
 	ValueProperty<std::string> oscAddress;
 	ValueProperty<std::string> host;
 	ValueProperty<unsigned short> port;
 	ValueProperty<unsigned int> idleRate;
+	ValueProperty<boost::filesystem::path> captureFile;
 	TypedNodeConnection<ObjectSource> source;
 
 	boost::scoped_ptr<UdpSocket> socket;
+	std::ofstream capture;
 
 	TUIOSourceId sourceId;
 	unsigned int frameSequenceNumber;
 	unsigned int idleCount;
 
 	void setupSocket();
+	void setupCapture();
 	void send(const Objects& objects);
 
 };
@@ -21,6 +21,17 @@
 
 #include "actracktive/processing/nodes/Transformer.h"
 
+Transformer::Snapshot::~Snapshot()
+{
+}
+
+void Transformer::Snapshot::transformPoints(const Vector2D* input, Vector2D* output, std::size_t count) const
+{
+	for (std::size_t i = 0; i < count; ++i) {
+		output[i] = transform(input[i]);
+	}
+}
+
 const Node::Type& Transformer::TYPE()
 {
 	static const Node::Type type = Node::Type::of<Transformer>("Transformer", Node::TYPE());
@@ -36,3 +47,10 @@ Transformer::Transformer(const std::string& id, const std::string& name)
 	: Node(id, name)
 {
 }
+
+void Transformer::transformPoints(const Vector2D* input, Vector2D* output, std::size_t count) const
+{
+	for (std::size_t i = 0; i < count; ++i) {
+		output[i] = transform(input[i]);
+	}
+}
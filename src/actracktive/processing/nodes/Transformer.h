@@ -24,14 +24,50 @@
 
 #include "actracktive/processing/Node.h"
 #include "actracktive/util/Geometry.h"
+#include <cstddef>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 
 class Transformer: public Node
 {
 public:
+	/**
+	 * The state of a transformer at one point in time. Snapshots are
+	 * immutable, so they transform consistently (and without locking) even
+	 * while the transformer is reconfigured, and may be kept as long as
+	 * needed.
+	 */
+	class Snapshot: private boost::noncopyable
+	{
+	public:
+		typedef boost::shared_ptr<const Snapshot> Ptr;
+
+		virtual ~Snapshot();
+
+		virtual Vector2D transform(const Vector2D& point) const = 0;
+		virtual void transformPoints(const Vector2D* input, Vector2D* output, std::size_t count) const;
+		virtual double transformAngle(const double& angle) const = 0;
+
+	};
+
 	static const Node::Type& TYPE();
 	const Node::Type& getType() const;
 
+	/**
+	 * Returns the current state of the transformer, or an empty pointer if it
+	 * does not change points at all (e.g. because it is disabled).
+	 */
+	virtual Snapshot::Ptr getSnapshot() const = 0;
+
 	virtual Vector2D transform(const Vector2D& point) const = 0;
+
+	/**
+	 * Transforms count points from input to output, which may be the same
+	 * array. The default implementation transforms each point on its own,
+	 * implementations should override it to avoid the per point overhead.
+	 */
+	virtual void transformPoints(const Vector2D* input, Vector2D* output, std::size_t count) const;
+
 	virtual Rectangle transform(const Rectangle& rectangle) const = 0;
 	virtual double transformAngle(const double& angle) const = 0;
 
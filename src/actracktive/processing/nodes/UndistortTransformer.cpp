@@ -0,0 +1,263 @@
+/*
+ * UndistortTransformer.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/nodes/UndistortTransformer.h"
+#include "actracktive/processing/NodeFactory.h"
+#include "actracktive/util/Utils.h"
+#include <algorithm>
+#include <cmath>
+#include <boost/bind.hpp>
+
+const Node::Type& UndistortTransformer::TYPE()
+{
+	static const Node::Type type = Node::Type::of<UndistortTransformer>("UndistortTransformer", Transformer::TYPE());
+	return type;
+}
+
+const Node::Type& UndistortTransformer::getType() const
+{
+	return TYPE();
+}
+
+/*
+ * The undistorted positions of the grid points, interpolated bilinearly.
+ */
+class UndistortSnapshot: public Transformer::Snapshot
+{
+public:
+	/*
+	 * Takes over the contents of lookup.
+	 */
+	UndistortSnapshot(std::vector<Vector2D>& lookup, unsigned int columns, unsigned int rows, unsigned int spacing)
+		: lookup(), lookupColumns(columns), lookupRows(rows), lookupSpacing(spacing)
+	{
+		this->lookup.swap(lookup);
+	}
+
+	virtual Vector2D transform(const Vector2D& point) const
+	{
+		// Points outside of the grid are extrapolated from the closest cell
+		double gridX = point.x / lookupSpacing;
+		double gridY = point.y / lookupSpacing;
+		int column = util::clamp(int(std::floor(gridX)), 0, int(lookupColumns) - 2);
+		int row = util::clamp(int(std::floor(gridY)), 0, int(lookupRows) - 2);
+		double xBlend = gridX - column;
+		double yBlend = gridY - row;
+
+		const Vector2D& a = lookup[row * lookupColumns + column];
+		const Vector2D& b = lookup[row * lookupColumns + column + 1];
+		const Vector2D& c = lookup[(row + 1) * lookupColumns + column];
+		const Vector2D& d = lookup[(row + 1) * lookupColumns + column + 1];
+
+		return a * ((1 - xBlend) * (1 - yBlend)) + b * (xBlend * (1 - yBlend)) + c * ((1 - xBlend) * yBlend) + d * (xBlend * yBlend);
+	}
+
+	virtual double transformAngle(const double& angle) const
+	{
+		return angle;
+	}
+
+private:
+	std::vector<Vector2D> lookup;
+	unsigned int lookupColumns;
+	unsigned int lookupRows;
+	unsigned int lookupSpacing;
+
+};
+
+UndistortTransformer::UndistortTransformer(const std::string& id, const std::string& name)
+	: Transformer(id, name), enabled("enabled", "Enabled", mutex, true),
+		imageWidth("imageWidth", "Image Width", mutex, 640, Constraint<unsigned int>(1, 4096)),
+		imageHeight("imageHeight", "Image Height", mutex, 480, Constraint<unsigned int>(1, 4096)),
+		gridSpacing("gridSpacing", "Grid Spacing", mutex, 8, Constraint<unsigned int>(1, 64)), calibration("calibration", "Calibration", mutex),
+		connectedFilter(NULL), lookupSize(0, 0), outputBounds(0, 0, 640, 480), lookup()
+{
+	settings.add(enabled);
+	settings.add(imageWidth);
+	settings.add(imageHeight);
+	settings.add(gridSpacing);
+	connections.add(calibration);
+}
+
+Vector2D UndistortTransformer::transform(const Vector2D& point) const
+{
+	Snapshot::Ptr current = getSnapshot();
+	return current ? current->transform(point) : point;
+}
+
+void UndistortTransformer::transformPoints(const Vector2D* input, Vector2D* output, std::size_t count) const
+{
+	Snapshot::Ptr current = getSnapshot();
+	if (current) {
+		current->transformPoints(input, output, count);
+	} else if (input != output) {
+		std::copy(input, input + count, output);
+	}
+}
+
+Rectangle UndistortTransformer::transform(const Rectangle& rectangle) const
+{
+	return Rectangle(transform(rectangle.getMin()), transform(rectangle.getMax()));
+}
+
+double UndistortTransformer::transformAngle(const double& angle) const
+{
+	return angle;
+}
+
+const Rectangle& UndistortTransformer::getOutputBounds() const
+{
+	return outputBounds;
+}
+
+Transformer::Snapshot::Ptr UndistortTransformer::getSnapshot() const
+{
+	Lock lock(this);
+
+	return enabled ? lookup : Snapshot::Ptr();
+}
+
+void UndistortTransformer::start()
+{
+	Transformer::start();
+
+	imageWidth.onChange.connect(boost::bind(&UndistortTransformer::updateLookup, this));
+	imageHeight.onChange.connect(boost::bind(&UndistortTransformer::updateLookup, this));
+	gridSpacing.onChange.connect(boost::bind(&UndistortTransformer::updateLookup, this));
+
+	connectFilter(calibration);
+
+	updateLookup();
+}
+
+void UndistortTransformer::step()
+{
+	Transformer::step();
+
+	// The calibration may be connected to another filter while running, and
+	// the size of the images is only known once they are processed. Both are
+	// checked here instead of on their signals, as the lookup must not be
+	// updated while this node is locked (see updateLookup()).
+	UndistortRectifyFilter* filter = calibration;
+	if (filter != connectedFilter) {
+		connectFilter(filter);
+		updateLookup();
+	} else if (getImageSize() != lookupSize) {
+		updateLookup();
+	}
+}
+
+void UndistortTransformer::stop()
+{
+	Transformer::stop();
+
+	imageWidth.onChange.disconnect(boost::bind(&UndistortTransformer::updateLookup, this));
+	imageHeight.onChange.disconnect(boost::bind(&UndistortTransformer::updateLookup, this));
+	gridSpacing.onChange.disconnect(boost::bind(&UndistortTransformer::updateLookup, this));
+
+	connectFilter(NULL);
+}
+
+void UndistortTransformer::connectFilter(UndistortRectifyFilter* filter)
+{
+	if (connectedFilter != NULL) {
+		connectedFilter->calibrationUpdated.disconnect(boost::bind(&UndistortTransformer::updateLookup, this));
+	}
+
+	connectedFilter = filter;
+
+	if (connectedFilter != NULL) {
+		connectedFilter->calibrationUpdated.connect(boost::bind(&UndistortTransformer::updateLookup, this));
+	}
+}
+
+cv::Size UndistortTransformer::getImageSize() const
+{
+	UndistortRectifyFilter* filter = calibration;
+	if (filter != NULL) {
+		cv::Size size = filter->getImageSize();
+		if (size.width > 0 && size.height > 0) {
+			return size;
+		}
+	}
+
+	return cv::Size(imageWidth, imageHeight);
+}
+
+void UndistortTransformer::updateLookup()
+{
+	cv::Size size = getImageSize();
+	unsigned int width = size.width;
+	unsigned int height = size.height;
+	unsigned int spacing = gridSpacing;
+
+	// The grid covers the whole image, including its last row and column
+	unsigned int columns = (width + spacing - 1) / spacing + 1;
+	unsigned int rows = (height + spacing - 1) / spacing + 1;
+
+	std::vector<cv::Point2d> distorted;
+	distorted.reserve(columns * rows);
+	for (unsigned int row = 0; row < rows; ++row) {
+		for (unsigned int column = 0; column < columns; ++column) {
+			distorted.push_back(cv::Point2d(column * spacing, row * spacing));
+		}
+	}
+
+	std::vector<Vector2D> undistorted;
+
+	// The calibration is copied first, so that the filter is not locked
+	// while this node is (the filter notifies about updates while locked).
+	UndistortRectifyFilter* filter = calibration;
+	if (filter != NULL) {
+		cv::Mat intrinsicMatrix, distortionCoefficients, rotationVector, newIntrinsicMatrix;
+		{
+			Lock filterLock(filter);
+			intrinsicMatrix = filter->getIntrinsicMatrix().clone();
+			distortionCoefficients = filter->getDistortionCoefficients().clone();
+			rotationVector = filter->getRotationVector().clone();
+			newIntrinsicMatrix = filter->getNewIntrinsicMatrix();
+		}
+
+		cv::Mat rotationMatrix;
+		cv::Rodrigues(rotationVector, rotationMatrix);
+
+		std::vector<cv::Point2d> points;
+		cv::undistortPoints(distorted, points, intrinsicMatrix, distortionCoefficients, rotationMatrix, newIntrinsicMatrix);
+
+		undistorted.reserve(points.size());
+		for (std::vector<cv::Point2d>::const_iterator point = points.begin(); point != points.end(); ++point) {
+			undistorted.push_back(Vector2D(point->x, point->y));
+		}
+	}
+
+	Snapshot::Ptr next;
+	if (!undistorted.empty()) {
+		next.reset(new UndistortSnapshot(undistorted, columns, rows, spacing));
+	}
+
+	Lock lock(this);
+
+	lookup = next;
+	lookupSize = size;
+	outputBounds = Rectangle(0, 0, width, height);
+}
+
+static bool __registered = registerNodeType<UndistortTransformer>();
@@ -0,0 +1,83 @@
+/*
+ * UndistortTransformer.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNDISTORTTRANSFORMER_H_
+#define UNDISTORTTRANSFORMER_H_
+
+#include "actracktive/processing/nodes/Transformer.h"
+#include "actracktive/processing/nodes/sources/filter/UndistortRectifyFilter.h"
+#include "actracktive/util/Geometry.h"
+#include <vector>
+
+/**
+ * Undistorts and rectifies points, using the calibration of the connected
+ * UndistortRectifyFilter. This allows detecting objects in the raw image and
+ * undistorting only their positions and outlines (by an ObjectTransformation),
+ * instead of remapping every pixel of every image. The filter itself can be
+ * disabled or left out of the image processing chain.
+ *
+ * The undistorted positions are precomputed for a sparse grid covering the
+ * image and interpolated bilinearly in between. The grid is sized for the
+ * images the filter undistorts, the image width and height settings are only
+ * used as long as it has not seen any. The lookup is replaced as a
+ * whole when it changes, so snapshots of it can be shared without copying.
+ */
+class UndistortTransformer: public Transformer
+{
+public:
+	static const Node::Type& TYPE();
+	const Node::Type& getType() const;
+
+	UndistortTransformer(const std::string& id, const std::string& name = "Undistort Transformer");
+
+	virtual Vector2D transform(const Vector2D& point) const;
+	virtual void transformPoints(const Vector2D* input, Vector2D* output, std::size_t count) const;
+	virtual Rectangle transform(const Rectangle& rectangle) const;
+	virtual double transformAngle(const double& angle) const;
+
+	virtual const Rectangle& getOutputBounds() const;
+
+	virtual Snapshot::Ptr getSnapshot() const;
+
+	virtual void start();
+	virtual void step();
+	virtual void stop();
+
+private:
+	ValueProperty<bool> enabled;
+	ValueProperty<unsigned int> imageWidth;
+	ValueProperty<unsigned int> imageHeight;
+	ValueProperty<unsigned int> gridSpacing;
+	TypedNodeConnection<UndistortRectifyFilter> calibration;
+
+	UndistortRectifyFilter* connectedFilter;
+	cv::Size lookupSize;
+	Rectangle outputBounds;
+
+	Snapshot::Ptr lookup;
+
+	void connectFilter(UndistortRectifyFilter* filter);
+	cv::Size getImageSize() const;
+	void updateLookup();
+
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * ChangeDetector.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/nodes/sources/ChangeDetector.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Returns the sum of the differences exceeding noise of the bytes
+ * [begin, end) of current and reference.
+ */
+static unsigned long compareBytes(const uchar* current, const uchar* reference, int begin, int end, uchar noise)
+{
+	unsigned long sum = 0;
+	int i = begin;
+
+#ifdef __SSE2__
+	const __m128i noiseVector = _mm_set1_epi8(char(noise));
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sums = _mm_setzero_si128();
+
+	for (; i + 16 <= end; i += 16) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(reference + i));
+		__m128i difference = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+		sums = _mm_add_epi64(sums, _mm_sad_epu8(_mm_subs_epu8(difference, noiseVector), zero));
+	}
+
+	sum += (unsigned long) _mm_cvtsi128_si32(sums) + (unsigned long) _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+#endif
+
+	for (; i < end; ++i) {
+		int difference = std::abs(int(current[i]) - int(reference[i]));
+		sum += std::max(difference - int(noise), 0);
+	}
+
+	return sum;
+}
+
+ChangeDetector::ChangeDetector()
+	: reference()
+{
+}
+
+void ChangeDetector::detect(const cv::Mat& image, int tileSize, unsigned int noise, unsigned long threshold, DirtyTiles& changes)
+{
+	changes.reset(image.size(), tileSize, true);
+
+	if (image.depth() != CV_8U) {
+		reference.release();
+		return;
+	}
+
+	if (reference.size() != image.size() || reference.type() != image.type()) {
+		image.copyTo(reference);
+		return;
+	}
+
+	const int channels = image.channels();
+	const uchar noiseByte = uchar(std::min(noise, 255u));
+	std::vector<unsigned long> sums(changes.getColumns());
+
+	for (int row = 0; row < changes.getRows(); ++row) {
+		std::fill(sums.begin(), sums.end(), 0);
+
+		cv::Rect band = changes.getTile(0, row);
+		for (int y = band.y; y < band.y + band.height; ++y) {
+			const uchar* currentRow = image.ptr<uchar>(y);
+			const uchar* referenceRow = reference.ptr<uchar>(y);
+
+			for (int column = 0; column < changes.getColumns(); ++column) {
+				cv::Rect tile = changes.getTile(column, row);
+				sums[column] += compareBytes(currentRow, referenceRow, tile.x * channels, (tile.x + tile.width) * channels, noiseByte);
+			}
+		}
+
+		// Only the changed tiles are taken over, all others keep comparing
+		// against their older reference
+		for (int column = 0; column < changes.getColumns(); ++column) {
+			bool dirty = sums[column] > threshold;
+			changes.setDirty(column, row, dirty);
+
+			if (dirty) {
+				cv::Rect tile = changes.getTile(column, row);
+				cv::Mat target = reference(tile);
+				image(tile).copyTo(target);
+			}
+		}
+	}
+}
+
+void ChangeDetector::reset()
+{
+	reference.release();
+}
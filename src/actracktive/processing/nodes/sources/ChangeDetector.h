@@ -0,0 +1,58 @@
+/*
+ * ChangeDetector.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHANGEDETECTOR_H_
+#define CHANGEDETECTOR_H_
+
+#include "actracktive/processing/nodes/sources/DirtyTiles.h"
+#include "opencv2/opencv.hpp"
+
+/**
+ * Finds the tiles of 8 bit images which changed. Each tile is compared with
+ * a reference, which is only replaced by the tile of the current image once
+ * it is reported as changed. So slow changes (each below the thresholds from
+ * image to image) accumulate until the tile is eventually marked dirty.
+ */
+class ChangeDetector
+{
+public:
+	ChangeDetector();
+
+	/**
+	 * Marks the tiles of changes in which image differs from the reference.
+	 * A tile changes if the sum of all absolute pixel differences exceeding
+	 * noise is larger than threshold. If there is no reference of the same
+	 * size and type, all tiles are marked dirty and image becomes the
+	 * reference. Images of other depths than 8 bit are always dirty.
+	 */
+	void detect(const cv::Mat& image, int tileSize, unsigned int noise, unsigned long threshold, DirtyTiles& changes);
+
+	/**
+	 * Discards the reference, so that the next image is completely dirty.
+	 */
+	void reset();
+
+private:
+	cv::Mat reference;
+
+};
+
+#endif
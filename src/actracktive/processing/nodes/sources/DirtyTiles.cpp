@@ -0,0 +1,116 @@
+/*
+ * DirtyTiles.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/nodes/sources/DirtyTiles.h"
+#include <algorithm>
+
+DirtyTiles::DirtyTiles()
+	: imageSize(0, 0), tileSize(1), columns(0), rows(0), dirty(), sequenceNumber(0)
+{
+}
+
+void DirtyTiles::reset(const cv::Size& imageSize, int tileSize, bool dirty)
+{
+	this->imageSize = imageSize;
+	this->tileSize = std::max(tileSize, 1);
+	columns = (imageSize.width + this->tileSize - 1) / this->tileSize;
+	rows = (imageSize.height + this->tileSize - 1) / this->tileSize;
+
+	this->dirty.assign(columns * rows, dirty ? 1 : 0);
+}
+
+const cv::Size& DirtyTiles::getImageSize() const
+{
+	return imageSize;
+}
+
+int DirtyTiles::getTileSize() const
+{
+	return tileSize;
+}
+
+int DirtyTiles::getColumns() const
+{
+	return columns;
+}
+
+int DirtyTiles::getRows() const
+{
+	return rows;
+}
+
+bool DirtyTiles::isDirty(int column, int row) const
+{
+	return dirty[row * columns + column] != 0;
+}
+
+void DirtyTiles::setDirty(int column, int row, bool dirty)
+{
+	this->dirty[row * columns + column] = dirty ? 1 : 0;
+}
+
+unsigned int DirtyTiles::getDirtyCount() const
+{
+	return std::count(dirty.begin(), dirty.end(), 1);
+}
+
+cv::Rect DirtyTiles::getTile(int column, int row) const
+{
+	int x = column * tileSize;
+	int y = row * tileSize;
+
+	return cv::Rect(x, y, std::min(tileSize, imageSize.width - x), std::min(tileSize, imageSize.height - y));
+}
+
+void DirtyTiles::dilate(int pixels)
+{
+	int radius = (pixels + tileSize - 1) / tileSize;
+	if (radius <= 0) {
+		return;
+	}
+
+	std::vector<unsigned char> dilated(dirty.size(), 0);
+
+	for (int row = 0; row < rows; ++row) {
+		for (int column = 0; column < columns; ++column) {
+			if (!isDirty(column, row)) {
+				continue;
+			}
+
+			for (int y = std::max(row - radius, 0); y <= std::min(row + radius, rows - 1); ++y) {
+				std::fill(dilated.begin() + y * columns + std::max(column - radius, 0),
+					dilated.begin() + y * columns + std::min(column + radius, columns - 1) + 1, 1);
+			}
+		}
+	}
+
+	dirty.swap(dilated);
+}
+
+unsigned long DirtyTiles::getSequenceNumber() const
+{
+	return sequenceNumber;
+}
+
+void DirtyTiles::setSequenceNumber(unsigned long sequenceNumber)
+{
+	this->sequenceNumber = sequenceNumber;
+}
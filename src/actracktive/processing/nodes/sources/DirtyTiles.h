@@ -0,0 +1,77 @@
+/*
+ * DirtyTiles.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIRTYTILES_H_
+#define DIRTYTILES_H_
+
+#include "opencv2/opencv.hpp"
+#include <vector>
+
+/**
+ * Marks the square tiles of an image which changed compared to the previous
+ * image of the same source. The last row and column of tiles may be smaller.
+ */
+class DirtyTiles
+{
+public:
+	DirtyTiles();
+
+	/**
+	 * Sets up the tiles for images of the given size, marking all tiles as
+	 * dirty or clean.
+	 */
+	void reset(const cv::Size& imageSize, int tileSize, bool dirty);
+
+	const cv::Size& getImageSize() const;
+	int getTileSize() const;
+	int getColumns() const;
+	int getRows() const;
+
+	bool isDirty(int column, int row) const;
+	void setDirty(int column, int row, bool dirty);
+	unsigned int getDirtyCount() const;
+
+	cv::Rect getTile(int column, int row) const;
+
+	/**
+	 * Additionally marks all tiles as dirty which are at most the given
+	 * number of pixels away from a dirty tile.
+	 */
+	void dilate(int pixels);
+
+	/**
+	 * The sequence number of the image described (see
+	 * Source::getSequenceNumber()).
+	 */
+	unsigned long getSequenceNumber() const;
+	void setSequenceNumber(unsigned long sequenceNumber);
+
+private:
+	cv::Size imageSize;
+	int tileSize;
+	int columns;
+	int rows;
+	std::vector<unsigned char> dirty;
+	unsigned long sequenceNumber;
+
+};
+
+#endif
@@ -32,6 +32,26 @@ const Node::Type& ImageSource::getType() const
 	return TYPE();
 }
 
+double ImageSource::getScale() const
+{
+	return 1;
+}
+
+Vector2D ImageSource::toFullResolution(const Vector2D& position, double scale)
+{
+	return (position + Vector2D(0.5, 0.5)) * scale - Vector2D(0.5, 0.5);
+}
+
+Vector2D ImageSource::fromFullResolution(const Vector2D& position, double scale)
+{
+	return (position + Vector2D(0.5, 0.5)) / scale - Vector2D(0.5, 0.5);
+}
+
+const DirtyTiles* ImageSource::getDirtyTiles() const
+{
+	return NULL;
+}
+
 ImageSource::ImageSource(const std::string& id, const std::string& name)
 	: Source<cv::Mat>(id, name)
 {
@@ -23,6 +23,8 @@
 #define IMAGESOURCE_H_
 
 #include "actracktive/processing/nodes/Source.h"
+#include "actracktive/processing/nodes/sources/DirtyTiles.h"
+#include "actracktive/util/Geometry.h"
 #include "opencv2/opencv.hpp"
 
 template<>
@@ -45,6 +47,28 @@ public:
 	static const Node::Type& TYPE();
 	virtual const Node::Type& getType() const;
 
+	/**
+	 * Returns the factor which converts coordinates in the images of this
+	 * source into coordinates of the full resolution image, e.g. 2 for images
+	 * reduced to half the resolution.
+	 */
+	virtual double getScale() const;
+
+	/**
+	 * Converts a position in an image of the given scale into the full
+	 * resolution image and back. Pixel centers are mapped onto each other, as
+	 * each reduced pixel covers a block of scale x scale pixels.
+	 */
+	static Vector2D toFullResolution(const Vector2D& position, double scale);
+	static Vector2D fromFullResolution(const Vector2D& position, double scale);
+
+	/**
+	 * Returns which tiles of the current image changed compared to the
+	 * previous one, or NULL if this is not known. The tiles are only valid if
+	 * their sequence number matches the one of this source.
+	 */
+	virtual const DirtyTiles* getDirtyTiles() const;
+
 protected:
 	ImageSource(const std::string& id, const std::string& name);
 
@@ -40,7 +40,8 @@ const Node::Type& PlaybackSource::getType() const
 }
 
 PlaybackSource::PlaybackSource(const std::string& id, const std::string& name)
-	: ImageSource(id, name), videoFile("videoFile", "Video", mutex), device()
+	: ImageSource(id, name), videoFile("videoFile", "Video", mutex), device(), deviceSize(),
+		finished(false)
 {
 	settings.add(videoFile);
 }
@@ -82,9 +83,18 @@ void PlaybackSource::fetch(cv::Mat& destination)
 
 	if (hasFrame) {
 		frame.copyTo(destination);
+	} else {
+		finished = true;
 	}
 }
 
+bool PlaybackSource::isFinished() const
+{
+	Lock lock(this);
+
+	return finished || !device.isOpened();
+}
+
 void PlaybackSource::propertyChanged()
 {
 	initializeDevice();
@@ -102,10 +112,9 @@ void PlaybackSource::initializeDevice()
 
 	if (device.isOpened()) {
 		cv::Mat frame;
-		if (!device.read(frame)) {
-			unsigned int width = (unsigned int) device.get(CV_CAP_PROP_FRAME_WIDTH);
-			unsigned int height = (unsigned int) device.get(CV_CAP_PROP_FRAME_HEIGHT);
-			deviceSize = cv::Size(width, height);
+		if (device.read(frame)) {
+			deviceSize = frame.size();
+			device.set(CV_CAP_PROP_POS_FRAMES, 0);
 
 			LOG4CPLUS_INFO(logger, boost::format("Playback actual size is %i by %i") % deviceSize.width % deviceSize.height);
 			LOG4CPLUS_INFO(logger, "Finished initialization of playback device!");
@@ -123,6 +132,7 @@ void PlaybackSource::shutdownDevice()
 
 	device.release();
 	deviceSize = cv::Size(0, 0);
+	finished = false;
 }
 
 static bool __registered = registerNodeType<PlaybackSource>();
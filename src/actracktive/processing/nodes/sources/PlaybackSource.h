@@ -37,6 +37,11 @@ public:
 	virtual void start();
 	virtual void stop();
 
+	/**
+	 * Returns true once the end of the video has been reached.
+	 */
+	bool isFinished() const;
+
 protected:
 	virtual void fetch(cv::Mat& destination);
 
@@ -45,6 +50,7 @@ private:
 
 	cv::VideoCapture device;
 	cv::Size deviceSize;
+	bool finished;
 
 	void propertyChanged();
 	void initializeDevice();
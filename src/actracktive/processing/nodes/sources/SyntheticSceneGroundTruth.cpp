@@ -0,0 +1,57 @@
+/*
+ * SyntheticSceneGroundTruth.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/nodes/sources/SyntheticSceneGroundTruth.h"
+#include "actracktive/processing/NodeFactory.h"
+
+const Node::Type& SyntheticSceneGroundTruth::TYPE()
+{
+	static const Node::Type type = Node::Type::of<SyntheticSceneGroundTruth>("SyntheticSceneGroundTruth", ObjectSource::TYPE());
+	return type;
+}
+
+const Node::Type& SyntheticSceneGroundTruth::getType() const
+{
+	return TYPE();
+}
+
+SyntheticSceneGroundTruth::SyntheticSceneGroundTruth(const std::string& id, const std::string& name)
+	: ObjectSource(id, name), scene("scene", "Scene", mutex)
+{
+	connections.add(scene);
+}
+
+void SyntheticSceneGroundTruth::fetch(Objects& destination)
+{
+	if (!scene) {
+		return;
+	}
+
+	Lock lock(scene);
+
+	timer.pause();
+	scene->get();
+	timer.resume();
+
+	scene->getGroundTruth(destination);
+}
+
+static bool __registered = registerNodeType<SyntheticSceneGroundTruth>();
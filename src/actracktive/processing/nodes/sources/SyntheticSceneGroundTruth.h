@@ -0,0 +1,49 @@
+/*
+ * SyntheticSceneGroundTruth.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNTHETICSCENEGROUNDTRUTH_H_
+#define SYNTHETICSCENEGROUNDTRUTH_H_
+
+#include "actracktive/processing/nodes/ObjectSource.h"
+#include "actracktive/processing/nodes/sources/SyntheticSceneSource.h"
+
+/**
+ * Provides the ground truth positions and IDs of a SyntheticSceneSource as
+ * objects. Fingers carry the scene object ID, fiducials additionally carry
+ * the ID of the rendered tree.
+ */
+class SyntheticSceneGroundTruth: public ObjectSource
+{
+public:
+	static const Node::Type& TYPE();
+	const Node::Type& getType() const;
+
+	SyntheticSceneGroundTruth(const std::string& id, const std::string& name = "Synthetic Scene Ground Truth");
+
+protected:
+	virtual void fetch(Objects& destination);
+
+private:
+	TypedNodeConnection<SyntheticSceneSource> scene;
+
+};
+
+#endif
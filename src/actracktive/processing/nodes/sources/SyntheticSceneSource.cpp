@@ -0,0 +1,482 @@
+/*
+ * SyntheticSceneSource.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/nodes/sources/SyntheticSceneSource.h"
+#include "actracktive/processing/nodes/tracking/FingerDetector.h"
+#include "actracktive/processing/nodes/tracking/FiducialDetector.h"
+#include "actracktive/processing/NodeFactory.h"
+#include "actracktive/Filesystem.h"
+#include <cmath>
+#include <fstream>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
+#include <log4cplus/logger.h>
+
+static log4cplus::Logger logger = log4cplus::Logger::getInstance("SyntheticSceneSource");
+
+static const int SUBPIXEL_SHIFT = 4;
+static const double SUBPIXEL_SCALE = 1 << SUBPIXEL_SHIFT;
+static const std::size_t BLOB_OUTLINE_POINTS = 16;
+
+static cv::Point toSubpixelPoint(const Vector2D& v)
+{
+	return cv::Point(cvRound(v.x * SUBPIXEL_SCALE), cvRound(v.y * SUBPIXEL_SCALE));
+}
+
+std::size_t SyntheticSceneSource::TreeNode::getDescendantCount() const
+{
+	std::size_t count = children.size();
+	for (std::vector<TreeNode>::const_iterator child = children.begin(); child != children.end(); ++child) {
+		count += child->getDescendantCount();
+	}
+	return count;
+}
+
+const Node::Type& SyntheticSceneSource::TYPE()
+{
+	static const Node::Type type = Node::Type::of<SyntheticSceneSource>("SyntheticSceneSource", ImageSource::TYPE());
+	return type;
+}
+
+const Node::Type& SyntheticSceneSource::getType() const
+{
+	return TYPE();
+}
+
+SyntheticSceneSource::SyntheticSceneSource(const std::string& id, const std::string& name)
+	: ImageSource(id, name), width("width", "Width", mutex, 640, Constraint<int>(16, 4096)),
+		height("height", "Height", mutex, 480, Constraint<int>(16, 4096)), rate("rate", "Rate", mutex, 30, Constraint<double>(0, 1000)),
+		seed("seed", "Random Seed", mutex, 1), blobCount("blobCount", "Blob Count", mutex, 10, Constraint<unsigned int>(0, 10000)),
+		blobSize("blobSize", "Blob Size (Radius)", mutex, 8, Constraint<double>(1, 100)),
+		blobEccentricity("blobEccentricity", "Blob Eccentricity", mutex, 0.3, Constraint<double>(0, 0.99)),
+		blobSpeed("blobSpeed", "Blob Speed (px/frame)", mutex, 3, Constraint<double>(0, 100)),
+		fiducialCount("fiducialCount", "Fiducial Count", mutex, 0, Constraint<unsigned int>(0, 1000)), trees("trees", "Trees", mutex),
+		fiducialSize("fiducialSize", "Fiducial Size (Radius)", mutex, 40, Constraint<double>(8, 500)),
+		fiducialSpeed("fiducialSpeed", "Fiducial Speed (px/frame)", mutex, 1, Constraint<double>(0, 100)),
+		backgroundLevel("backgroundLevel", "Background Level", mutex, 20, Constraint<int>(0, 255)),
+		foregroundLevel("foregroundLevel", "Foreground Level", mutex, 200, Constraint<int>(0, 255)),
+		gradient("gradient", "Illumination Gradient", mutex, 0, Constraint<int>(0, 255)),
+		noise("noise", "Noise (Std. Dev.)", mutex, 0, Constraint<double>(0, 100)), sceneChanged(true), random(), loadedTrees(),
+		sceneObjects()
+{
+	settings.add(width);
+	settings.add(height);
+	settings.add(rate);
+	settings.add(seed);
+	settings.add(blobCount);
+	settings.add(blobSize);
+	settings.add(blobEccentricity);
+	settings.add(blobSpeed);
+	settings.add(fiducialCount);
+	settings.add(trees);
+	settings.add(fiducialSize);
+	settings.add(fiducialSpeed);
+	settings.add(backgroundLevel);
+	settings.add(foregroundLevel);
+	settings.add(gradient);
+	settings.add(noise);
+}
+
+void SyntheticSceneSource::start()
+{
+	loadTrees();
+	sceneChanged = true;
+
+	width.onChange.connect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	height.onChange.connect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	seed.onChange.connect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	blobCount.onChange.connect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	blobSize.onChange.connect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	blobEccentricity.onChange.connect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	blobSpeed.onChange.connect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	fiducialCount.onChange.connect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	trees.onChange.connect(boost::bind(&SyntheticSceneSource::loadTrees, this));
+	fiducialSize.onChange.connect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	fiducialSpeed.onChange.connect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	gradient.onChange.connect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+
+	ImageSource::start();
+}
+
+void SyntheticSceneSource::stop()
+{
+	ImageSource::stop();
+
+	width.onChange.disconnect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	height.onChange.disconnect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	seed.onChange.disconnect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	blobCount.onChange.disconnect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	blobSize.onChange.disconnect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	blobEccentricity.onChange.disconnect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	blobSpeed.onChange.disconnect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	fiducialCount.onChange.disconnect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	trees.onChange.disconnect(boost::bind(&SyntheticSceneSource::loadTrees, this));
+	fiducialSize.onChange.disconnect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	fiducialSpeed.onChange.disconnect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+	gradient.onChange.disconnect(boost::bind(&SyntheticSceneSource::propertyChanged, this));
+
+	Lock lock(this);
+
+	sceneObjects.clear();
+	loadedTrees.clear();
+	gradientImage.release();
+	noiseImage.release();
+}
+
+void SyntheticSceneSource::getGroundTruth(Objects& destination) const
+{
+	Lock lock(this);
+
+	destination.clear();
+
+	for (std::vector<SceneObject>::const_iterator object = sceneObjects.begin(); object != sceneObjects.end(); ++object) {
+		if (object->fiducialId < 0) {
+			destination.add(new Finger(object->id, frameTime, object->position, getBlobOutline(*object)));
+		} else {
+			destination.add(
+				new Fiducial(object->id, object->fiducialId, frameTime, object->leafPosition, object->leafAngle,
+					getFiducialOutline(*object)));
+		}
+	}
+
+	const cv::Mat& image = get();
+	destination.setBounds(Rectangle(0, 0, image.cols, image.rows));
+}
+
+void SyntheticSceneSource::fetch(cv::Mat& destination)
+{
+	if (sceneChanged) {
+		createScene();
+	}
+
+	waitForNextFrame();
+	moveScene();
+
+	destination.create(height, width, CV_8UC1);
+	destination.setTo(cv::Scalar(backgroundLevel));
+
+	for (std::vector<SceneObject>::iterator object = sceneObjects.begin(); object != sceneObjects.end(); ++object) {
+		if (object->fiducialId < 0) {
+			renderBlob(destination, *object);
+		} else {
+			renderFiducial(destination, *object);
+		}
+	}
+
+	if (gradient > 0) {
+		cv::add(destination, gradientImage, destination);
+	}
+
+	if (noise > 0) {
+		noiseImage.create(destination.size(), CV_16SC1);
+		random.fill(noiseImage, cv::RNG::NORMAL, cv::Scalar(0), cv::Scalar(noise));
+		cv::add(destination, noiseImage, destination, cv::noArray(), CV_8U);
+	}
+
+	frameTime = boost::posix_time::microsec_clock::local_time();
+}
+
+void SyntheticSceneSource::propertyChanged()
+{
+	Lock lock(this);
+
+	sceneChanged = true;
+}
+
+void SyntheticSceneSource::loadTrees()
+{
+	Lock lock(this);
+
+	loadedTrees.clear();
+	sceneChanged = true;
+
+	if (trees.getValue().empty()) {
+		return;
+	}
+
+	std::ifstream file(filesystem::toData(trees).string().c_str());
+	if (!file) {
+		LOG4CPLUS_WARN(logger, "Could not read trees file " << filesystem::toData(trees).string());
+		return;
+	}
+
+	std::string line;
+	for (int treeId = 0; std::getline(file, line);) {
+		boost::algorithm::trim(line);
+		if (line.empty()) {
+			continue;
+		}
+
+		Tree tree;
+		tree.id = treeId++;
+		if (parseTree(line, tree)) {
+			loadedTrees.push_back(tree);
+		} else {
+			LOG4CPLUS_WARN(logger, "Ignoring invalid tree \"" << line << "\"");
+		}
+	}
+
+	LOG4CPLUS_INFO(logger, boost::format("Loaded %i trees for rendering fiducials") % loadedTrees.size());
+}
+
+bool SyntheticSceneSource::parseTree(const std::string& treeString, Tree& tree) const
+{
+	if (treeString.size() < 2 || (treeString[0] != 'w' && treeString[0] != 'b') || treeString[1] != '0') {
+		return false;
+	}
+
+	tree.white = treeString[0] == 'w';
+	tree.root.children.clear();
+
+	// The tree string lists the depth of each region in pre-order, so each
+	// region is a child of the last region seen one level above it.
+	std::vector<TreeNode*> path(1, &tree.root);
+	for (std::size_t i = 2; i < treeString.size(); ++i) {
+		if (treeString[i] < '1' || treeString[i] > '9') {
+			return false;
+		}
+
+		std::size_t depth = treeString[i] - '0';
+		if (depth > path.size()) {
+			return false;
+		}
+
+		path.resize(depth);
+		TreeNode* parent = path.back();
+		parent->children.push_back(TreeNode());
+		path.push_back(&parent->children.back());
+	}
+
+	return !tree.root.children.empty();
+}
+
+void SyntheticSceneSource::createScene()
+{
+	sceneChanged = false;
+	sceneObjects.clear();
+	random = cv::RNG(seed);
+
+	const double w = width;
+	const double h = height;
+
+	unsigned int nextId = 1;
+
+	for (unsigned int i = 0; i < blobCount; ++i) {
+		SceneObject blob;
+		blob.id = nextId++;
+		blob.fiducialId = -1;
+		blob.tree = 0;
+		blob.radius = blobSize * random.uniform(0.8, 1.2);
+		blob.eccentricity = blobEccentricity;
+		blob.position = Vector2D(random.uniform(blob.radius, std::max(blob.radius, w - blob.radius)),
+			random.uniform(blob.radius, std::max(blob.radius, h - blob.radius)));
+		double direction = random.uniform(0.0, 2 * M_PI);
+		double speed = blobSpeed * random.uniform(0.5, 1.5);
+		blob.velocity = Vector2D(std::cos(direction) * speed, std::sin(direction) * speed);
+		blob.angle = random.uniform(0.0, M_PI);
+		blob.angularVelocity = random.uniform(-0.05, 0.05);
+		blob.leafPosition = blob.position;
+		blob.leafAngle = blob.angle;
+
+		sceneObjects.push_back(blob);
+	}
+
+	if (fiducialCount > 0 && loadedTrees.empty()) {
+		LOG4CPLUS_WARN(logger, "No trees loaded, synthetic scene will not contain any fiducials!");
+	}
+
+	for (unsigned int i = 0; i < fiducialCount && !loadedTrees.empty(); ++i) {
+		SceneObject fiducial;
+		fiducial.id = nextId++;
+		fiducial.tree = random.uniform(0, (int) loadedTrees.size());
+		fiducial.fiducialId = loadedTrees[fiducial.tree].id;
+		fiducial.radius = fiducialSize;
+		fiducial.eccentricity = 0;
+		fiducial.position = Vector2D(random.uniform(fiducial.radius, std::max(fiducial.radius, w - fiducial.radius)),
+			random.uniform(fiducial.radius, std::max(fiducial.radius, h - fiducial.radius)));
+		double direction = random.uniform(0.0, 2 * M_PI);
+		fiducial.velocity = Vector2D(std::cos(direction) * fiducialSpeed, std::sin(direction) * fiducialSpeed);
+		fiducial.angle = random.uniform(0.0, 2 * M_PI);
+		fiducial.angularVelocity = random.uniform(-0.02, 0.02);
+		fiducial.leafPosition = fiducial.position;
+		fiducial.leafAngle = fiducial.angle;
+
+		sceneObjects.push_back(fiducial);
+	}
+
+	gradientImage.create(height, width, CV_8UC1);
+	for (int x = 0; x < gradientImage.cols; ++x) {
+		gradientImage.col(x).setTo(cv::Scalar(cvRound(gradient * x / w)));
+	}
+
+	nextFrameTime = boost::posix_time::ptime();
+
+	LOG4CPLUS_INFO(logger,
+		boost::format("Created synthetic scene of %i by %i with %i objects") % width.getValue() % height.getValue() % sceneObjects.size());
+}
+
+void SyntheticSceneSource::moveScene()
+{
+	const double w = width;
+	const double h = height;
+
+	for (std::vector<SceneObject>::iterator object = sceneObjects.begin(); object != sceneObjects.end(); ++object) {
+		object->position += object->velocity;
+		object->angle += object->angularVelocity;
+
+		if (object->position.x < object->radius || object->position.x > w - object->radius) {
+			object->velocity.x = -object->velocity.x;
+			object->position.x = std::min(std::max(object->position.x, object->radius), w - object->radius);
+		}
+
+		if (object->position.y < object->radius || object->position.y > h - object->radius) {
+			object->velocity.y = -object->velocity.y;
+			object->position.y = std::min(std::max(object->position.y, object->radius), h - object->radius);
+		}
+	}
+}
+
+void SyntheticSceneSource::waitForNextFrame()
+{
+	if (rate <= 0) {
+		return;
+	}
+
+	boost::posix_time::time_duration interval = boost::posix_time::microseconds((long) (1000000 / rate));
+	boost::posix_time::ptime now(boost::posix_time::microsec_clock::local_time());
+
+	if (!nextFrameTime.is_not_a_date_time() && nextFrameTime > now) {
+		timer.pause();
+		boost::this_thread::sleep(nextFrameTime - now);
+		timer.resume();
+
+		nextFrameTime += interval;
+	} else {
+		nextFrameTime = now + interval;
+	}
+}
+
+void SyntheticSceneSource::renderBlob(cv::Mat& image, const SceneObject& blob) const
+{
+	double minorRadius = blob.radius * std::sqrt(1 - blob.eccentricity * blob.eccentricity);
+	cv::Size axes(cvRound(blob.radius * SUBPIXEL_SCALE), cvRound(minorRadius * SUBPIXEL_SCALE));
+
+	cv::ellipse(image, toSubpixelPoint(blob.position), axes, blob.angle * 180 / M_PI, 0, 360, cv::Scalar(foregroundLevel), -1, 8,
+		SUBPIXEL_SHIFT);
+}
+
+void SyntheticSceneSource::renderFiducial(cv::Mat& image, SceneObject& fiducial) const
+{
+	const Tree& tree = loadedTrees[fiducial.tree];
+
+	Vector2D leafSums[2];
+	double leafWeights[2] = { 0, 0 };
+	renderTreeNode(image, tree.root, fiducial.position, fiducial.radius, fiducial.angle, tree.white, 0, leafSums, leafWeights);
+
+	// The fiducial position and angle are derived from the leaf regions the
+	// same way libfidtrack does: the (depth weighted) centroid of all leafs
+	// and the direction from the centroid of the black leafs towards it.
+	if (leafWeights[0] + leafWeights[1] > 0) {
+		fiducial.leafPosition = (leafSums[0] + leafSums[1]) / (leafWeights[0] + leafWeights[1]);
+	} else {
+		fiducial.leafPosition = fiducial.position;
+	}
+
+	if (leafWeights[0] > 0) {
+		Vector2D direction = fiducial.leafPosition - leafSums[0] / leafWeights[0];
+		fiducial.leafAngle = std::atan2(direction.y, direction.x);
+	} else {
+		fiducial.leafAngle = fiducial.angle;
+	}
+}
+
+void SyntheticSceneSource::renderTreeNode(cv::Mat& image, const TreeNode& node, const Vector2D& center, double radius, double angle,
+	bool white, unsigned int depth, Vector2D leafSums[2], double leafWeights[2]) const
+{
+	cv::circle(image, toSubpixelPoint(center), cvRound(radius * SUBPIXEL_SCALE), cv::Scalar(white ? foregroundLevel : backgroundLevel),
+		-1, 8, SUBPIXEL_SHIFT);
+
+	if (node.children.empty()) {
+		double weight = 0.5 + depth;
+		leafSums[white ? 1 : 0] += center * weight;
+		leafWeights[white ? 1 : 0] += weight;
+		return;
+	}
+
+	if (node.children.size() == 1) {
+		renderTreeNode(image, node.children.front(), center, radius * 0.6, angle, !white, depth + 1, leafSums, leafWeights);
+		return;
+	}
+
+	// Children are placed on a ring inside their parent, each getting an
+	// angular share according to the size of its own subtree. The radii are
+	// chosen so that neighbouring regions never touch each other.
+	double totalWeight = 0;
+	for (std::vector<TreeNode>::const_iterator child = node.children.begin(); child != node.children.end(); ++child) {
+		totalWeight += std::sqrt(child->getDescendantCount() + 1.0);
+	}
+
+	double start = angle;
+	for (std::vector<TreeNode>::const_iterator child = node.children.begin(); child != node.children.end(); ++child) {
+		double share = 2 * M_PI * std::sqrt(child->getDescendantCount() + 1.0) / totalWeight;
+		double halfShare = std::sin(std::min(share / 2, M_PI_2));
+		double childRadius = radius * std::min(0.45, 0.85 * halfShare / (1 + halfShare));
+		double childAngle = start + share / 2;
+		Vector2D childCenter = center + Vector2D(std::cos(childAngle), std::sin(childAngle)) * (radius - childRadius * 1.3);
+
+		renderTreeNode(image, *child, childCenter, childRadius, childAngle, !white, depth + 1, leafSums, leafWeights);
+
+		start += share;
+	}
+}
+
+std::vector<Vector2D> SyntheticSceneSource::getBlobOutline(const SceneObject& blob) const
+{
+	double minorRadius = blob.radius * std::sqrt(1 - blob.eccentricity * blob.eccentricity);
+	double cosAngle = std::cos(blob.angle);
+	double sinAngle = std::sin(blob.angle);
+
+	std::vector<Vector2D> outline;
+	outline.reserve(BLOB_OUTLINE_POINTS);
+	for (std::size_t i = 0; i < BLOB_OUTLINE_POINTS; ++i) {
+		double t = 2 * M_PI * i / BLOB_OUTLINE_POINTS;
+		double x = std::cos(t) * blob.radius;
+		double y = std::sin(t) * minorRadius;
+		outline.push_back(blob.position + Vector2D(x * cosAngle - y * sinAngle, x * sinAngle + y * cosAngle));
+	}
+
+	return outline;
+}
+
+std::vector<Vector2D> SyntheticSceneSource::getFiducialOutline(const SceneObject& fiducial) const
+{
+	std::vector<Vector2D> outline;
+	for (std::size_t corner = 0; corner < 4; ++corner) {
+		double angle = fiducial.leafAngle + corner * M_PI_2;
+		outline.push_back(fiducial.leafPosition + Vector2D(std::cos(angle) * fiducial.radius, std::sin(angle) * fiducial.radius));
+	}
+
+	return outline;
+}
+
+static bool __registered = registerNodeType<SyntheticSceneSource>();
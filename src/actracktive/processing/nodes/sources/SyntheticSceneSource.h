@@ -0,0 +1,129 @@
+/*
+ * SyntheticSceneSource.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNTHETICSCENESOURCE_H_
+#define SYNTHETICSCENESOURCE_H_
+
+#include "actracktive/processing/nodes/sources/ImageSource.h"
+#include "actracktive/processing/nodes/ObjectSource.h"
+#include <vector>
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+/**
+ * Renders a synthetic scene of moving blobs (fingers) and amoeba fiducials
+ * (taken from a trees file) with an illumination gradient and noise. The
+ * ground truth of the last rendered frame can be retrieved with
+ * getGroundTruth() or through a SyntheticSceneGroundTruth node.
+ */
+class SyntheticSceneSource: public ImageSource
+{
+public:
+	static const Node::Type& TYPE();
+	const Node::Type& getType() const;
+
+	SyntheticSceneSource(const std::string& id, const std::string& name = "Synthetic Scene");
+
+	virtual void start();
+	virtual void stop();
+
+	void getGroundTruth(Objects& destination) const;
+
+protected:
+	virtual void fetch(cv::Mat& destination);
+
+private:
+	struct TreeNode
+	{
+		std::vector<TreeNode> children;
+
+		std::size_t getDescendantCount() const;
+	};
+
+	struct Tree
+	{
+		int id;
+		bool white;
+		TreeNode root;
+	};
+
+	struct SceneObject
+	{
+		unsigned int id;
+		int fiducialId;
+		std::size_t tree;
+		Vector2D position;
+		Vector2D velocity;
+		double angle;
+		double angularVelocity;
+		double radius;
+		double eccentricity;
+
+		Vector2D leafPosition;
+		double leafAngle;
+	};
+
+	ValueProperty<int> width;
+	ValueProperty<int> height;
+	ValueProperty<double> rate;
+	ValueProperty<unsigned int> seed;
+	ValueProperty<unsigned int> blobCount;
+	ValueProperty<double> blobSize;
+	ValueProperty<double> blobEccentricity;
+	ValueProperty<double> blobSpeed;
+	ValueProperty<unsigned int> fiducialCount;
+	ValueProperty<boost::filesystem::path> trees;
+	ValueProperty<double> fiducialSize;
+	ValueProperty<double> fiducialSpeed;
+	ValueProperty<int> backgroundLevel;
+	ValueProperty<int> foregroundLevel;
+	ValueProperty<int> gradient;
+	ValueProperty<double> noise;
+
+	bool sceneChanged;
+	cv::RNG random;
+	std::vector<Tree> loadedTrees;
+	std::vector<SceneObject> sceneObjects;
+	boost::posix_time::ptime frameTime;
+	boost::posix_time::ptime nextFrameTime;
+
+	cv::Mat gradientImage;
+	cv::Mat noiseImage;
+
+	void propertyChanged();
+
+	void loadTrees();
+	bool parseTree(const std::string& treeString, Tree& tree) const;
+	void createScene();
+	void moveScene();
+	void waitForNextFrame();
+
+	void renderBlob(cv::Mat& image, const SceneObject& blob) const;
+	void renderFiducial(cv::Mat& image, SceneObject& fiducial) const;
+	void renderTreeNode(cv::Mat& image, const TreeNode& node, const Vector2D& center, double radius, double angle, bool white,
+		unsigned int depth, Vector2D leafSums[2], double leafWeights[2]) const;
+
+	std::vector<Vector2D> getBlobOutline(const SceneObject& blob) const;
+	std::vector<Vector2D> getFiducialOutline(const SceneObject& fiducial) const;
+
+};
+
+#endif
@@ -21,6 +21,149 @@
 
 #include "actracktive/processing/nodes/sources/filter/AdaptiveThresholdFilter.h"
 #include "actracktive/processing/NodeFactory.h"
+#include <algorithm>
+#include <vector>
+#include <boost/bind.hpp>
+
+/*
+ * The box filters below are based on integral images, so their cost does not
+ * depend on the kernel size. They reproduce OpenCV's results exactly: as all
+ * kernel sizes are odd, the exact mean of a box can never lie halfway between
+ * two integers and rounding sum * (1.0 / area) is unambiguous.
+ */
+
+static int reflect101(int i, int n)
+{
+	if (n == 1) {
+		return 0;
+	}
+
+	while (i < 0 || i >= n) {
+		i = (i < 0) ? -i : 2 * n - 2 - i;
+	}
+
+	return i;
+}
+
+static int replicate(int i, int n)
+{
+	return std::min(std::max(i, 0), n - 1);
+}
+
+/*
+ * Computes the integral image of source padded by radius pixels on each side
+ * (using the given border mode). Sums are accumulated as unsigned integers, so
+ * they may wrap around for large images, but differences of them (i.e. box
+ * sums) are still correct.
+ */
+static void paddedIntegral(const cv::Mat& source, int radius, int (*border)(int, int), cv::Mat& integral)
+{
+	const int width = source.cols + 2 * radius;
+	const int height = source.rows + 2 * radius;
+
+	integral.create(height + 1, width + 1, CV_32SC1);
+
+	std::vector<int> columns(width);
+	for (int x = 0; x < width; ++x) {
+		columns[x] = border(x - radius, source.cols);
+	}
+
+	unsigned int* previous = integral.ptr<unsigned int>(0);
+	std::fill(previous, previous + width + 1, 0u);
+
+	for (int y = 0; y < height; ++y) {
+		const uchar* row = source.ptr<uchar>(border(y - radius, source.rows));
+		unsigned int* current = integral.ptr<unsigned int>(y + 1);
+
+		unsigned int rowSum = 0;
+		current[0] = 0;
+		for (int x = 0; x < width; ++x) {
+			rowSum += row[columns[x]];
+			current[x + 1] = previous[x + 1] + rowSum;
+		}
+
+		previous = current;
+	}
+}
+
+/*
+ * Equivalent to cv::blur(source, destination, cv::Size(size, size)), i.e. using
+ * BORDER_REFLECT_101.
+ */
+static void boxSmooth(const cv::Mat& source, cv::Mat& destination, int size)
+{
+	cv::Mat integral;
+	paddedIntegral(source, size / 2, &reflect101, integral);
+
+	destination.create(source.size(), CV_8UC1);
+
+	const double scale = 1.0 / (size * size);
+	for (int y = 0; y < source.rows; ++y) {
+		const unsigned int* top = integral.ptr<unsigned int>(y);
+		const unsigned int* bottom = integral.ptr<unsigned int>(y + size);
+		uchar* output = destination.ptr<uchar>(y);
+
+		for (int x = 0; x < source.cols; ++x) {
+			unsigned int sum = bottom[x + size] - bottom[x] - top[x + size] + top[x];
+			output[x] = cv::saturate_cast<uchar>(cvRound(sum * scale));
+		}
+	}
+}
+
+/*
+ * Equivalent to cv::adaptiveThreshold(source, destination, 255,
+ * cv::ADAPTIVE_THRESH_MEAN_C, type, blockSize, offset) for 8-bit single
+ * channel images.
+ */
+static void meanThreshold(const cv::Mat& source, cv::Mat& destination, int type, int blockSize, int offset)
+{
+	cv::Mat integral;
+	paddedIntegral(source, blockSize / 2, &replicate, integral);
+
+	uchar table[768];
+	for (int i = 0; i < 768; ++i) {
+		bool above = i - 255 > -offset;
+		table[i] = (above == (type == cv::THRESH_BINARY)) ? 255 : 0;
+	}
+
+	destination.create(source.size(), CV_8UC1);
+
+	const double scale = 1.0 / (blockSize * blockSize);
+	for (int y = 0; y < source.rows; ++y) {
+		const unsigned int* top = integral.ptr<unsigned int>(y);
+		const unsigned int* bottom = integral.ptr<unsigned int>(y + blockSize);
+		const uchar* input = source.ptr<uchar>(y);
+		uchar* output = destination.ptr<uchar>(y);
+
+		for (int x = 0; x < source.cols; ++x) {
+			unsigned int sum = bottom[x + blockSize] - bottom[x] - top[x + blockSize] + top[x];
+			int mean = cvRound(sum * scale);
+			output[x] = table[input[x] - mean + 255];
+		}
+	}
+}
+
+static void applyAdaptiveThreshold(const cv::Mat& source, cv::Mat& destination, int method, int type, int blockSize, int offset,
+	int smoothSize)
+{
+	if (source.type() != CV_8UC1) {
+		// Not supported by cv::adaptiveThreshold either, which reports the error
+		cv::adaptiveThreshold(source, destination, 255, method, type, blockSize, offset);
+		return;
+	}
+
+	cv::Mat smoothed = source;
+	if (smoothSize > 1) {
+		smoothed = cv::Mat();
+		boxSmooth(source, smoothed, smoothSize);
+	}
+
+	if (method == cv::ADAPTIVE_THRESH_MEAN_C) {
+		meanThreshold(smoothed, destination, type, blockSize, offset);
+	} else {
+		cv::adaptiveThreshold(smoothed, destination, 255, method, type, blockSize, offset);
+	}
+}
 
 const Node::Type& AdaptiveThresholdFilter::TYPE()
 {
@@ -36,12 +179,21 @@ const Node::Type& AdaptiveThresholdFilter::getType() const
 AdaptiveThresholdFilter::AdaptiveThresholdFilter(const std::string& id, const std::string& name)
 	: ImageFilter(id, name), blockSize("blockSize", "Block Size", mutex, 3, Constraint<unsigned int>(3, 101, 2)),
 		offset("offset", "Offset", mutex, 5, Constraint<int>(-100, 100, 1)), invert("invert", "Invert", mutex, false),
-		gauss("gauss", "Use Gauss-Mask", mutex, false)
+		gauss("gauss", "Use Gauss-Mask", mutex, false), smooth("smooth", "Box Smoothing", mutex, 1, Constraint<unsigned int>(1, 21, 2))
 {
 	settings.add(blockSize);
 	settings.add(offset);
 	settings.add(invert);
 	settings.add(gauss);
+	settings.add(smooth);
+
+	enableStripedExecution();
+	enableTiledExecution();
+}
+
+bool AdaptiveThresholdFilter::isStateless() const
+{
+	return true;
 }
 
 void AdaptiveThresholdFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
@@ -49,7 +201,11 @@ void AdaptiveThresholdFilter::applyFilter(const cv::Mat& source, cv::Mat& destin
 	int method = gauss ? cv::ADAPTIVE_THRESH_GAUSSIAN_C : cv::ADAPTIVE_THRESH_MEAN_C;
 	int type = invert ? cv::THRESH_BINARY_INV : cv::THRESH_BINARY;
 
-	cv::adaptiveThreshold(source, destination, 255, method, type, blockSize, offset);
+	int blockSize = this->blockSize;
+	int smoothSize = smooth;
+
+	applyStriped(source, destination, blockSize / 2 + smoothSize / 2,
+		boost::bind(&applyAdaptiveThreshold, _1, _2, method, type, blockSize, int(offset), smoothSize));
 }
 
 static bool __registered = registerNodeType<AdaptiveThresholdFilter>();
@@ -24,6 +24,13 @@
 
 #include "actracktive/processing/nodes/sources/filter/ImageFilter.h"
 
+/**
+ * Thresholds each pixel against the (mean or gaussian weighted) average of its
+ * neighbourhood. Optionally, the image is box smoothed before, which gives the
+ * same result as a preceding SmoothFilter in Normalized_Box mode but saves a
+ * node and a pass over the image. Mean mode and smoothing are computed using
+ * integral images, so their cost does not depend on block or smoothing size.
+ */
 class AdaptiveThresholdFilter: public ImageFilter
 {
 public:
@@ -32,6 +39,8 @@ public:
 
 	AdaptiveThresholdFilter(const std::string& id, const std::string& name = "Adaptive Threshold");
 
+	virtual bool isStateless() const;
+
 protected:
 	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination);
 
@@ -40,6 +49,7 @@ private:
 	ValueProperty<int> offset;
 	ValueProperty<bool> invert;
 	ValueProperty<bool> gauss;
+	ValueProperty<unsigned int> smooth;
 
 };
 
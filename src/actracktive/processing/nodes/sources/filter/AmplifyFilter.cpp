@@ -21,6 +21,12 @@
 
 #include "actracktive/processing/nodes/sources/filter/AmplifyFilter.h"
 #include "actracktive/processing/NodeFactory.h"
+#include <boost/bind.hpp>
+
+static void amplify(const cv::Mat& source, cv::Mat& destination, double level)
+{
+	cv::multiply(source, source, destination, level);
+}
 
 const Node::Type& AmplifyFilter::TYPE()
 {
@@ -37,11 +43,19 @@ AmplifyFilter::AmplifyFilter(const std::string& id, const std::string& name)
 	: ImageFilter(id, name), level("level", "Level", mutex, 1, Constraint<double>(0, 2))
 {
 	settings.add(level);
+
+	enableStripedExecution();
+	enableTiledExecution();
+}
+
+bool AmplifyFilter::isStateless() const
+{
+	return true;
 }
 
 void AmplifyFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
 {
-	destination = source.mul(source, level);
+	applyStriped(source, destination, 0, boost::bind(&amplify, _1, _2, double(level)));
 }
 
 static bool __registered = registerNodeType<AmplifyFilter>();
@@ -32,6 +32,8 @@ public:
 
 	AmplifyFilter(const std::string& id, const std::string& name = "Amplify");
 
+	virtual bool isStateless() const;
+
 protected:
 	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination);
 
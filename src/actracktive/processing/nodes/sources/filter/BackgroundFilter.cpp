@@ -21,6 +21,248 @@
 
 #include "actracktive/processing/nodes/sources/filter/BackgroundFilter.h"
 #include "actracktive/processing/NodeFactory.h"
+#include <algorithm>
+#include <boost/bind.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+	/*
+	 * Describes the model update applied to the rows y with y % interval ==
+	 * phase. The amount is the weight (as fraction of 65536) for averages and
+	 * the step (in 8.8 fixed point) for medians and bounds.
+	 */
+	struct Update
+	{
+		enum Kind
+		{
+			NONE, INITIALIZE, AVERAGE, MEDIAN, BOUNDS, ENVELOPE
+		};
+
+		Kind kind;
+		unsigned int amount;
+		int interval;
+		int phase;
+	};
+
+	// The bounds track the 5% and 95% quantiles, by moving outwards 19 times
+	// faster than inwards.
+	const unsigned int QUANTILE_RATIO = 19;
+
+#ifdef __SSE2__
+
+	inline __m128i loadPixels(const uchar* input)
+	{
+		return _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(input)), _mm_setzero_si128());
+	}
+
+	inline __m128i minEpu16(const __m128i& a, const __m128i& b)
+	{
+		return _mm_sub_epi16(a, _mm_subs_epu16(a, b));
+	}
+
+	inline __m128i maxEpu16(const __m128i& a, const __m128i& b)
+	{
+		return _mm_add_epi16(a, _mm_subs_epu16(b, a));
+	}
+
+	// Moves value towards target by at most up (if below) or down (if above)
+	inline __m128i moveTowards(const __m128i& value, const __m128i& target, const __m128i& up, const __m128i& down)
+	{
+		__m128i increase = minEpu16(_mm_subs_epu16(target, value), up);
+		__m128i decrease = minEpu16(_mm_subs_epu16(value, target), down);
+		return _mm_sub_epi16(_mm_add_epi16(value, increase), decrease);
+	}
+
+#endif
+
+	inline ushort moveTowards(ushort value, ushort target, unsigned int up, unsigned int down)
+	{
+		if (target > value) {
+			return value + std::min<unsigned int>(target - value, up);
+		} else {
+			return value - std::min<unsigned int>(value - target, down);
+		}
+	}
+
+	void initializeRow(const uchar* input, ushort* model, int width)
+	{
+		for (int x = 0; x < width; ++x) {
+			model[x] = input[x] << 8;
+		}
+	}
+
+	/*
+	 * model += (input * 256 - model) * weight / 65536, with both products
+	 * rounded down separately, so the result is not biased in either
+	 * direction.
+	 */
+	void averageRow(const uchar* input, ushort* model, int width, unsigned int weight)
+	{
+		int x = 0;
+
+#ifdef __SSE2__
+		const __m128i weights = _mm_set1_epi16(short(weight));
+
+		for (; x <= width - 8; x += 8) {
+			__m128i pixels = _mm_slli_epi16(loadPixels(input + x), 8);
+			__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(model + x));
+
+			values = _mm_sub_epi16(_mm_add_epi16(values, _mm_mulhi_epu16(pixels, weights)), _mm_mulhi_epu16(values, weights));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(model + x), values);
+		}
+#endif
+
+		for (; x < width; ++x) {
+			model[x] = model[x] + (((input[x] << 8) * weight) >> 16) - ((model[x] * weight) >> 16);
+		}
+	}
+
+	void medianRow(const uchar* input, ushort* model, int width, unsigned int step)
+	{
+		int x = 0;
+
+#ifdef __SSE2__
+		const __m128i steps = _mm_set1_epi16(short(step));
+
+		for (; x <= width - 8; x += 8) {
+			__m128i pixels = _mm_slli_epi16(loadPixels(input + x), 8);
+			__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(model + x));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(model + x), moveTowards(values, pixels, steps, steps));
+		}
+#endif
+
+		for (; x < width; ++x) {
+			model[x] = moveTowards(model[x], input[x] << 8, step, step);
+		}
+	}
+
+	void boundsRow(const uchar* input, ushort* lower, ushort* upper, int width, unsigned int step)
+	{
+		const unsigned int largeStep = std::min<unsigned int>(step * QUANTILE_RATIO, 0xffff);
+
+		int x = 0;
+
+#ifdef __SSE2__
+		const __m128i steps = _mm_set1_epi16(short(step));
+		const __m128i largeSteps = _mm_set1_epi16(short(largeStep));
+
+		for (; x <= width - 8; x += 8) {
+			__m128i pixels = _mm_slli_epi16(loadPixels(input + x), 8);
+			__m128i lowerValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lower + x));
+			__m128i upperValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(upper + x));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(lower + x), moveTowards(lowerValues, pixels, steps, largeSteps));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(upper + x), moveTowards(upperValues, pixels, largeSteps, steps));
+		}
+#endif
+
+		for (; x < width; ++x) {
+			lower[x] = moveTowards(lower[x], input[x] << 8, step, largeStep);
+			upper[x] = moveTowards(upper[x], input[x] << 8, largeStep, step);
+		}
+	}
+
+	void envelopeRow(const uchar* input, ushort* lower, ushort* upper, int width)
+	{
+		for (int x = 0; x < width; ++x) {
+			ushort value = input[x] << 8;
+			lower[x] = std::min(lower[x], value);
+			upper[x] = std::max(upper[x], value);
+		}
+	}
+
+	/*
+	 * The lower and upper bound of the background are rounded down and up for
+	 * bands, and to the nearest value for single background values (where
+	 * lower and upper are the same).
+	 */
+	void subtractRow(const uchar* input, const ushort* lower, const ushort* upper, uchar* output, int width,
+		ForegroundPolarity foreground)
+	{
+		const bool band = (lower != upper);
+		const ushort lowerRounding = band ? 0 : 128;
+		const ushort upperRounding = band ? 255 : 128;
+		const bool darker = (foreground != Brighter);
+		const bool brighter = (foreground != Darker);
+
+		int x = 0;
+
+#ifdef __SSE2__
+		const __m128i lowerRoundings = _mm_set1_epi16(lowerRounding);
+		const __m128i upperRoundings = _mm_set1_epi16(upperRounding);
+		const __m128i darkerMask = _mm_set1_epi16(darker ? -1 : 0);
+		const __m128i brighterMask = _mm_set1_epi16(brighter ? -1 : 0);
+
+		for (; x <= width - 8; x += 8) {
+			__m128i pixels = loadPixels(input + x);
+			__m128i lowerValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lower + x));
+			__m128i upperValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(upper + x));
+
+			lowerValues = _mm_srli_epi16(_mm_adds_epu16(lowerValues, lowerRoundings), 8);
+			upperValues = _mm_srli_epi16(_mm_adds_epu16(upperValues, upperRoundings), 8);
+
+			__m128i darkerValues = _mm_and_si128(_mm_subs_epu16(lowerValues, pixels), darkerMask);
+			__m128i brighterValues = _mm_and_si128(_mm_subs_epu16(pixels, upperValues), brighterMask);
+			__m128i values = _mm_max_epi16(darkerValues, brighterValues);
+
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(output + x), _mm_packus_epi16(values, values));
+		}
+#endif
+
+		for (; x < width; ++x) {
+			int lowerValue = (lower[x] + lowerRounding) >> 8;
+			int upperValue = (upper[x] + upperRounding) >> 8;
+			int darkerValue = darker ? std::max(lowerValue - input[x], 0) : 0;
+			int brighterValue = brighter ? std::max(input[x] - upperValue, 0) : 0;
+			output[x] = uchar(std::max(darkerValue, brighterValue));
+		}
+	}
+
+	void subtractBackground(const cv::Mat& source, cv::Mat& destination, const cv::Range& rows, cv::Mat& lower, cv::Mat& upper,
+		const Update& update, ForegroundPolarity foreground)
+	{
+		const int width = source.cols * source.channels();
+
+		for (int y = rows.start; y < rows.end; ++y) {
+			const uchar* input = source.ptr<uchar>(y);
+			ushort* lowerValues = lower.ptr<ushort>(y);
+			ushort* upperValues = upper.ptr<ushort>(y);
+
+			if (y % update.interval == update.phase) {
+				switch (update.kind) {
+					case Update::INITIALIZE:
+						initializeRow(input, lowerValues, width);
+						initializeRow(input, upperValues, width);
+						break;
+					case Update::AVERAGE:
+						averageRow(input, lowerValues, width, update.amount);
+						break;
+					case Update::MEDIAN:
+						medianRow(input, lowerValues, width, update.amount);
+						break;
+					case Update::BOUNDS:
+						boundsRow(input, lowerValues, upperValues, width, update.amount);
+						break;
+					case Update::ENVELOPE:
+						envelopeRow(input, lowerValues, upperValues, width);
+						break;
+					case Update::NONE:
+						break;
+				}
+			}
+
+			subtractRow(input, lowerValues, upperValues, destination.ptr<uchar>(y), width, foreground);
+		}
+	}
+
+}
 
 const Node::Type& BackgroundFilter::TYPE()
 {
@@ -34,43 +276,103 @@ const Node::Type& BackgroundFilter::getType() const
 }
 
 BackgroundFilter::BackgroundFilter(const std::string& id, const std::string& name)
-	: ImageFilter(id, name), learn("learn", "Learn Background", mutex, true), dynamic("dynamic", "Dynamic Background", mutex, false),
-		dynamicLearnRate("dynamicLearnRate", "Dynamic Learn Rate", mutex, 0.01, Constraint<double>(0, 1))
+	: ImageFilter(id, name), learn("learn", "Learn Background", mutex, true),
+		learnFrames("learnFrames", "Learn Frames", mutex, 10, Constraint<unsigned int>(1, 1000)),
+		model("model", "Model", mutex, Running_Average, enum_string_begin<BackgroundModel>(), enum_string_end<BackgroundModel>()),
+		foreground("foreground", "Foreground", mutex, Darker, enum_string_begin<ForegroundPolarity>(),
+			enum_string_end<ForegroundPolarity>()), dynamic("dynamic", "Dynamic Background", mutex, false),
+		dynamicLearnRate("dynamicLearnRate", "Dynamic Learn Rate", mutex, 0.01, Constraint<double>(0, 1)),
+		updateInterval("updateInterval", "Update Interval", mutex, 1, Constraint<unsigned int>(1, 100)),
+		updateMode("updateMode", "Update Mode", mutex, All_Rows, enum_string_begin<BackgroundUpdateMode>(),
+			enum_string_end<BackgroundUpdateMode>()), learnedModel(Running_Average), learnedFrames(0), frameCount(0)
 {
 	settings.add(learn);
+	settings.add(learnFrames);
+	settings.add(model);
+	settings.add(foreground);
 	settings.add(dynamic);
 	settings.add(dynamicLearnRate);
+	settings.add(updateInterval);
+	settings.add(updateMode);
+
+	enableStripedExecution();
 }
 
 void BackgroundFilter::stop()
 {
 	ImageFilter::stop();
 
-	backgroundAccumulatorImage.release();
-	backgroundImage.release();
+	background.release();
+	lowerBound.release();
+	upperBound.release();
+
+	learnedFrames = 0;
+	frameCount = 0;
 }
 
 void BackgroundFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
 {
-	backgroundImage.create(source.size(), source.type());
-	backgroundAccumulatorImage.create(source.size(), CV_32FC(source.channels()));
+	if (source.depth() != CV_8U) {
+		source.copyTo(destination);
+		return;
+	}
+
+	const BackgroundModel currentModel = model;
+	const bool band = (currentModel == Min_Max);
+	cv::Mat& lower = band ? lowerBound : background;
+	cv::Mat& upper = band ? upperBound : background;
 
-	if (learn || dynamic) {
-		double alpha = dynamicLearnRate;
-		if (learn) {
-			alpha = 1;
+	// A model which does not match the images has to be learned anew
+	if (currentModel != learnedModel || lower.size() != source.size() || lower.type() != CV_16UC(source.channels())) {
+		learnedModel = currentModel;
+		learnedFrames = 0;
+		learn = true;
+	}
+
+	if (!learn) {
+		learnedFrames = 0;
+	}
+
+	Update update = { Update::NONE, 0, 1, 0 };
+
+	if (learn) {
+		if (learnedFrames == 0) {
+			lower.create(source.size(), CV_16UC(source.channels()));
+			upper.create(source.size(), CV_16UC(source.channels()));
+			update.kind = Update::INITIALIZE;
+		} else if (band) {
+			update.kind = Update::ENVELOPE;
+		} else {
+			// The average of all learned images
+			update.kind = Update::AVERAGE;
+			update.amount = 65536 / (learnedFrames + 1);
+		}
+
+		if (++learnedFrames >= learnFrames) {
 			learn = false;
 		}
+	} else if (dynamic && dynamicLearnRate > 0) {
+		const int interval = updateInterval;
+		const int phase = frameCount++ % interval;
 
-		cv::accumulateWeighted(source, backgroundAccumulatorImage, alpha);
+		if (updateMode == Rotating_Rows) {
+			update.interval = interval;
+			update.phase = phase;
+		}
 
-		backgroundAccumulatorImage.convertTo(backgroundImage, backgroundImage.type(), 255.0);
+		if (updateMode == Rotating_Rows || phase == 0) {
+			if (currentModel == Running_Average) {
+				update.kind = Update::AVERAGE;
+				update.amount = std::min(std::max(cvRound(dynamicLearnRate * 65536), 1), 0xffff);
+			} else {
+				update.kind = (currentModel == Min_Max) ? Update::BOUNDS : Update::MEDIAN;
+				update.amount = std::min(std::max(cvRound(dynamicLearnRate * 25600), 1), 0xff00);
+			}
+		}
 	}
 
-	// TODO do something better than dividing the image by the background, which is actually not properly removing the bg
-	cv::divide(source, backgroundImage, destination, 255);
-	cv::bitwise_not(destination, destination);
+	applyStriped(source, destination,
+		boost::bind(&subtractBackground, _1, _2, _3, boost::ref(lower), boost::ref(upper), update, ForegroundPolarity(foreground)));
 }
 
 static bool __registered = registerNodeType<BackgroundFilter>();
-
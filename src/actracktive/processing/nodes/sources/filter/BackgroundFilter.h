@@ -23,7 +23,33 @@
 #define BACKGROUNDFILTER_H_
 
 #include "actracktive/processing/nodes/sources/filter/ImageFilter.h"
+#include "actracktive/util/EnumUtils.h"
 
+ENUM_TYPE_DEF(BackgroundModel, (Running_Average)(Running_Median)(Min_Max))
+ENUM_TYPE_DEF(ForegroundPolarity, (Darker)(Brighter)(Darker_And_Brighter))
+ENUM_TYPE_DEF(BackgroundUpdateMode, (All_Rows)(Rotating_Rows))
+
+/**
+ * Subtracts a learned background from 8 bit images, so that only the
+ * foreground remains. The output is the difference between the image and the
+ * background, limited to the selected polarity.
+ *
+ * The background is learned from the first images after learn mode has been
+ * switched on, and optionally adapted to the images afterwards (dynamic
+ * background) using one of the following models:
+ *
+ *   Running_Average: exponential running average with the given learn rate.
+ *   Running_Median:  approximate median, which moves towards each image by a
+ *                    fixed step (one grey level for a learn rate of 0.01).
+ *   Min_Max:         band between the 5% and 95% quantiles of each pixel,
+ *                    tracked with the same steps. Only pixels outside of the
+ *                    band are foreground.
+ *
+ * The models are kept in 8.8 fixed point and updated with integer SIMD
+ * arithmetic. To save time, dynamic updates can be restricted to every Nth
+ * image, either updating all rows at once or a rotating subset of rows for
+ * each image.
+ */
 class BackgroundFilter: public ImageFilter
 {
 public:
@@ -39,11 +65,21 @@ protected:
 
 private:
 	ValueProperty<bool> learn;
+	ValueProperty<unsigned int> learnFrames;
+	ValueProperty<BackgroundModel> model;
+	ValueProperty<ForegroundPolarity> foreground;
 	ValueProperty<bool> dynamic;
 	ValueProperty<double> dynamicLearnRate;
+	ValueProperty<unsigned int> updateInterval;
+	ValueProperty<BackgroundUpdateMode> updateMode;
+
+	cv::Mat background;
+	cv::Mat lowerBound;
+	cv::Mat upperBound;
 
-	cv::Mat backgroundAccumulatorImage;
-	cv::Mat backgroundImage;
+	BackgroundModel learnedModel;
+	unsigned int learnedFrames;
+	unsigned long frameCount;
 
 };
 
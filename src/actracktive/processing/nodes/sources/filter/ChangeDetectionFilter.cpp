@@ -0,0 +1,67 @@
+/*
+ * ChangeDetectionFilter.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "actracktive/processing/nodes/sources/filter/ChangeDetectionFilter.h"
+#include "actracktive/processing/NodeFactory.h"
+
+const Node::Type& ChangeDetectionFilter::TYPE()
+{
+	static const Node::Type type = Node::Type::of<ChangeDetectionFilter>("ChangeDetectionFilter", ImageFilter::TYPE());
+	return type;
+}
+
+const Node::Type& ChangeDetectionFilter::getType() const
+{
+	return TYPE();
+}
+
+ChangeDetectionFilter::ChangeDetectionFilter(const std::string& id, const std::string& name)
+	: ImageFilter(id, name), tileSize("tileSize", "Tile Size", mutex, 32, Constraint<unsigned int>(8, 256, 8)),
+		noiseThreshold("noiseThreshold", "Noise Threshold", mutex, 8, Constraint<unsigned int>(0, 255)),
+		changeThreshold("changeThreshold", "Change Threshold", mutex, 0, Constraint<unsigned int>(0, 100000)), detector(),
+		changes()
+{
+	settings.add(tileSize);
+	settings.add(noiseThreshold);
+	settings.add(changeThreshold);
+}
+
+const DirtyTiles* ChangeDetectionFilter::getDirtyTiles() const
+{
+	return isEnabled() ? &changes : NULL;
+}
+
+void ChangeDetectionFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
+{
+	destination = source;
+
+	if (changes.getTileSize() != int(tileSize)) {
+		detector.reset();
+	}
+
+	detector.detect(source, tileSize, noiseThreshold, changeThreshold, changes);
+
+	// The output gets the next sequence number once this fetch is complete
+	changes.setSequenceNumber(getSequenceNumber() + 1);
+}
+
+static bool __registered = registerNodeType<ChangeDetectionFilter>();
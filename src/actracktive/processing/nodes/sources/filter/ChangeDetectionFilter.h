@@ -0,0 +1,60 @@
+/*
+ * ChangeDetectionFilter.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CHANGEDETECTIONFILTER_H_
+#define CHANGEDETECTIONFILTER_H_
+
+#include "actracktive/processing/nodes/sources/filter/ImageFilter.h"
+#include "actracktive/processing/nodes/sources/ChangeDetector.h"
+
+/**
+ * Passes its source through unchanged, but compares each image in square
+ * tiles with the last version of each tile reported as changed, and reports
+ * the tiles which changed as dirty (see getDirtyTiles() and ChangeDetector).
+ * Filters with tiled execution following it only recompute the dirty tiles.
+ * A tile changes if the sum of all absolute pixel differences exceeding the
+ * noise threshold is larger than the change threshold.
+ */
+class ChangeDetectionFilter: public ImageFilter
+{
+public:
+	static const Node::Type& TYPE();
+	const Node::Type& getType() const;
+
+	ChangeDetectionFilter(const std::string& id, const std::string& name = "Change Detection");
+
+	virtual const DirtyTiles* getDirtyTiles() const;
+
+protected:
+	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination);
+
+private:
+	ValueProperty<unsigned int> tileSize;
+	ValueProperty<unsigned int> noiseThreshold;
+	ValueProperty<unsigned int> changeThreshold;
+
+	ChangeDetector detector;
+	DirtyTiles changes;
+
+};
+
+#endif
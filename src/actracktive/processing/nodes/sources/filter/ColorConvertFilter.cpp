@@ -42,6 +42,11 @@ ColorConvertFilter::ColorConvertFilter(const std::string& id, const std::string&
 	settings.add(conversion);
 }
 
+bool ColorConvertFilter::isStateless() const
+{
+	return true;
+}
+
 void ColorConvertFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
 {
 	cv::Mat preparedSource;
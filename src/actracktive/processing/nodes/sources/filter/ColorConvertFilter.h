@@ -35,6 +35,8 @@ public:
 
 	ColorConvertFilter(const std::string& id, const std::string& name = "Color Conversion");
 
+	virtual bool isStateless() const;
+
 protected:
 	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination);
 
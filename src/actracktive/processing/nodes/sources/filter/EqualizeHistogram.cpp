@@ -38,6 +38,11 @@ EqualizeHistogram::EqualizeHistogram(const std::string& id, const std::string& n
 {
 }
 
+bool EqualizeHistogram::isStateless() const
+{
+	return true;
+}
+
 void EqualizeHistogram::applyFilter(const cv::Mat& source, cv::Mat& destination)
 {
 	cv::equalizeHist(source, destination);
@@ -32,6 +32,8 @@ public:
 
 	EqualizeHistogram(const std::string& id, const std::string& name = "Equalize Histogram");
 
+	virtual bool isStateless() const;
+
 protected:
 	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination);
 
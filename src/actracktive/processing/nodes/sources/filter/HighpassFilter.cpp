@@ -21,6 +21,22 @@
 
 #include "actracktive/processing/nodes/sources/filter/HighpassFilter.h"
 #include "actracktive/processing/NodeFactory.h"
+#include <boost/bind.hpp>
+
+static void highpass(const cv::Mat& source, cv::Mat& destination, int blurStrength, int noiseStrength)
+{
+	if (blurStrength > 1) {
+		cv::blur(source, destination, cv::Size(blurStrength, blurStrength));
+	} else {
+		source.copyTo(destination);
+	}
+
+	destination = source - destination;
+
+	if (noiseStrength > 1) {
+		cv::blur(destination, destination, cv::Size(noiseStrength, noiseStrength));
+	}
+}
 
 const Node::Type& HighpassFilter::TYPE()
 {
@@ -39,21 +55,24 @@ HighpassFilter::HighpassFilter(const std::string& id, const std::string& name)
 {
 	settings.add(blurStrength);
 	settings.add(noiseStrength);
+
+	enableStripedExecution();
+	enableTiledExecution();
 }
 
-void HighpassFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
+bool HighpassFilter::isStateless() const
 {
-	if (blurStrength > 1) {
-		cv::blur(source, destination, cv::Size(blurStrength, blurStrength));
-	} else {
-		source.copyTo(destination);
-	}
+	return true;
+}
 
-	destination = source - destination;
+void HighpassFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
+{
+	int blurStrength = this->blurStrength;
+	int noiseStrength = this->noiseStrength;
 
-	if (noiseStrength > 1) {
-		cv::blur(destination, destination, cv::Size(noiseStrength, noiseStrength));
-	}
+	// Each blur spreads the influence of pixels by half its size
+	applyStriped(source, destination, blurStrength / 2 + noiseStrength / 2,
+		boost::bind(&highpass, _1, _2, blurStrength, noiseStrength));
 }
 
 static bool __registered = registerNodeType<HighpassFilter>();
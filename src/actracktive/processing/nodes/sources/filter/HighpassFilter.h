@@ -32,6 +32,8 @@ public:
 
 	HighpassFilter(const std::string& id, const std::string& name = "Highpass");
 
+	virtual bool isStateless() const;
+
 protected:
 	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination);
 
@@ -20,6 +20,38 @@
  */
 
 #include "actracktive/processing/nodes/sources/filter/ImageFilter.h"
+#include "actracktive/util/WorkerPool.h"
+#include <algorithm>
+#include <boost/bind.hpp>
+
+static const int MIN_STRIPE_ROWS = 32;
+static const int DEFAULT_TILE_SIZE = 32;
+
+static cv::Range getStripeRows(int rows, unsigned int stripe, unsigned int stripeCount)
+{
+	return cv::Range(rows * stripe / stripeCount, rows * (stripe + 1) / stripeCount);
+}
+
+static void applyStripe(const cv::Mat& source, cv::Mat& destination, const cv::Range& rows, int halo,
+	const boost::function<void(const cv::Mat&, cv::Mat&)>& filter, cv::Mat& buffer)
+{
+	cv::Mat stripe = destination.rowRange(rows);
+
+	if (halo == 0) {
+		cv::Mat result = stripe;
+		filter(source.rowRange(rows), result);
+
+		// Filters may assign a new image instead of writing into the given one
+		if (result.data != stripe.data) {
+			result.copyTo(stripe);
+		}
+	} else {
+		cv::Range sourceRows(std::max(0, rows.start - halo), std::min(source.rows, rows.end + halo));
+
+		filter(source.rowRange(sourceRows), buffer);
+		buffer.rowRange(rows.start - sourceRows.start, rows.end - sourceRows.start).copyTo(stripe);
+	}
+}
 
 const Node::Type& ImageFilter::TYPE()
 {
@@ -33,7 +65,10 @@ const Node::Type& ImageFilter::getType() const
 }
 
 ImageFilter::ImageFilter(const std::string& id, const std::string& name)
-	: ImageSource(id, name), source("source", "Source", mutex), enabled("enabled", "Enabled", mutex, true)
+	: ImageSource(id, name), source("source", "Source", mutex), enabled("enabled", "Enabled", mutex, true),
+		threads("threads", "Threads", mutex, 1, Constraint<unsigned int>(1, 16)), stripeBuffers(), injectedFrame(), frameInjected(false),
+		tiled("tiled", "Skip Unchanged Tiles", mutex, true), tiledExecution(false), dirtyTiles(), tiledOutputValid(false),
+		tiledOutput(NULL), tiledSourceSequenceNumber(0), tileBuffer(), fusedChain(), fusedInto(NULL)
 {
 	settings.add(enabled);
 	connections.add(source);
@@ -44,8 +79,83 @@ ImageSource* ImageFilter::getSource() const
 	return source;
 }
 
+double ImageFilter::getScale() const
+{
+	ImageSource* input = source;
+	return (input != NULL) ? input->getScale() : 1;
+}
+
+const DirtyTiles* ImageFilter::getDirtyTiles() const
+{
+	return tiledExecution ? &dirtyTiles : NULL;
+}
+
+void ImageFilter::start()
+{
+	ImageSource::start();
+
+	const Properties::Values& properties = settings.getAll();
+	for (Properties::Values::const_iterator property = properties.begin(); property != properties.end(); ++property) {
+		(*property)->onChange.connect(boost::bind(&ImageFilter::invalidateTiles, this));
+	}
+
+	invalidateTiles();
+}
+
+void ImageFilter::step()
+{
+	// The end of the chain a filter is fused into does not need its output,
+	// so it is only fetched if requested by other consumers or observers
+	if (fusedInto != NULL && sourceDataUpdated.empty()) {
+		Node::step();
+		return;
+	}
+
+	ImageSource::step();
+}
+
+void ImageFilter::stop()
+{
+	ImageSource::stop();
+
+	const Properties::Values& properties = settings.getAll();
+	for (Properties::Values::const_iterator property = properties.begin(); property != properties.end(); ++property) {
+		(*property)->onChange.disconnect(boost::bind(&ImageFilter::invalidateTiles, this));
+	}
+}
+
+bool ImageFilter::isEnabled() const
+{
+	return enabled;
+}
+
+bool ImageFilter::isStateless() const
+{
+	return false;
+}
+
+void ImageFilter::injectFrame(const cv::Mat& frame)
+{
+	Lock lock(this);
+
+	injectedFrame = frame;
+	frameInjected = true;
+}
+
 void ImageFilter::fetch(cv::Mat& destination)
 {
+	if (frameInjected) {
+		destination = injectedFrame;
+		injectedFrame = cv::Mat();
+		frameInjected = false;
+		return;
+	}
+
+	if (!fusedChain.empty()) {
+		fetchFused(destination);
+		return;
+	}
+
 	if (!source) {
 		return;
 	}
@@ -56,9 +166,306 @@ void ImageFilter::fetch(cv::Mat& destination)
 	const cv::Mat& sourceImage = source->get();
 	timer.resume();
 
+	process(sourceImage, destination);
+}
+
+bool ImageFilter::getGeometry(const cv::Size& sourceSize, cv::Size& destinationSize, cv::Mat& transform) const
+{
+	return false;
+}
+
+bool ImageFilter::canApplyRemap() const
+{
+	return false;
+}
+
+bool ImageFilter::applyRemap(const cv::Mat& source, cv::Mat& destination, const cv::Mat& transform, const cv::Size& destinationSize)
+{
+	return false;
+}
+
+void ImageFilter::fuse(const std::vector<ImageFilter*>& chain)
+{
+	unfuse();
+
+	Lock lock(this);
+
+	fusedChain = chain;
+	for (std::vector<ImageFilter*>::const_iterator filter = chain.begin(); filter != chain.end(); ++filter) {
+		Lock filterLock(*filter);
+		(*filter)->fusedInto = this;
+	}
+}
+
+void ImageFilter::unfuse()
+{
+	Lock lock(this);
+
+	for (std::vector<ImageFilter*>::const_iterator filter = fusedChain.begin(); filter != fusedChain.end(); ++filter) {
+		Lock filterLock(*filter);
+		(*filter)->fusedInto = NULL;
+	}
+
+	fusedChain.clear();
+}
+
+void ImageFilter::fetchFused(cv::Mat& destination)
+{
+	// The chain is broken up if any of its connections has been changed
+	bool intact = (getSource() == fusedChain.back());
+	for (std::size_t i = 1; i < fusedChain.size() && intact; ++i) {
+		intact = (fusedChain[i]->getSource() == fusedChain[i - 1]);
+	}
+
+	if (!intact) {
+		unfuse();
+		fetch(destination);
+		return;
+	}
+
+	ImageFilter* head = fusedChain.front();
+	Lock headLock(head);
+
+	ImageSource* input = head->getSource();
+	if (input == NULL) {
+		return;
+	}
+
+	Lock inputLock(input);
+
+	timer.pause();
+	const cv::Mat& sourceImage = input->get();
+	timer.resume();
+
+	// Compose the geometry of all filters following the head, mapping the
+	// final pixels back to pixels of the head's output (which has the size
+	// of its input)
+	cv::Size size = sourceImage.size();
+	cv::Mat transform = cv::Mat::eye(3, 3, CV_64F);
+	bool geometric = head->enabled;
+
+	for (std::size_t i = 1; i <= fusedChain.size() && geometric; ++i) {
+		ImageFilter* filter = (i < fusedChain.size()) ? fusedChain[i] : this;
+		Lock filterLock(filter);
+
+		cv::Size filterSize;
+		cv::Mat filterTransform;
+		geometric = filter->getEnabledGeometry(size, filterSize, filterTransform);
+
+		if (geometric) {
+			transform = transform * filterTransform;
+			size = filterSize;
+		}
+	}
+
+	if (geometric && head->applyRemap(sourceImage, destination, transform, size)) {
+		return;
+	}
+
+	// Otherwise, the chain is processed filter by filter
+	cv::Mat image;
+	head->process(sourceImage, image);
+
+	for (std::size_t i = 1; i < fusedChain.size(); ++i) {
+		Lock filterLock(fusedChain[i]);
+
+		cv::Mat filtered;
+		fusedChain[i]->process(image, filtered);
+		image = filtered;
+	}
+
+	process(image, destination);
+}
+
+void ImageFilter::process(const cv::Mat& source, cv::Mat& destination)
+{
 	if (enabled) {
-		applyFilter(sourceImage, destination);
+		applyFilter(source, destination);
 	} else {
-		sourceImage.copyTo(destination);
+		source.copyTo(destination);
+	}
+}
+
+bool ImageFilter::getEnabledGeometry(const cv::Size& sourceSize, cv::Size& destinationSize, cv::Mat& transform) const
+{
+	if (enabled) {
+		return getGeometry(sourceSize, destinationSize, transform);
 	}
+
+	destinationSize = sourceSize;
+	transform = cv::Mat::eye(3, 3, CV_64F);
+	return true;
+}
+
+void ImageFilter::enableStripedExecution()
+{
+	settings.add(threads);
+}
+
+void ImageFilter::enableTiledExecution()
+{
+	settings.add(tiled);
+	tiledExecution = true;
+}
+
+void ImageFilter::applyStriped(const cv::Mat& source, cv::Mat& destination, int halo, const StripeFilter& filter)
+{
+	// Only worthwhile if most of the image is unchanged, as each run of dirty
+	// tiles is computed including its halo
+	if (updateDirtyTiles(source, destination, halo)
+		&& dirtyTiles.getDirtyCount() * 2 < (unsigned int) (dirtyTiles.getColumns() * dirtyTiles.getRows())) {
+		for (int row = 0; row < dirtyTiles.getRows(); ++row) {
+			for (int column = 0; column < dirtyTiles.getColumns(); ++column) {
+				if (!dirtyTiles.isDirty(column, row)) {
+					continue;
+				}
+
+				cv::Rect tiles = dirtyTiles.getTile(column, row);
+				while (column + 1 < dirtyTiles.getColumns() && dirtyTiles.isDirty(column + 1, row)) {
+					tiles = tiles | dirtyTiles.getTile(++column, row);
+				}
+
+				cv::Rect region = cv::Rect(tiles.x - halo, tiles.y - halo, tiles.width + 2 * halo, tiles.height + 2 * halo)
+					& cv::Rect(0, 0, source.cols, source.rows);
+				cv::Mat target = destination(tiles);
+
+				filter(source(region), tileBuffer);
+				tileBuffer(cv::Rect(tiles.x - region.x, tiles.y - region.y, tiles.width, tiles.height)).copyTo(target);
+			}
+		}
+
+		return;
+	}
+
+	unsigned int stripeCount = getStripeCount(source.rows, halo);
+	if (stripeCount <= 1) {
+		filter(source, destination);
+		tiledOutput = destination.data;
+		return;
+	}
+
+	destination.create(source.size(), source.type());
+	stripeBuffers.resize(stripeCount);
+
+	WorkerPool::Group group;
+	for (unsigned int stripe = 1; stripe < stripeCount; ++stripe) {
+		group.run(
+			boost::bind(&applyStripe, boost::cref(source), boost::ref(destination), getStripeRows(source.rows, stripe, stripeCount), halo,
+				boost::cref(filter), boost::ref(stripeBuffers[stripe])));
+	}
+
+	applyStripe(source, destination, getStripeRows(source.rows, 0, stripeCount), halo, filter, stripeBuffers[0]);
+
+	group.wait();
+
+	tiledOutput = destination.data;
+}
+
+void ImageFilter::applyStriped(const cv::Mat& source, cv::Mat& destination, const RowFilter& filter)
+{
+	if (updateDirtyTiles(source, destination, 0)) {
+		for (int row = 0; row < dirtyTiles.getRows(); ++row) {
+			for (int column = 0; column < dirtyTiles.getColumns(); ++column) {
+				if (dirtyTiles.isDirty(column, row)) {
+					cv::Rect tile = dirtyTiles.getTile(column, row);
+					filter(source, destination, cv::Range(tile.y, tile.y + tile.height));
+					break;
+				}
+			}
+		}
+
+		return;
+	}
+
+	destination.create(source.size(), source.type());
+	tiledOutput = destination.data;
+
+	unsigned int stripeCount = getStripeCount(source.rows, 0);
+	if (stripeCount <= 1) {
+		filter(source, destination, cv::Range(0, source.rows));
+		return;
+	}
+
+	WorkerPool::Group group;
+	for (unsigned int stripe = 1; stripe < stripeCount; ++stripe) {
+		group.run(boost::bind(filter, boost::cref(source), boost::ref(destination), getStripeRows(source.rows, stripe, stripeCount)));
+	}
+
+	filter(source, destination, getStripeRows(source.rows, 0, stripeCount));
+
+	group.wait();
+}
+
+void ImageFilter::runStriped(int count, int rowsPerUnit, const RangeTask& task)
+{
+	unsigned int stripeCount = getStripeCount(count * std::max(rowsPerUnit, 1), 0);
+	stripeCount = std::max(1, std::min<int>(stripeCount, count));
+	if (stripeCount <= 1) {
+		task(cv::Range(0, count));
+		return;
+	}
+
+	WorkerPool::Group group;
+	for (unsigned int stripe = 1; stripe < stripeCount; ++stripe) {
+		group.run(boost::bind(task, getStripeRows(count, stripe, stripeCount)));
+	}
+
+	task(getStripeRows(count, 0, stripeCount));
+
+	group.wait();
+}
+
+/*
+ * Determines the dirty tiles of the output and returns true if the previous
+ * output can be kept for all clean tiles. This requires the dirty tiles of
+ * the source to describe the change since the image this filter processed
+ * the last time, and that nothing else changed the output in between.
+ */
+bool ImageFilter::updateDirtyTiles(const cv::Mat& source, const cv::Mat& destination, int halo)
+{
+	if (!tiledExecution) {
+		return false;
+	}
+
+	ImageSource* input = getSource();
+	const DirtyTiles* inputTiles = (input != NULL) ? input->getDirtyTiles() : NULL;
+	unsigned long inputSequenceNumber = (input != NULL) ? input->getSequenceNumber() : 0;
+
+	bool reuse = tiled && isStateless() && inputTiles != NULL && inputTiles->getSequenceNumber() == inputSequenceNumber
+		&& inputTiles->getImageSize() == source.size() && tiledOutputValid && tiledSourceSequenceNumber + 1 == inputSequenceNumber
+		&& destination.data != NULL && destination.data == tiledOutput && destination.size() == source.size()
+		&& destination.type() == source.type();
+
+	tiledOutputValid = true;
+	tiledSourceSequenceNumber = inputSequenceNumber;
+
+	if (reuse) {
+		dirtyTiles = *inputTiles;
+		dirtyTiles.dilate(halo);
+	} else {
+		dirtyTiles.reset(source.size(), (inputTiles != NULL) ? inputTiles->getTileSize() : DEFAULT_TILE_SIZE, true);
+	}
+
+	// The output gets the next sequence number once this fetch is complete
+	dirtyTiles.setSequenceNumber(getSequenceNumber() + 1);
+
+	return reuse;
+}
+
+void ImageFilter::invalidateTiles()
+{
+	Lock lock(this);
+
+	tiledOutputValid = false;
+}
+
+unsigned int ImageFilter::getStripeCount(int rows, int halo) const
+{
+	unsigned int stripeCount = std::min<unsigned int>(threads, WorkerPool::getShared().getThreadCount() + 1);
+
+	// Stripes much smaller than their halo would mostly compute rows which
+	// are thrown away afterwards.
+	int minRows = std::max(MIN_STRIPE_ROWS, 4 * halo);
+
+	return std::max(1, std::min<int>(stripeCount, rows / minRows));
 }
@@ -23,6 +23,8 @@
 #define IMAGEFILTER_H_
 
 #include "actracktive/processing/nodes/sources/ImageSource.h"
+#include <vector>
+#include <boost/function.hpp>
 
 class ImageFilter: public ImageSource
 {
@@ -32,7 +34,68 @@ public:
 
 	virtual ImageSource* getSource() const;
 
+	/**
+	 * Filters keep the scale of their source.
+	 */
+	virtual double getScale() const;
+
+	/**
+	 * Stateless filters compute their output solely from the current input
+	 * image and their settings, so they can be applied to several frames
+	 * concurrently (using separate instances). Filters keeping any temporal
+	 * state (e.g. learned images) must return false.
+	 */
+	virtual bool isStateless() const;
+
+	virtual const DirtyTiles* getDirtyTiles() const;
+
+	virtual void start();
+	virtual void step();
+	virtual void stop();
+
+	/**
+	 * Makes the next fetch deliver the given (precomputed) frame instead of
+	 * pulling the source and applying the filter.
+	 */
+	virtual void injectFrame(const cv::Mat& frame);
+
+	/**
+	 * Geometric filters only move pixels around. They return true and set
+	 * transform to the 3x3 matrix (CV_64F) mapping each destination pixel to
+	 * the position of its source pixel, and destinationSize to the size of
+	 * their output for images of sourceSize. All other filters return false.
+	 */
+	virtual bool getGeometry(const cv::Size& sourceSize, cv::Size& destinationSize, cv::Mat& transform) const;
+
+	/**
+	 * Returns true if applyRemap() is supported (and currently enabled).
+	 */
+	virtual bool canApplyRemap() const;
+
+	/**
+	 * Applies this filter followed by the given geometric transform (as
+	 * returned by getGeometry()) in a single pass, producing an image of
+	 * destinationSize. Returns false if this is not possible.
+	 */
+	virtual bool applyRemap(const cv::Mat& source, cv::Mat& destination, const cv::Mat& transform, const cv::Size& destinationSize);
+
+	/**
+	 * Makes this filter produce the output of the whole chain of filters
+	 * ending with it, by applying the first filter of the chain together with
+	 * all following (geometric) filters using applyRemap(). The chain is
+	 * given in processing order, excluding this filter. While fused, all
+	 * other filters of the chain are no longer fetched in each step, but
+	 * still produce their own output on demand (for other consumers, or if
+	 * their data updates are observed).
+	 */
+	void fuse(const std::vector<ImageFilter*>& chain);
+	void unfuse();
+
 protected:
+	typedef boost::function<void(const cv::Mat&, cv::Mat&)> StripeFilter;
+	typedef boost::function<void(const cv::Mat&, cv::Mat&, const cv::Range&)> RowFilter;
+	typedef boost::function<void(const cv::Range&)> RangeTask;
+
 	TypedNodeConnection<ImageSource> source;
 
 	ImageFilter(const std::string& id, const std::string& name);
@@ -40,8 +103,80 @@ protected:
 	virtual void fetch(cv::Mat& destination);
 	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination) = 0;
 
+	bool isEnabled() const;
+
+	/**
+	 * Adds the "threads" setting, which limits the number of horizontal
+	 * stripes applyStriped() splits an image into.
+	 */
+	void enableStripedExecution();
+
+	/**
+	 * Adds the "tiled" setting. If enabled and the source reports its dirty
+	 * tiles (see ChangeDetectionFilter), applyStriped() only recomputes the
+	 * tiles affected by changes and keeps the previous output for all others.
+	 * This is only suitable for stateless filters whose output pixels depend
+	 * on a square neighbourhood of at most halo pixels (row filters on the
+	 * same pixel only), and whose output changes only with their settings.
+	 */
+	void enableTiledExecution();
+
+	/**
+	 * Applies filter to horizontal stripes of source concurrently. Each stripe
+	 * is extended by halo rows above and below (where available), so that
+	 * filters depending on a neighbourhood of up to halo rows produce the
+	 * same result as if applied to the whole image. The filter must produce
+	 * an image of the same size and type as its input.
+	 *
+	 * The filter is executed on other threads while this node is locked, so
+	 * it must not access any properties. Instead, their values have to be
+	 * bound to the filter.
+	 */
+	void applyStriped(const cv::Mat& source, cv::Mat& destination, int halo, const StripeFilter& filter);
+
+	/**
+	 * Like above, but the filter gets the whole source and destination images
+	 * (the latter already allocated with the size and type of the source) and
+	 * must only write the given rows of the destination.
+	 */
+	void applyStriped(const cv::Mat& source, cv::Mat& destination, const RowFilter& filter);
+
+	/**
+	 * Runs task concurrently for consecutive ranges of [0, count), for
+	 * filters processing an image in units (e.g. rows of tiles) which each
+	 * cover the given number of image rows. The number of ranges is chosen
+	 * as for applyStriped(), and the same restrictions apply to the task.
+	 */
+	void runStriped(int count, int rowsPerUnit, const RangeTask& task);
+
 private:
 	ValueProperty<bool> enabled;
+	ValueProperty<unsigned int> threads;
+
+	std::vector<cv::Mat> stripeBuffers;
+
+	unsigned int getStripeCount(int rows, int halo) const;
+
+	cv::Mat injectedFrame;
+	bool frameInjected;
+
+	ValueProperty<bool> tiled;
+	bool tiledExecution;
+	DirtyTiles dirtyTiles;
+	bool tiledOutputValid;
+	const uchar* tiledOutput;
+	unsigned long tiledSourceSequenceNumber;
+	cv::Mat tileBuffer;
+
+	bool updateDirtyTiles(const cv::Mat& source, const cv::Mat& destination, int halo);
+	void invalidateTiles();
+
+	std::vector<ImageFilter*> fusedChain;
+	ImageFilter* fusedInto;
+
+	void fetchFused(cv::Mat& destination);
+	void process(const cv::Mat& source, cv::Mat& destination);
+	bool getEnabledGeometry(const cv::Size& sourceSize, cv::Size& destinationSize, cv::Mat& transform) const;
 
 };
 
@@ -45,6 +45,23 @@ ImageMaskFilter::ImageMaskFilter(const std::string& id, const std::string& name)
 	settings.add(bottom);
 }
 
+bool ImageMaskFilter::isStateless() const
+{
+	return true;
+}
+
+bool ImageMaskFilter::getGeometry(const cv::Size& sourceSize, cv::Size& destinationSize, cv::Mat& transform) const
+{
+	cv::Rect roi = getROI(sourceSize);
+
+	destinationSize = roi.size();
+	transform = cv::Mat::eye(3, 3, CV_64F);
+	transform.at<double>(0, 2) = roi.x;
+	transform.at<double>(1, 2) = roi.y;
+
+	return true;
+}
+
 void ImageMaskFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
 {
 	source(getROI(source.size())).copyTo(destination);
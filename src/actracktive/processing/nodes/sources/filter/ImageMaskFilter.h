@@ -32,6 +32,9 @@ public:
 
 	ImageMaskFilter(const std::string& id, const std::string& name = "Image Mask");
 
+	virtual bool isStateless() const;
+	virtual bool getGeometry(const cv::Size& sourceSize, cv::Size& destinationSize, cv::Mat& transform) const;
+
 protected:
 	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination);
 
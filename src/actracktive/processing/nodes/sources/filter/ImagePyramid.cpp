@@ -0,0 +1,140 @@
+/*
+ * ImagePyramid.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/nodes/sources/filter/ImagePyramid.h"
+#include "actracktive/processing/NodeFactory.h"
+#include <algorithm>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static const unsigned long INVALID_SEQUENCE_NUMBER = std::numeric_limits<unsigned long>::max();
+
+const unsigned int ImagePyramid::MAX_LEVEL;
+
+const Node::Type& ImagePyramid::TYPE()
+{
+	static const Node::Type type = Node::Type::of<ImagePyramid>("ImagePyramid", ImageFilter::TYPE());
+	return type;
+}
+
+const Node::Type& ImagePyramid::getType() const
+{
+	return TYPE();
+}
+
+ImagePyramid::ImagePyramid(const std::string& id, const std::string& name)
+	: ImageFilter(id, name), levels(MAX_LEVEL + 1), levelSequenceNumbers(MAX_LEVEL + 1, INVALID_SEQUENCE_NUMBER)
+{
+}
+
+bool ImagePyramid::isStateless() const
+{
+	return true;
+}
+
+void ImagePyramid::start()
+{
+	ImageFilter::start();
+
+	Lock lock(this);
+
+	std::fill(levelSequenceNumbers.begin(), levelSequenceNumbers.end(), INVALID_SEQUENCE_NUMBER);
+}
+
+const cv::Mat& ImagePyramid::getLevel(unsigned int level)
+{
+	Lock lock(this);
+
+	const cv::Mat& image = get();
+	if (level == 0) {
+		return image;
+	}
+
+	level = std::min(level, MAX_LEVEL);
+
+	unsigned long sequenceNumber = getSequenceNumber();
+	for (unsigned int i = 1; i <= level; ++i) {
+		if (levelSequenceNumbers[i] != sequenceNumber) {
+			reduce((i == 1) ? image : levels[i - 1], levels[i]);
+			levelSequenceNumbers[i] = sequenceNumber;
+		}
+	}
+
+	return levels[level];
+}
+
+void ImagePyramid::reduce(const cv::Mat& source, cv::Mat& destination)
+{
+	const int channels = source.channels();
+	const int width = source.cols / 2;
+	const int height = source.rows / 2;
+
+	// Area interpolation averages the same 2x2 blocks for all other depths
+	if (source.depth() != CV_8U && width > 0 && height > 0) {
+		cv::resize(source, destination, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+		return;
+	}
+
+	destination.create(height, width, source.type());
+
+	for (int y = 0; y < height; ++y) {
+		const uchar* upper = source.ptr<uchar>(2 * y);
+		const uchar* lower = source.ptr<uchar>(2 * y + 1);
+		uchar* output = destination.ptr<uchar>(y);
+
+		int x = 0;
+
+#ifdef __SSE2__
+		if (channels == 1) {
+			const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+			const __m128i rounding = _mm_set1_epi16(2);
+
+			for (; x <= width - 8; x += 8) {
+				__m128i upperPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(upper + 2 * x));
+				__m128i lowerPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lower + 2 * x));
+
+				// Each 16 bit word holds a horizontal pair of pixels
+				__m128i sums = _mm_add_epi16(_mm_and_si128(upperPixels, lowBytes), _mm_srli_epi16(upperPixels, 8));
+				sums = _mm_add_epi16(sums, _mm_add_epi16(_mm_and_si128(lowerPixels, lowBytes), _mm_srli_epi16(lowerPixels, 8)));
+				sums = _mm_srli_epi16(_mm_add_epi16(sums, rounding), 2);
+
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(output + x), _mm_packus_epi16(sums, sums));
+			}
+		}
+#endif
+
+		for (int i = x * channels; i < width * channels; ++i) {
+			int left = 2 * i - i % channels;
+			int right = left + channels;
+			output[i] = uchar((upper[left] + upper[right] + lower[left] + lower[right] + 2) >> 2);
+		}
+	}
+}
+
+void ImagePyramid::applyFilter(const cv::Mat& source, cv::Mat& destination)
+{
+	destination = source;
+}
+
+static bool __registered = registerNodeType<ImagePyramid>();
@@ -0,0 +1,70 @@
+/*
+ * ImagePyramid.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEPYRAMID_H_
+#define IMAGEPYRAMID_H_
+
+#include "actracktive/processing/nodes/sources/filter/ImageFilter.h"
+#include <vector>
+
+/**
+ * Passes its input on unchanged and provides reduced versions of it (each
+ * level halving the resolution of the previous one) to PyramidLevel nodes.
+ * Each level is computed at most once per image, and only if requested, so
+ * several branches of the graph can share them.
+ */
+class ImagePyramid: public ImageFilter
+{
+public:
+	static const unsigned int MAX_LEVEL = 3;
+
+	static const Node::Type& TYPE();
+	const Node::Type& getType() const;
+
+	ImagePyramid(const std::string& id, const std::string& name = "Image Pyramid");
+
+	virtual bool isStateless() const;
+
+	virtual void start();
+
+	/**
+	 * Returns the current image reduced by 2^level (level 0 being the image
+	 * itself).
+	 */
+	const cv::Mat& getLevel(unsigned int level);
+
+	/**
+	 * Reduces source to half its width and height (rounded down) by
+	 * averaging blocks of 2x2 pixels. Images of other depths than 8 bit are
+	 * reduced by cv::resize().
+	 */
+	static void reduce(const cv::Mat& source, cv::Mat& destination);
+
+protected:
+	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination);
+
+private:
+	std::vector<cv::Mat> levels;
+	std::vector<unsigned long> levelSequenceNumbers;
+
+};
+
+#endif
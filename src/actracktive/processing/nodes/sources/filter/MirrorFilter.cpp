@@ -21,6 +21,21 @@
 
 #include "actracktive/processing/nodes/sources/filter/MirrorFilter.h"
 #include "actracktive/processing/NodeFactory.h"
+#include <boost/bind.hpp>
+
+static void mirror(const cv::Mat& source, cv::Mat& destination, const cv::Range& rows, bool vertically, bool horizontally)
+{
+	cv::Mat stripe = destination.rowRange(rows);
+
+	if (vertically) {
+		cv::Range sourceRows(source.rows - rows.end, source.rows - rows.start);
+		cv::flip(source.rowRange(sourceRows), stripe, horizontally ? -1 : 0);
+	} else if (horizontally) {
+		cv::flip(source.rowRange(rows), stripe, 1);
+	} else {
+		source.rowRange(rows).copyTo(stripe);
+	}
+}
 
 const Node::Type& MirrorFilter::TYPE()
 {
@@ -35,21 +50,40 @@ const Node::Type& MirrorFilter::getType() const
 
 MirrorFilter::MirrorFilter(const std::string& id, const std::string& name)
 	: ImageFilter(id, name), mirrorVertically("mirrorVertically", "Vertical", mutex, false),
-		mirrorHorizontally("mirrorVertically", "Vertical", mutex, false)
+		mirrorHorizontally("mirrorHorizontally", "Horizontal", mutex, false)
 {
 	settings.add(mirrorVertically);
 	settings.add(mirrorHorizontally);
+
+	enableStripedExecution();
 }
 
-void MirrorFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
+bool MirrorFilter::isStateless() const
+{
+	return true;
+}
+
+bool MirrorFilter::getGeometry(const cv::Size& sourceSize, cv::Size& destinationSize, cv::Mat& transform) const
 {
-	if (mirrorVertically && mirrorHorizontally) {
-		cv::flip(source, destination, -1);
-	} else if (mirrorVertically) {
-		cv::flip(source, destination, 0);
-	} else if (mirrorHorizontally) {
-		cv::flip(source, destination, 1);
+	destinationSize = sourceSize;
+	transform = cv::Mat::eye(3, 3, CV_64F);
+
+	if (mirrorHorizontally) {
+		transform.at<double>(0, 0) = -1;
+		transform.at<double>(0, 2) = sourceSize.width - 1;
 	}
+
+	if (mirrorVertically) {
+		transform.at<double>(1, 1) = -1;
+		transform.at<double>(1, 2) = sourceSize.height - 1;
+	}
+
+	return true;
+}
+
+void MirrorFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
+{
+	applyStriped(source, destination, boost::bind(&mirror, _1, _2, _3, bool(mirrorVertically), bool(mirrorHorizontally)));
 }
 
 static bool __registered = registerNodeType<MirrorFilter>();
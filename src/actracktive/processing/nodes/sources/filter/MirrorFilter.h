@@ -32,6 +32,9 @@ public:
 
 	MirrorFilter(const std::string& id, const std::string& name = "Mirror");
 
+	virtual bool isStateless() const;
+	virtual bool getGeometry(const cv::Size& sourceSize, cv::Size& destinationSize, cv::Mat& transform) const;
+
 protected:
 	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination);
 
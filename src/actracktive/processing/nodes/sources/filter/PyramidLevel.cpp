@@ -0,0 +1,72 @@
+/*
+ * PyramidLevel.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/processing/nodes/sources/filter/PyramidLevel.h"
+#include "actracktive/processing/nodes/sources/filter/ImagePyramid.h"
+#include "actracktive/processing/NodeFactory.h"
+
+const Node::Type& PyramidLevel::TYPE()
+{
+	static const Node::Type type = Node::Type::of<PyramidLevel>("PyramidLevel", ImageFilter::TYPE());
+	return type;
+}
+
+const Node::Type& PyramidLevel::getType() const
+{
+	return TYPE();
+}
+
+PyramidLevel::PyramidLevel(const std::string& id, const std::string& name)
+	: ImageFilter(id, name), level("level", "Level", mutex, 1, Constraint<unsigned int>(1, ImagePyramid::MAX_LEVEL))
+{
+	settings.add(level);
+}
+
+bool PyramidLevel::isStateless() const
+{
+	return true;
+}
+
+double PyramidLevel::getScale() const
+{
+	double scale = ImageFilter::getScale();
+	return isEnabled() ? scale * (1 << level) : scale;
+}
+
+void PyramidLevel::applyFilter(const cv::Mat& source, cv::Mat& destination)
+{
+	ImagePyramid* pyramid = dynamic_cast<ImagePyramid*>(getSource());
+	if (pyramid != NULL) {
+		pyramid->getLevel(level).copyTo(destination);
+		return;
+	}
+
+	const unsigned int levels = level;
+
+	const cv::Mat* image = &source;
+	for (unsigned int i = 0; i < levels; ++i) {
+		cv::Mat& reduced = (i + 1 == levels) ? destination : buffers[i % 2];
+		ImagePyramid::reduce(*image, reduced);
+		image = &reduced;
+	}
+}
+
+static bool __registered = registerNodeType<PyramidLevel>();
@@ -21,6 +21,93 @@
 
 #include "actracktive/processing/nodes/sources/filter/ShadingCorrectionFilter.h"
 #include "actracktive/processing/NodeFactory.h"
+#include <boost/bind.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * The correction multiplies each pixel by a gain of 255 / shading, stored in
+ * 8.8 fixed point. The result is rounded half up and deviates from an exact
+ * division by at most one grey level.
+ */
+static void correctShading(const cv::Mat& source, const cv::Mat& gain, cv::Mat& destination, const cv::Range& rows)
+{
+	const int width = source.cols * source.channels();
+
+	for (int y = rows.start; y < rows.end; ++y) {
+		const uchar* input = source.ptr<uchar>(y);
+		const ushort* gains = gain.ptr<ushort>(y);
+		uchar* output = destination.ptr<uchar>(y);
+
+		int x = 0;
+
+#ifdef __SSE2__
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i maxValue = _mm_set1_epi16(255);
+
+		for (; x <= width - 16; x += 16) {
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + x));
+			__m128i low = _mm_slli_epi16(_mm_unpacklo_epi8(pixels, zero), 8);
+			__m128i high = _mm_slli_epi16(_mm_unpackhi_epi8(pixels, zero), 8);
+			__m128i lowGains = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gains + x));
+			__m128i highGains = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gains + x + 8));
+
+			// (pixel << 8) * gain >> 16, plus bit 15 of the product for rounding
+			low = _mm_add_epi16(_mm_mulhi_epu16(low, lowGains), _mm_srli_epi16(_mm_mullo_epi16(low, lowGains), 15));
+			high = _mm_add_epi16(_mm_mulhi_epu16(high, highGains), _mm_srli_epi16(_mm_mullo_epi16(high, highGains), 15));
+
+			// Unsigned minimum, as packing saturates signed values
+			low = _mm_subs_epu16(low, _mm_subs_epu16(low, maxValue));
+			high = _mm_subs_epu16(high, _mm_subs_epu16(high, maxValue));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + x), _mm_packus_epi16(low, high));
+		}
+#endif
+
+		for (; x < width; ++x) {
+			unsigned int value = (input[x] * gains[x] + 128) >> 8;
+			output[x] = value > 255 ? 255 : value;
+		}
+	}
+}
+
+/*
+ * Integer running average with a weight of 1/8 for the new image, stored in
+ * 8.8 fixed point: accumulator = accumulator - accumulator / 8 + source * 32.
+ */
+static void accumulateShading(const cv::Mat& source, cv::Mat& accumulator)
+{
+	const int width = source.cols * source.channels();
+
+	for (int y = 0; y < source.rows; ++y) {
+		const uchar* input = source.ptr<uchar>(y);
+		ushort* accumulated = accumulator.ptr<ushort>(y);
+
+		int x = 0;
+
+#ifdef __SSE2__
+		const __m128i zero = _mm_setzero_si128();
+
+		for (; x <= width - 16; x += 16) {
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + x));
+			__m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(accumulated + x));
+			__m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(accumulated + x + 8));
+
+			low = _mm_add_epi16(_mm_sub_epi16(low, _mm_srli_epi16(low, 3)), _mm_slli_epi16(_mm_unpacklo_epi8(pixels, zero), 5));
+			high = _mm_add_epi16(_mm_sub_epi16(high, _mm_srli_epi16(high, 3)), _mm_slli_epi16(_mm_unpackhi_epi8(pixels, zero), 5));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(accumulated + x), low);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(accumulated + x + 8), high);
+		}
+#endif
+
+		for (; x < width; ++x) {
+			accumulated[x] = accumulated[x] - (accumulated[x] >> 3) + (input[x] << 5);
+		}
+	}
+}
 
 const Node::Type& ShadingCorrectionFilter::TYPE()
 {
@@ -42,6 +129,9 @@ ShadingCorrectionFilter::ShadingCorrectionFilter(const std::string& id, const st
 	settings.add(offset);
 	settings.add(learn);
 	settings.add(outputShading);
+
+	enableStripedExecution();
+	enableTiledExecution();
 }
 
 void ShadingCorrectionFilter::configure(ConfigurationContext& context) throw (ConfigurationError)
@@ -71,6 +161,8 @@ void ShadingCorrectionFilter::save(ConfigurationContext& context) throw (Configu
 
 	Lock lock(this);
 
+	updateLearnedShading();
+
 	context.setValue("width", shading.size().width);
 	context.setValue("height", shading.size().height);
 	context.setValue("type", shading.type());
@@ -95,19 +187,32 @@ void ShadingCorrectionFilter::stop()
 	learn.onChange.disconnect(boost::bind(&ShadingCorrectionFilter::learnChanged, this));
 }
 
+bool ShadingCorrectionFilter::isStateless() const
+{
+	return !learn;
+}
+
 void ShadingCorrectionFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
 {
 	if (learn) {
-		shadingAccumulator.create(source.size(), CV_32FC(source.channels()));
-		cv::accumulateWeighted(source, shadingAccumulator, 0.1);
+		int accumulatorType = (source.depth() == CV_8U) ? CV_16UC(source.channels()) : CV_32FC(source.channels());
 
-		shadingAccumulator.convertTo(shading, source.type());
+		if (shadingAccumulator.size() != source.size() || shadingAccumulator.type() != accumulatorType) {
+			source.convertTo(shadingAccumulator, accumulatorType, (source.depth() == CV_8U) ? 256 : 1);
+			shading.create(source.size(), source.type());
+		} else if (source.depth() == CV_8U) {
+			accumulateShading(source, shadingAccumulator);
+		} else {
+			cv::accumulateWeighted(source, shadingAccumulator, 0.1);
+		}
 	}
 
 	if (shadingCorrection.empty() || shadingCorrection.type() != source.type() || shadingCorrection.size() != source.size()) {
 		source.copyTo(destination);
 	} else if (outputShading) {
 		shadingCorrection.copyTo(destination);
+	} else if (source.depth() == CV_8U) {
+		applyStriped(source, destination, boost::bind(&correctShading, _1, boost::cref(gain), _2, _3));
 	} else {
 		cv::divide(source, shadingCorrection, destination, 255);
 	}
@@ -117,11 +222,22 @@ void ShadingCorrectionFilter::learnChanged()
 {
 	Lock lock(this);
 
+	// Finishing a learning phase makes its result the new shading, starting
+	// one accumulates from the next image on.
+	updateLearnedShading();
 	shadingAccumulator.release();
 
 	updateShadingCorrection();
 }
 
+void ShadingCorrectionFilter::updateLearnedShading()
+{
+	if (!shadingAccumulator.empty()) {
+		double scale = (shadingAccumulator.depth() == CV_16U) ? 1.0 / 256 : 1.0;
+		shadingAccumulator.convertTo(shading, shading.type(), scale);
+	}
+}
+
 void ShadingCorrectionFilter::updateShadingCorrection()
 {
 	Lock lock(this);
@@ -135,6 +251,28 @@ void ShadingCorrectionFilter::updateShadingCorrection()
 	if (smooth > 1) {
 		cv::GaussianBlur(shadingCorrection, shadingCorrection, cv::Size(smooth, smooth), 0);
 	}
+
+	updateGain();
+}
+
+void ShadingCorrectionFilter::updateGain()
+{
+	if (shadingCorrection.depth() != CV_8U) {
+		gain.release();
+		return;
+	}
+
+	gain.create(shadingCorrection.size(), CV_16UC(shadingCorrection.channels()));
+
+	const int width = shadingCorrection.cols * shadingCorrection.channels();
+	for (int y = 0; y < shadingCorrection.rows; ++y) {
+		const uchar* shades = shadingCorrection.ptr<uchar>(y);
+		ushort* gains = gain.ptr<ushort>(y);
+
+		for (int x = 0; x < width; ++x) {
+			gains[x] = (shades[x] == 0) ? 0 : ushort((255 * 256 + shades[x] / 2) / shades[x]);
+		}
+	}
 }
 
 static bool __registered = registerNodeType<ShadingCorrectionFilter>();
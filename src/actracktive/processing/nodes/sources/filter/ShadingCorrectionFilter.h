@@ -31,6 +31,10 @@
  * learn mode, which starts accumulating all subsequent images into the white
  * image until learn mode is switched off again. The "black" image is assumed
  * to be zero (0) at all times.
+ *
+ * For 8 bit images, the correction is precomputed as per-pixel gain in fixed
+ * point whenever the shading changes, and learning uses an integer running
+ * average.
  */
 class ShadingCorrectionFilter: public ImageFilter
 {
@@ -40,6 +44,8 @@ public:
 
 	ShadingCorrectionFilter(const std::string& id, const std::string& name = "Shading Correction");
 
+	virtual bool isStateless() const;
+
 	virtual void configure(ConfigurationContext& context) throw (ConfigurationError);
 	virtual void save(ConfigurationContext& context) throw (ConfigurationError);
 
@@ -59,9 +65,12 @@ private:
 	cv::Mat shading;
 
 	cv::Mat shadingCorrection;
+	cv::Mat gain;
 
 	void learnChanged();
+	void updateLearnedShading();
 	void updateShadingCorrection();
+	void updateGain();
 
 };
 
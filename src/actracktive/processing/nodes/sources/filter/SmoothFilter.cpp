@@ -21,28 +21,291 @@
 
 #include "actracktive/processing/nodes/sources/filter/SmoothFilter.h"
 #include "actracktive/processing/NodeFactory.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <boost/bind.hpp>
 
-const Node::Type& SmoothFilter::TYPE()
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+typedef unsigned short Count;
+
+static const int BINS = 16;
+
+/*
+ * Adds (or subtracts) a histogram of 16 bins.
+ */
+static inline void addHistogram(Count* histogram, const Count* other)
 {
-	static const Node::Type type = Node::Type::of<SmoothFilter>("SmoothFilter", ImageFilter::TYPE());
-	return type;
+#ifdef __SSE2__
+	__m128i* target = reinterpret_cast<__m128i*>(histogram);
+	const __m128i* source = reinterpret_cast<const __m128i*>(other);
+	_mm_storeu_si128(target, _mm_add_epi16(_mm_loadu_si128(target), _mm_loadu_si128(source)));
+	_mm_storeu_si128(target + 1, _mm_add_epi16(_mm_loadu_si128(target + 1), _mm_loadu_si128(source + 1)));
+#else
+	for (int i = 0; i < BINS; ++i) {
+		histogram[i] += other[i];
+	}
+#endif
 }
 
-const Node::Type& SmoothFilter::getType() const
+static inline void subtractHistogram(Count* histogram, const Count* other)
 {
-	return TYPE();
+#ifdef __SSE2__
+	__m128i* target = reinterpret_cast<__m128i*>(histogram);
+	const __m128i* source = reinterpret_cast<const __m128i*>(other);
+	_mm_storeu_si128(target, _mm_sub_epi16(_mm_loadu_si128(target), _mm_loadu_si128(source)));
+	_mm_storeu_si128(target + 1, _mm_sub_epi16(_mm_loadu_si128(target + 1), _mm_loadu_si128(source + 1)));
+#else
+	for (int i = 0; i < BINS; ++i) {
+		histogram[i] -= other[i];
+	}
+#endif
 }
 
-SmoothFilter::SmoothFilter(const std::string& id, const std::string& name)
-	: ImageFilter(id, name), strength("strength", "Strength", mutex, 1, Constraint<unsigned int>(1, 21, 2)),
-		method("method", "Method", mutex, Normalized_Box, enum_string_begin<BlurMethod>(), enum_string_end<BlurMethod>())
+/*
+ * Median filter in constant time per pixel (regardless of the radius) after
+ * Perreault and Hebert: a histogram per column is moved down row by row,
+ * and the kernel histogram is moved right by adding and removing column
+ * histograms. Histograms are split into 16 coarse bins and, per coarse bin,
+ * 16 fine bins, which are only brought up to date where the median is
+ * searched. Borders are replicated, so the result is identical to
+ * cv::medianBlur.
+ */
+static void constantTimeMedian(const cv::Mat& source, cv::Mat& destination, int radius)
 {
-	settings.add(strength);
-	settings.add(method);
+	const int width = source.cols;
+	const int height = source.rows;
+	const int rank = (2 * radius + 1) * (2 * radius + 1) / 2;
+
+	destination.create(source.size(), source.type());
+
+	// Column histograms, fine ones grouped by coarse bin to keep the fine
+	// bins of neighbouring columns together
+	std::vector<Count> coarse(width * BINS, 0);
+	std::vector<Count> fine(BINS * width * BINS, 0);
+
+	for (int y = -radius; y <= radius; ++y) {
+		const uchar* row = source.ptr<uchar>(std::min(std::max(y, 0), height - 1));
+		for (int x = 0; x < width; ++x) {
+			++coarse[x * BINS + (row[x] >> 4)];
+			++fine[((row[x] >> 4) * width + x) * BINS + (row[x] & 15)];
+		}
+	}
+
+	Count kernelCoarse[BINS];
+	Count kernelFine[BINS][BINS];
+	int kernelFineColumn[BINS];
+
+	for (int y = 0; y < height; ++y) {
+		if (y > 0) {
+			const uchar* removed = source.ptr<uchar>(std::max(y - radius - 1, 0));
+			const uchar* added = source.ptr<uchar>(std::min(y + radius, height - 1));
+			for (int x = 0; x < width; ++x) {
+				--coarse[x * BINS + (removed[x] >> 4)];
+				--fine[((removed[x] >> 4) * width + x) * BINS + (removed[x] & 15)];
+				++coarse[x * BINS + (added[x] >> 4)];
+				++fine[((added[x] >> 4) * width + x) * BINS + (added[x] & 15)];
+			}
+		}
+
+		std::fill(kernelCoarse, kernelCoarse + BINS, 0);
+		for (int x = -radius; x <= radius; ++x) {
+			addHistogram(kernelCoarse, &coarse[std::min(std::max(x, 0), width - 1) * BINS]);
+		}
+
+		std::fill(kernelFineColumn, kernelFineColumn + BINS, -1);
+
+		uchar* output = destination.ptr<uchar>(y);
+		for (int x = 0; x < width; ++x) {
+			if (x > 0) {
+				addHistogram(kernelCoarse, &coarse[std::min(x + radius, width - 1) * BINS]);
+				subtractHistogram(kernelCoarse, &coarse[std::max(x - radius - 1, 0) * BINS]);
+			}
+
+			int sum = 0;
+			int bin = 0;
+			while (sum + kernelCoarse[bin] <= rank) {
+				sum += kernelCoarse[bin++];
+			}
+
+			const Count* columns = &fine[bin * width * BINS];
+			Count* histogram = kernelFine[bin];
+			int& column = kernelFineColumn[bin];
+
+			if (column < 0 || x - column > 2 * radius) {
+				std::fill(histogram, histogram + BINS, 0);
+				for (int i = x - radius; i <= x + radius; ++i) {
+					addHistogram(histogram, &columns[std::min(std::max(i, 0), width - 1) * BINS]);
+				}
+			} else {
+				for (int i = column + 1; i <= x; ++i) {
+					addHistogram(histogram, &columns[std::min(i + radius, width - 1) * BINS]);
+					subtractHistogram(histogram, &columns[std::max(i - radius - 1, 0) * BINS]);
+				}
+			}
+			column = x;
+
+			int fineBin = 0;
+			while (sum + histogram[fineBin] <= rank) {
+				sum += histogram[fineBin++];
+			}
+
+			output[x] = uchar(bin * BINS + fineBin);
+		}
+	}
 }
 
-void SmoothFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
+/*
+ * Approximates the bilateral filter with a bilateral grid (Chen, Paris and
+ * Durand): pixels are accumulated into a coarse grid over position and
+ * intensity, the grid is blurred and the result is interpolated at each
+ * pixel's position and intensity. Grid cells are aligned to the whole image
+ * (see cv::Mat::locateROI()), so stripes extended by 4 cells on each side
+ * give the same result as the whole image.
+ */
+static void bilateralGrid(const cv::Mat& source, cv::Mat& destination, int cellSize, int intensityCellSize)
 {
+	cv::Size wholeSize;
+	cv::Point offset;
+	source.locateROI(wholeSize, offset);
+
+	const int firstColumn = (offset.x + cellSize / 2) / cellSize - 2;
+	const int firstRow = (offset.y + cellSize / 2) / cellSize - 2;
+	const int columns = (offset.x + source.cols + cellSize / 2) / cellSize - firstColumn + 3;
+	const int rows = (offset.y + source.rows + cellSize / 2) / cellSize - firstRow + 3;
+	const int levels = 255 / intensityCellSize + 4;
+
+	// Grid coordinates of each column and intensity, for accumulating
+	// (nearest cell) and interpolating (cell and fraction towards the next)
+	std::vector<int> nearestColumn(source.cols);
+	std::vector<int> column(source.cols);
+	std::vector<float> columnFraction(source.cols);
+	for (int x = 0; x < source.cols; ++x) {
+		float gridX = float(offset.x + x) / cellSize - firstColumn;
+		nearestColumn[x] = (offset.x + x + cellSize / 2) / cellSize - firstColumn;
+		column[x] = std::min(int(gridX), columns - 2);
+		columnFraction[x] = gridX - column[x];
+	}
+
+	int nearestLevel[256];
+	int level[256];
+	float levelFraction[256];
+	for (int intensity = 0; intensity < 256; ++intensity) {
+		float gridZ = float(intensity) / intensityCellSize + 1;
+		nearestLevel[intensity] = (intensity + intensityCellSize / 2) / intensityCellSize + 1;
+		level[intensity] = std::min(int(gridZ), levels - 2);
+		levelFraction[intensity] = gridZ - level[intensity];
+	}
+
+	// Interleaved sums of intensities and weights
+	std::vector<float> grid(rows * columns * levels * 2, 0);
+
+	for (int y = 0; y < source.rows; ++y) {
+		const uchar* row = source.ptr<uchar>(y);
+		float* gridRow = &grid[((offset.y + y + cellSize / 2) / cellSize - firstRow) * columns * levels * 2];
+
+		for (int x = 0; x < source.cols; ++x) {
+			float* cell = gridRow + (nearestColumn[x] * levels + nearestLevel[row[x]]) * 2;
+			cell[0] += row[x];
+			cell[1] += 1;
+		}
+	}
+
+	// Blurs with [1 2 1] / 4 along each axis of the grid
+	const int sizes[] = { rows, columns, levels };
+	std::vector<float> line(std::max(std::max(rows, columns), levels) * 2);
+
+	for (int axis = 0; axis < 3; ++axis) {
+		int count = sizes[axis];
+		int outer = 1;
+		int inner = 1;
+		for (int other = 0; other < 3; ++other) {
+			(other < axis ? outer : inner) *= (other != axis) ? sizes[other] : 1;
+		}
+
+		int stride = inner * 2;
+		for (int o = 0; o < outer; ++o) {
+			for (int i = 0; i < inner; ++i) {
+				float* cells = &grid[(o * count * inner + i) * 2];
+
+				for (int cell = 0; cell < count; ++cell) {
+					line[cell * 2] = cells[cell * stride];
+					line[cell * 2 + 1] = cells[cell * stride + 1];
+				}
+
+				for (int cell = 0; cell < count; ++cell) {
+					for (int channel = 0; channel < 2; ++channel) {
+						float previous = (cell > 0) ? line[(cell - 1) * 2 + channel] : 0;
+						float next = (cell < count - 1) ? line[(cell + 1) * 2 + channel] : 0;
+						cells[cell * stride + channel] = (previous + 2 * line[cell * 2 + channel] + next) * 0.25f;
+					}
+				}
+			}
+		}
+	}
+
+	destination.create(source.size(), source.type());
+
+	const int cornerOffsets[] = { 0, 2, levels * 2, (levels + 1) * 2 };
+
+	for (int y = 0; y < source.rows; ++y) {
+		const uchar* row = source.ptr<uchar>(y);
+		uchar* output = destination.ptr<uchar>(y);
+
+		float gridY = float(offset.y + y) / cellSize - firstRow;
+		int gridRow = std::min(int(gridY), rows - 2);
+		float fractionY = gridY - gridRow;
+
+		const float* upper = &grid[gridRow * columns * levels * 2];
+		const float* lower = upper + columns * levels * 2;
+
+		for (int x = 0; x < source.cols; ++x) {
+			int intensity = row[x];
+			float fractionX = columnFraction[x];
+			float fractionZ = levelFraction[intensity];
+
+			// Weights of the corners in each row of cells, ordered as offsets
+			float weights[] = { (1 - fractionX) * (1 - fractionZ), (1 - fractionX) * fractionZ, fractionX * (1 - fractionZ),
+				fractionX * fractionZ };
+
+			int cell = (column[x] * levels + level[intensity]) * 2;
+			float upperSums[2] = { 0, 0 };
+			float lowerSums[2] = { 0, 0 };
+			for (int corner = 0; corner < 4; ++corner) {
+				const float* upperCell = upper + cell + cornerOffsets[corner];
+				const float* lowerCell = lower + cell + cornerOffsets[corner];
+				upperSums[0] += weights[corner] * upperCell[0];
+				upperSums[1] += weights[corner] * upperCell[1];
+				lowerSums[0] += weights[corner] * lowerCell[0];
+				lowerSums[1] += weights[corner] * lowerCell[1];
+			}
+
+			float sum = (1 - fractionY) * upperSums[0] + fractionY * lowerSums[0];
+			float weight = (1 - fractionY) * upperSums[1] + fractionY * lowerSums[1];
+
+			output[x] = (weight > 0) ? cv::saturate_cast<uchar>(sum / weight) : row[x];
+		}
+	}
+}
+
+/*
+ * Cell size of the bilateral grid approximating the bilateral filter of the
+ * given strength, which is computed exactly below MIN_GRID_STRENGTH.
+ */
+static const int MIN_GRID_STRENGTH = 9;
+
+static int getGridCellSize(int strength)
+{
+	return std::max(2, strength / 2);
+}
+
+static void smooth(const cv::Mat& source, cv::Mat& destination, BlurMethod method, int strength, bool fastBilateral)
+{
+	bool singleByteChannel = (source.type() == CV_8UC1);
+
 	switch (method) {
 		case Normalized_Box:
 			cv::blur(source, destination, cv::Size(strength, strength));
@@ -53,13 +316,65 @@ void SmoothFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
 			break;
 
 		case Median:
-			cv::medianBlur(source, destination, strength);
+			// cv::medianBlur is quicker for small kernels
+			if (singleByteChannel && strength > 5) {
+				constantTimeMedian(source, destination, strength / 2);
+			} else {
+				cv::medianBlur(source, destination, strength);
+			}
 			break;
 
 		case Bilateral:
-			cv::bilateralFilter(source, destination, strength, strength * 10, strength * 10);
+			if (fastBilateral && singleByteChannel && strength >= MIN_GRID_STRENGTH) {
+				bilateralGrid(source, destination, getGridCellSize(strength), strength * 10);
+			} else {
+				cv::bilateralFilter(source, destination, strength, strength * 10, strength * 10);
+			}
 			break;
 	}
 }
 
+const Node::Type& SmoothFilter::TYPE()
+{
+	static const Node::Type type = Node::Type::of<SmoothFilter>("SmoothFilter", ImageFilter::TYPE());
+	return type;
+}
+
+const Node::Type& SmoothFilter::getType() const
+{
+	return TYPE();
+}
+
+SmoothFilter::SmoothFilter(const std::string& id, const std::string& name)
+	: ImageFilter(id, name), strength("strength", "Strength", mutex, 1, Constraint<unsigned int>(1, 21, 2)),
+		method("method", "Method", mutex, Normalized_Box, enum_string_begin<BlurMethod>(), enum_string_end<BlurMethod>()),
+		fastBilateral("fastBilateral", "Fast Bilateral (Approximate)", mutex, false)
+{
+	settings.add(strength);
+	settings.add(method);
+	settings.add(fastBilateral);
+
+	enableStripedExecution();
+	enableTiledExecution();
+}
+
+bool SmoothFilter::isStateless() const
+{
+	return true;
+}
+
+void SmoothFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
+{
+	int strength = this->strength;
+	BlurMethod method = this->method;
+	bool fastBilateral = this->fastBilateral;
+
+	int halo = strength / 2;
+	if (method == Bilateral && fastBilateral && strength >= MIN_GRID_STRENGTH) {
+		halo = 4 * getGridCellSize(strength);
+	}
+
+	applyStriped(source, destination, halo, boost::bind(&smooth, _1, _2, method, strength, fastBilateral));
+}
+
 static bool __registered = registerNodeType<SmoothFilter>();
@@ -35,12 +35,15 @@ public:
 
 	SmoothFilter(const std::string& id, const std::string& name = "Smooth");
 
+	virtual bool isStateless() const;
+
 protected:
 	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination);
 
 private:
 	ValueProperty<unsigned int> strength;
 	ValueProperty<BlurMethod> method;
+	ValueProperty<bool> fastBilateral;
 };
 
 #endif
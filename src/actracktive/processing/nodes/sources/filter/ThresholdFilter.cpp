@@ -21,6 +21,12 @@
 
 #include "actracktive/processing/nodes/sources/filter/ThresholdFilter.h"
 #include "actracktive/processing/NodeFactory.h"
+#include <boost/bind.hpp>
+
+static void applyThreshold(const cv::Mat& source, cv::Mat& destination, double threshold)
+{
+	cv::threshold(source, destination, threshold, 255, cv::THRESH_BINARY);
+}
 
 const Node::Type& ThresholdFilter::TYPE()
 {
@@ -37,11 +43,19 @@ ThresholdFilter::ThresholdFilter(const std::string& id, const std::string& name)
 	: ImageFilter(id, name), threshold("threshold", "Threshold", mutex, 127, Constraint<unsigned int>(0, 255))
 {
 	settings.add(threshold);
+
+	enableStripedExecution();
+	enableTiledExecution();
+}
+
+bool ThresholdFilter::isStateless() const
+{
+	return true;
 }
 
 void ThresholdFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
 {
-	cv::threshold(source, destination, threshold, 255, cv::THRESH_BINARY);
+	applyStriped(source, destination, 0, boost::bind(&applyThreshold, _1, _2, double(threshold)));
 }
 
 static bool __registered = registerNodeType<ThresholdFilter>();
@@ -32,6 +32,8 @@ public:
 
 	ThresholdFilter(const std::string& id, const std::string& name = "Threshold");
 
+	virtual bool isStateless() const;
+
 protected:
 	virtual void applyFilter(const cv::Mat& source, cv::Mat& destination);
 
@@ -21,6 +21,172 @@
 
 #include "actracktive/processing/nodes/sources/filter/TiledBernsenFilter.h"
 #include "actracktive/processing/NodeFactory.h"
+#include <algorithm>
+#include <vector>
+#include <boost/bind.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Along each axis, the image is divided into spans: one of half a tile,
+ * followed by whole tiles, and a last one with the remaining pixels. Tile t
+ * is thresholded based on the spans t and t + 1, i.e. on the tile extended
+ * by half a tile on each side. Spans beyond the image are empty.
+ */
+static cv::Range getSpan(int span, int tileSize, int length)
+{
+	int half = tileSize / 2;
+	int begin = (span == 0) ? 0 : half + (span - 1) * tileSize;
+	int end = half + span * tileSize;
+
+	return cv::Range(std::min(begin, length), std::min(end, length));
+}
+
+static void accumulateColumns(const uchar* line, uchar* minimum, uchar* maximum, int begin, int end)
+{
+	int x = begin;
+
+#ifdef __SSE2__
+	for (; x + 16 <= end; x += 16) {
+		__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x));
+		__m128i* minimumPixels = reinterpret_cast<__m128i*>(minimum + x);
+		__m128i* maximumPixels = reinterpret_cast<__m128i*>(maximum + x);
+
+		_mm_storeu_si128(minimumPixels, _mm_min_epu8(_mm_loadu_si128(minimumPixels), pixels));
+		_mm_storeu_si128(maximumPixels, _mm_max_epu8(_mm_loadu_si128(maximumPixels), pixels));
+	}
+#endif
+
+	for (; x < end; ++x) {
+		minimum[x] = std::min(minimum[x], line[x]);
+		maximum[x] = std::max(maximum[x], line[x]);
+	}
+}
+
+/*
+ * Computes the minimum and maximum of the given rows of spans. Like
+ * libfidtrack, the leading pixels of a span which are each smaller than all
+ * pixels before are only taken into account for the minimum.
+ */
+static void computeSpans(const cv::Mat& source, int tileSize, cv::Mat& spanMinimum, cv::Mat& spanMaximum, const cv::Range& spanRows)
+{
+	const int width = source.cols;
+	const int spanColumns = spanMinimum.cols;
+
+	std::vector<uchar> minimum(width);
+	std::vector<uchar> maximum(width);
+	std::vector<uchar> runMinimum(spanColumns);
+	std::vector<uchar> running(spanColumns);
+
+	for (int spanRow = spanRows.start; spanRow < spanRows.end; ++spanRow) {
+		cv::Range lines = getSpan(spanRow, tileSize, source.rows);
+
+		std::fill(minimum.begin(), minimum.end(), 255);
+		std::fill(maximum.begin(), maximum.end(), 0);
+		std::fill(runMinimum.begin(), runMinimum.end(), 255);
+
+		int runningCount = 0;
+		for (int column = 0; column < spanColumns; ++column) {
+			cv::Range columns = getSpan(column, tileSize, width);
+			running[column] = (columns.end > columns.start);
+			runningCount += running[column];
+		}
+
+		for (int y = lines.start; y < lines.end; ++y) {
+			const uchar* line = source.ptr<uchar>(y);
+
+			if (runningCount == 0) {
+				accumulateColumns(line, &minimum[0], &maximum[0], 0, width);
+				continue;
+			}
+
+			for (int column = 0; column < spanColumns; ++column) {
+				cv::Range columns = getSpan(column, tileSize, width);
+				int x = columns.start;
+
+				if (running[column]) {
+					for (; x < columns.end && line[x] < runMinimum[column]; ++x) {
+						runMinimum[column] = line[x];
+						minimum[x] = std::min(minimum[x], line[x]);
+					}
+
+					if (x < columns.end) {
+						running[column] = false;
+						--runningCount;
+					}
+				}
+
+				accumulateColumns(line, &minimum[0], &maximum[0], x, columns.end);
+			}
+		}
+
+		uchar* minimumRow = spanMinimum.ptr<uchar>(spanRow);
+		uchar* maximumRow = spanMaximum.ptr<uchar>(spanRow);
+		for (int column = 0; column < spanColumns; ++column) {
+			cv::Range columns = getSpan(column, tileSize, width);
+			minimumRow[column] = (columns.end > columns.start) ? *std::min_element(&minimum[columns.start], &minimum[columns.end]) : 255;
+			maximumRow[column] = (columns.end > columns.start) ? *std::max_element(&maximum[columns.start], &maximum[columns.end]) : 0;
+		}
+	}
+}
+
+static void binarizeLine(const uchar* line, const uchar* thresholds, uchar* destination, int width)
+{
+	int x = 0;
+
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi8(char(0xff));
+
+	for (; x + 16 <= width; x += 16) {
+		__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x));
+		__m128i threshold = _mm_loadu_si128(reinterpret_cast<const __m128i*>(thresholds + x));
+		__m128i notAbove = _mm_cmpeq_epi8(_mm_subs_epu8(pixels, threshold), zero);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), _mm_andnot_si128(notAbove, ones));
+	}
+#endif
+
+	for (; x < width; ++x) {
+		destination[x] = (line[x] > thresholds[x]) ? 255 : 0;
+	}
+}
+
+static void binarize(const cv::Mat& source, const cv::Mat& spanMinimum, const cv::Mat& spanMaximum, int tileSize,
+	int contrastThreshold, cv::Mat& destination, const cv::Range& tileRows)
+{
+	const int width = source.cols;
+	const int tilesAcross = (width + tileSize - 1) / tileSize;
+
+	std::vector<uchar> thresholds(width);
+
+	for (int tileRow = tileRows.start; tileRow < tileRows.end; ++tileRow) {
+		const uchar* minimumAbove = spanMinimum.ptr<uchar>(tileRow);
+		const uchar* minimumBelow = spanMinimum.ptr<uchar>(tileRow + 1);
+		const uchar* maximumAbove = spanMaximum.ptr<uchar>(tileRow);
+		const uchar* maximumBelow = spanMaximum.ptr<uchar>(tileRow + 1);
+
+		for (int tile = 0; tile < tilesAcross; ++tile) {
+			int minimum = std::min(std::min(minimumAbove[tile], minimumAbove[tile + 1]), std::min(minimumBelow[tile], minimumBelow[tile + 1]));
+			int maximum = std::max(std::max(maximumAbove[tile], maximumAbove[tile + 1]), std::max(maximumBelow[tile], maximumBelow[tile + 1]));
+			int middle = (minimum + maximum) / 2;
+
+			uchar threshold = middle;
+			if (maximum - minimum < contrastThreshold) {
+				threshold = (middle < 127) ? 255 : 0;
+			}
+
+			int end = std::min((tile + 1) * tileSize, width);
+			std::fill(thresholds.begin() + tile * tileSize, thresholds.begin() + end, threshold);
+		}
+
+		int end = std::min((tileRow + 1) * tileSize, source.rows);
+		for (int y = tileRow * tileSize; y < end; ++y) {
+			binarizeLine(source.ptr<uchar>(y), &thresholds[0], destination.ptr<uchar>(y), width);
+		}
+	}
+}
 
 const Node::Type& TiledBernsenFilter::TYPE()
 {
@@ -35,48 +201,57 @@ const Node::Type& TiledBernsenFilter::getType() const
 
 TiledBernsenFilter::TiledBernsenFilter(const std::string& id, const std::string& name)
 	: ImageFilter(id, name), tileSize("tileSize", "Tile Size", mutex, 16, Constraint<unsigned int>(8, 128, 8)),
-		contrastThreshold("contrastThreshold", "Contrast Threshold", mutex, 16, Constraint<unsigned int>(0, 255)), currentImageSize(0, 0),
-		binarizedPixels(NULL)
+		contrastThreshold("contrastThreshold", "Contrast Threshold", mutex, 16, Constraint<unsigned int>(0, 255)), luma(),
+		spanMinimum(), spanMaximum()
 {
 	settings.add(tileSize);
 	settings.add(contrastThreshold);
-}
 
-TiledBernsenFilter::~TiledBernsenFilter()
-{
-	terminate_tiled_bernsen_thresholder(&thresholder);
+	enableStripedExecution();
 }
 
 void TiledBernsenFilter::stop()
 {
 	ImageFilter::stop();
 
-	terminate_tiled_bernsen_thresholder(&thresholder);
+	luma.release();
+	spanMinimum.release();
+	spanMaximum.release();
+}
 
-	binarizedPixels.reset();
+bool TiledBernsenFilter::isStateless() const
+{
+	return true;
 }
 
 void TiledBernsenFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
 {
-	cv::Size size = source.size();
-	std::size_t step = source.step1();
+	if (source.depth() != CV_8U) {
+		source.copyTo(destination);
+		return;
+	}
 
-	if (size != currentImageSize) {
-		currentImageSize = size;
-		reinitializeThresholder();
+	// Only the first channel is examined, like libfidtrack does
+	const cv::Mat* input = &source;
+	if (source.channels() > 1) {
+		int fromTo[] = { 0, 0 };
+		luma.create(source.size(), CV_8UC1);
+		cv::mixChannels(&source, 1, &luma, 1, fromTo, 1);
+		input = &luma;
 	}
 
-	tiled_bernsen_threshold(&thresholder, binarizedPixels.get(), source.data, step, size.width, size.height, tileSize, contrastThreshold);
-	cv::Mat binarizedImage(size, CV_8UC1, binarizedPixels.get());
-	binarizedImage.copyTo(destination);
-}
+	int size = tileSize;
+	int tilesDown = (input->rows + size - 1) / size;
 
-void TiledBernsenFilter::reinitializeThresholder()
-{
-	terminate_tiled_bernsen_thresholder(&thresholder);
-	initialize_tiled_bernsen_thresholder(&thresholder, currentImageSize.width, currentImageSize.height, tileSize);
+	spanMinimum.create(input->rows / size + 2, input->cols / size + 2, CV_8UC1);
+	spanMaximum.create(spanMinimum.size(), CV_8UC1);
+	destination.create(input->size(), CV_8UC1);
 
-	binarizedPixels.reset(new unsigned char[currentImageSize.area()]);
+	runStriped(spanMinimum.rows, size,
+		boost::bind(&computeSpans, boost::cref(*input), size, boost::ref(spanMinimum), boost::ref(spanMaximum), _1));
+	runStriped(tilesDown, size,
+		boost::bind(&binarize, boost::cref(*input), boost::cref(spanMinimum), boost::cref(spanMaximum), size, int(contrastThreshold),
+			boost::ref(destination), _1));
 }
 
 static bool __registered = registerNodeType<TiledBernsenFilter>();
@@ -23,9 +23,13 @@
 #define TILEDBERNSENFILTER_H_
 
 #include "actracktive/processing/nodes/sources/filter/ImageFilter.h"
-#include "tiled_bernsen_threshold.h"
-#include <boost/scoped_array.hpp>
 
+/**
+ * Binarizes an image with the tiled Bernsen threshold of libfidtrack, giving
+ * identical results: every tile is thresholded at the mid-range of the
+ * minimum and maximum found in the tile extended by half a tile on each
+ * side. Low contrast tiles become white if bright and black otherwise.
+ */
 class TiledBernsenFilter: public ImageFilter
 {
 public:
@@ -33,7 +37,8 @@ public:
 	const Node::Type& getType() const;
 
 	TiledBernsenFilter(const std::string& id, const std::string& name = "Tiled Bernsen Threshold");
-	virtual ~TiledBernsenFilter();
+
+	virtual bool isStateless() const;
 
 	virtual void stop();
 
@@ -44,12 +49,9 @@ private:
 	ValueProperty<unsigned int> tileSize;
 	ValueProperty<unsigned int> contrastThreshold;
 
-	TiledBernsenThresholder thresholder;
-
-	cv::Size currentImageSize;
-	boost::scoped_array<unsigned char> binarizedPixels;
-
-	void reinitializeThresholder();
+	cv::Mat luma;
+	cv::Mat spanMinimum;
+	cv::Mat spanMaximum;
 
 };
 
@@ -21,6 +21,7 @@
 
 #include "actracktive/processing/nodes/sources/filter/UndistortRectifyFilter.h"
 #include "actracktive/processing/NodeFactory.h"
+#include <algorithm>
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <log4cplus/logger.h>
@@ -41,13 +42,16 @@ const Node::Type& UndistortRectifyFilter::getType() const
 UndistortRectifyFilter::UndistortRectifyFilter(const std::string& id, const std::string& name)
 	: ImageFilter(id, name), scalingFactor("scalingFactor", "Scaling Factor", mutex, 1, Constraint<double>(0, 2)),
 		horizontalShift("horizontalShift", "Horizontal Shift", mutex, 0, Constraint<double>(-1000, 1000, 1)),
-		verticalShift("verticalShift", "Vertical Shift", mutex, 0, Constraint<double>(-1000, 1000, 1)), imageSize(0, 0),
+		verticalShift("verticalShift", "Vertical Shift", mutex, 0, Constraint<double>(-1000, 1000, 1)),
+		fuseGeometry("fuseGeometry", "Fuse Geometric Filters", mutex, true), imageSize(0, 0),
 		intrinsicMatrix(cv::Mat::eye(3, 3, CV_64F)), distortionCoefficients(cv::Mat::zeros(1, 8, CV_64F)),
-		rotationVector(cv::Mat::zeros(1, 3, CV_64F)), translationVector(cv::Mat::zeros(1, 3, CV_64F)), map1(), map2()
+		rotationVector(cv::Mat::zeros(1, 3, CV_64F)), translationVector(cv::Mat::zeros(1, 3, CV_64F)), map1(), map2(),
+		remapSourceSize(0, 0), remapSize(0, 0), remapTransform(), remapMap1(), remapMap2()
 {
 	settings.add(scalingFactor);
 	settings.add(horizontalShift);
 	settings.add(verticalShift);
+	settings.add(fuseGeometry);
 }
 
 void UndistortRectifyFilter::configure(ConfigurationContext& context) throw (ConfigurationError)
@@ -174,6 +178,11 @@ void UndistortRectifyFilter::updateRectifyTransformation(const cv::Mat& rotation
 	initializeMaps();
 }
 
+bool UndistortRectifyFilter::isStateless() const
+{
+	return true;
+}
+
 void UndistortRectifyFilter::applyFilter(const cv::Mat& source, cv::Mat& destination)
 {
 	if (imageSize != source.size()) {
@@ -186,23 +195,87 @@ void UndistortRectifyFilter::applyFilter(const cv::Mat& source, cv::Mat& destina
 	}
 }
 
+bool UndistortRectifyFilter::canApplyRemap() const
+{
+	return fuseGeometry;
+}
+
+bool UndistortRectifyFilter::applyRemap(const cv::Mat& source, cv::Mat& destination, const cv::Mat& transform,
+	const cv::Size& destinationSize)
+{
+	if (!fuseGeometry) {
+		return false;
+	}
+
+	if (destinationSize.width <= 0 || destinationSize.height <= 0) {
+		destination.create(destinationSize, source.type());
+		return true;
+	}
+
+	bool changed = remapMap1.empty() || remapSourceSize != source.size() || remapSize != destinationSize
+		|| !std::equal(transform.ptr<double>(), transform.ptr<double>() + 9, remapTransform.ptr<double>());
+
+	if (changed) {
+		remapSourceSize = source.size();
+		remapSize = destinationSize;
+		remapTransform = transform.clone();
+
+		cv::Mat rotationMatrix;
+		cv::Rodrigues(rotationVector, rotationMatrix);
+
+		// The transform maps the final pixels to pixels of the rectified
+		// image, so its inverse is applied after the new intrinsic matrix.
+		cv::Mat newIntrinsicMatrix = transform.inv() * getNewIntrinsicMatrix();
+
+		cv::initUndistortRectifyMap(intrinsicMatrix, distortionCoefficients, rotationMatrix, newIntrinsicMatrix, remapSize, CV_16SC2,
+			remapMap1, remapMap2);
+	}
+
+	cv::remap(source, destination, remapMap1, remapMap2, cv::INTER_LINEAR);
+
+	return true;
+}
+
 void UndistortRectifyFilter::initializeMaps()
 {
 	Lock lock(this);
 
 	map1.release();
 	map2.release();
+	remapMap1.release();
+	remapMap2.release();
 
 	cv::Mat rotationMatrix;
 	cv::Rodrigues(rotationVector, rotationMatrix);
 
+	cv::initUndistortRectifyMap(intrinsicMatrix, distortionCoefficients, rotationMatrix, getNewIntrinsicMatrix(), imageSize, CV_16SC2,
+		map1, map2);
+
+	calibrationUpdated(*this);
+}
+
+cv::Mat UndistortRectifyFilter::getNewIntrinsicMatrix() const
+{
+	Lock lock(this);
+
 	cv::Mat newIntrinsicMatrix = intrinsicMatrix.clone();
 	newIntrinsicMatrix.col(2).row(0) += horizontalShift.getValue();
 	newIntrinsicMatrix.col(2).row(1) += verticalShift.getValue();
 	newIntrinsicMatrix.colRange(0, 2) *= scalingFactor.getValue();
 
-	cv::initUndistortRectifyMap(intrinsicMatrix, distortionCoefficients, rotationMatrix, newIntrinsicMatrix, imageSize, CV_16SC2, map1,
-		map2);
+	return newIntrinsicMatrix;
+}
+
+cv::Size UndistortRectifyFilter::getImageSize() const
+{
+	const ImageSource* input = getSource();
+	if (input == NULL) {
+		return cv::Size(0, 0);
+	}
+
+	Lock inputLock(input);
+
+	return input->get().size();
 }
 
 static bool __registered = registerNodeType<UndistortRectifyFilter>();
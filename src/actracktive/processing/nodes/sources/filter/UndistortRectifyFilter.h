@@ -25,14 +25,28 @@
 #include "actracktive/processing/nodes/sources/filter/ImageFilter.h"
 #include <vector>
 
+/**
+ * Undistorts and rectifies images according to the calibration found by the
+ * calibration frontend. Geometric filters directly following this filter
+ * (e.g. ImageMaskFilter or MirrorFilter) can be fused into its remap (see
+ * GeometryFusion), so that a single remap computes only the pixels of the
+ * final image.
+ */
 class UndistortRectifyFilter: public ImageFilter
 {
 public:
 	static const Node::Type& TYPE();
 	const Node::Type& getType() const;
 
+	boost::signals2::signal<void(const UndistortRectifyFilter&)> calibrationUpdated;
+
 	UndistortRectifyFilter(const std::string& id, const std::string& name = "Undistort-Rectify");
 
+	virtual bool isStateless() const;
+
+	virtual bool canApplyRemap() const;
+	virtual bool applyRemap(const cv::Mat& source, cv::Mat& destination, const cv::Mat& transform, const cv::Size& destinationSize);
+
 	virtual void configure(ConfigurationContext& context) throw (ConfigurationError);
 	virtual void save(ConfigurationContext& context) throw (ConfigurationError);
 
@@ -44,6 +58,18 @@ public:
 	virtual const cv::Mat& getRotationVector() const;
 	virtual const cv::Mat& getTranslationVector() const;
 
+	/**
+	 * Returns the intrinsic matrix of the undistorted image, i.e. including
+	 * scaling and shift.
+	 */
+	cv::Mat getNewIntrinsicMatrix() const;
+
+	/**
+	 * Returns the size of the images being undistorted, i.e. of the last
+	 * image of the source, or an empty size if there is none yet.
+	 */
+	cv::Size getImageSize() const;
+
 	virtual void updateCalibration(const cv::Mat& intrinsicMatrix, const cv::Mat& distortionCoefficients);
 	virtual void updateRectifyTransformation(const cv::Mat& rotationVector, const cv::Mat& translationVector);
 
@@ -54,6 +80,7 @@ private:
 	ValueProperty<double> scalingFactor;
 	ValueProperty<double> horizontalShift;
 	ValueProperty<double> verticalShift;
+	ValueProperty<bool> fuseGeometry;
 
 	cv::Size imageSize;
 
@@ -65,6 +92,12 @@ private:
 	cv::Mat map1;
 	cv::Mat map2;
 
+	cv::Size remapSourceSize;
+	cv::Size remapSize;
+	cv::Mat remapTransform;
+	cv::Mat remapMap1;
+	cv::Mat remapMap2;
+
 	void initializeMaps();
 
 };
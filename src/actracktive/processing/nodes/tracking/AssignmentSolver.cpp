@@ -0,0 +1,107 @@
+/*
+ * AssignmentSolver.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "actracktive/processing/nodes/tracking/AssignmentSolver.h"
+#include <limits>
+
+AssignmentSolver::AssignmentSolver()
+	: rowPotentials(), columnPotentials(), minima(), columnRows(), previousColumns(), visited()
+{
+}
+
+/*
+ * Rows are added one after the other, each along a shortest augmenting path
+ * with respect to the reduced costs. Rows and columns are numbered from 1 on,
+ * column 0 holds the row currently being added.
+ */
+double AssignmentSolver::solve(const std::vector<double>& costs, unsigned int rows, unsigned int columns,
+	std::vector<unsigned int>& assignment)
+{
+	const double infinity = std::numeric_limits<double>::infinity();
+
+	rowPotentials.assign(rows + 1, 0);
+	columnPotentials.assign(columns + 1, 0);
+	columnRows.assign(columns + 1, 0);
+	previousColumns.assign(columns + 1, 0);
+
+	for (unsigned int row = 1; row <= rows; ++row) {
+		columnRows[0] = row;
+		minima.assign(columns + 1, infinity);
+		visited.assign(columns + 1, false);
+
+		unsigned int column = 0;
+		do {
+			visited[column] = true;
+
+			unsigned int currentRow = columnRows[column];
+			const double* rowCosts = &costs[(currentRow - 1) * columns] - 1;
+
+			double delta = infinity;
+			unsigned int nextColumn = 0;
+			for (unsigned int j = 1; j <= columns; ++j) {
+				if (visited[j]) {
+					continue;
+				}
+
+				double reduced = rowCosts[j] - rowPotentials[currentRow] - columnPotentials[j];
+				if (reduced < minima[j]) {
+					minima[j] = reduced;
+					previousColumns[j] = column;
+				}
+				if (minima[j] < delta) {
+					delta = minima[j];
+					nextColumn = j;
+				}
+			}
+
+			for (unsigned int j = 0; j <= columns; ++j) {
+				if (visited[j]) {
+					rowPotentials[columnRows[j]] += delta;
+					columnPotentials[j] -= delta;
+				} else {
+					minima[j] -= delta;
+				}
+			}
+
+			column = nextColumn;
+		} while (columnRows[column] != 0);
+
+		// Flip the augmenting path
+		do {
+			unsigned int previousColumn = previousColumns[column];
+			columnRows[column] = columnRows[previousColumn];
+			column = previousColumn;
+		} while (column != 0);
+	}
+
+	assignment.resize(rows);
+
+	double total = 0;
+	for (unsigned int j = 1; j <= columns; ++j) {
+		if (columnRows[j] != 0) {
+			assignment[columnRows[j] - 1] = j - 1;
+			total += costs[(columnRows[j] - 1) * columns + j - 1];
+		}
+	}
+
+	return total;
+}
@@ -0,0 +1,56 @@
+/*
+ * AssignmentSolver.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef ASSIGNMENTSOLVER_H_
+#define ASSIGNMENTSOLVER_H_
+
+#include <vector>
+
+/**
+ * Solves the (rectangular) assignment problem with the Hungarian method in
+ * O(rows^2 * columns). The buffers are kept between calls, so solving
+ * repeatedly does not allocate memory once they are large enough.
+ */
+class AssignmentSolver
+{
+public:
+	AssignmentSolver();
+
+	/**
+	 * Assigns each row of the cost matrix (given row by row) to a different
+	 * column, such that the sum of the costs is minimal. There must not be
+	 * more rows than columns. The assigned column of each row is stored in
+	 * assignment. Returns the total cost.
+	 */
+	double solve(const std::vector<double>& costs, unsigned int rows, unsigned int columns, std::vector<unsigned int>& assignment);
+
+private:
+	std::vector<double> rowPotentials;
+	std::vector<double> columnPotentials;
+	std::vector<double> minima;
+	std::vector<unsigned int> columnRows;
+	std::vector<unsigned int> previousColumns;
+	std::vector<bool> visited;
+
+};
+
+#endif
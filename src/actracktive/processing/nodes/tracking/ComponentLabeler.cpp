@@ -0,0 +1,372 @@
+/*
+ * ComponentLabeler.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "actracktive/processing/nodes/tracking/ComponentLabeler.h"
+#include "actracktive/util/WorkerPool.h"
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Returns the first position from x on where the pixel is zero (if set is
+ * true) or non-zero (if set is false), or width if there is none.
+ */
+static int skipPixels(const uchar* row, int x, int width, bool set)
+{
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; x + 16 <= width; x += 16) {
+		int zeros = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)), zero));
+		int skipped = set ? (~zeros & 0xffff) : zeros;
+
+		if (skipped != 0xffff) {
+			return x + __builtin_ctz(~skipped);
+		}
+	}
+#endif
+
+	while (x < width && (row[x] != 0) == set) {
+		++x;
+	}
+
+	return x;
+}
+
+/*
+ * Sum of the squares of 0 to n.
+ */
+static inline double sumOfSquares(double n)
+{
+	return n * (n + 1) * (2 * n + 1) / 6;
+}
+
+static inline bool isSet(const cv::Mat& image, const cv::Point& point)
+{
+	return point.x >= 0 && point.y >= 0 && point.x < image.cols && point.y < image.rows && image.ptr<uchar>(point.y)[point.x] != 0;
+}
+
+// Neighbours in counter-clockwise order, starting to the right
+static const cv::Point NEIGHBOURS[8] = { cv::Point(1, 0), cv::Point(1, -1), cv::Point(0, -1), cv::Point(-1, -1), cv::Point(-1, 0),
+	cv::Point(-1, 1), cv::Point(0, 1), cv::Point(1, 1) };
+
+ComponentLabeler::ComponentLabeler()
+	: stripes(), parents(), statistics(), components()
+{
+}
+
+void ComponentLabeler::label(const cv::Mat& image, unsigned int stripeCount)
+{
+	stripeCount = std::min(stripeCount, WorkerPool::getShared().getThreadCount() + 1);
+	stripeCount = std::max(1, std::min<int>(stripeCount, image.rows / MIN_STRIPE_ROWS));
+	if (stripes.size() < stripeCount) {
+		stripes.resize(stripeCount);
+	}
+
+	if (stripeCount > 1) {
+		WorkerPool::Group group;
+		for (unsigned int stripe = 1; stripe < stripeCount; ++stripe) {
+			cv::Range rows(image.rows * stripe / stripeCount, image.rows * (stripe + 1) / stripeCount);
+			group.run(boost::bind(&ComponentLabeler::labelStripe, boost::cref(image), rows, boost::ref(stripes[stripe])));
+		}
+
+		labelStripe(image, cv::Range(0, image.rows / stripeCount), stripes[0]);
+
+		group.wait();
+	} else {
+		labelStripe(image, cv::Range(0, image.rows), stripes[0]);
+	}
+
+	mergeStripes(stripeCount);
+
+	components.clear();
+	for (unsigned int label = 0; label < parents.size(); ++label) {
+		if (parents[label] != label) {
+			continue;
+		}
+
+		const Statistics& s = statistics[label];
+
+		Component component;
+		component.area = s.area;
+		component.centroidX = s.sumX / s.area;
+		component.centroidY = s.sumY / s.area;
+		component.mu20 = s.sumXX - s.sumX * component.centroidX;
+		component.mu11 = s.sumXY - s.sumX * component.centroidY;
+		component.mu02 = s.sumYY - s.sumY * component.centroidY;
+		component.bounds = cv::Rect(s.minX, s.minY, s.maxX - s.minX + 1, s.maxY - s.minY + 1);
+		component.start = s.start;
+
+		components.push_back(component);
+	}
+}
+
+const std::vector<ComponentLabeler::Component>& ComponentLabeler::getComponents() const
+{
+	return components;
+}
+
+double ComponentLabeler::computeEccentricity(const Component& component)
+{
+	double mu20norm = component.mu20 / component.area;
+	double mu02norm = component.mu02 / component.area;
+	double mu11norm = component.mu11 / component.area;
+
+	double partOne = mu20norm + mu02norm / 2;
+	double partTwo = std::sqrt(4 * mu11norm * mu11norm + (mu20norm - mu02norm) * (mu20norm - mu02norm)) / 2;
+
+	double lambda1 = partOne + partTwo;
+	double lambda2 = partOne - partTwo;
+
+	return std::sqrt(1 - lambda2 / lambda1);
+}
+
+/*
+ * Follows the border like cv::findContours() does (Suzuki and Abe), but
+ * without marking visited pixels, as only the outer border of a single
+ * component is traced.
+ */
+void ComponentLabeler::traceOutline(const cv::Mat& image, const cv::Point& start, std::vector<cv::Point>& outline)
+{
+	outline.clear();
+
+	// Search clockwise for the first neighbour, starting at the left one
+	int direction = 4;
+	cv::Point second;
+	do {
+		direction = (direction + 7) & 7;
+		second = start + NEIGHBOURS[direction];
+	} while (!isSet(image, second) && direction != 4);
+
+	if (!isSet(image, second)) {
+		outline.push_back(start);
+		return;
+	}
+
+	cv::Point current = start;
+	int previousDirection = direction ^ 4;
+
+	for (;;) {
+		// Search counter-clockwise for the next border pixel, starting after
+		// the previous one
+		cv::Point next;
+		do {
+			direction = (direction + 1) & 7;
+			next = current + NEIGHBOURS[direction];
+		} while (!isSet(image, next));
+
+		if (direction != previousDirection) {
+			outline.push_back(current);
+			previousDirection = direction;
+		}
+
+		if (next == start && current == second) {
+			break;
+		}
+
+		current = next;
+		direction = (direction + 4) & 7;
+	}
+}
+
+void ComponentLabeler::labelStripe(const cv::Mat& image, const cv::Range& rows, Stripe& stripe)
+{
+	std::vector<Run>& previousRuns = stripe.lastRuns;
+	std::vector<Run>& currentRuns = stripe.currentRuns;
+	std::vector<unsigned int>& parents = stripe.parents;
+	std::vector<Statistics>& statistics = stripe.statistics;
+
+	previousRuns.clear();
+	parents.clear();
+	statistics.clear();
+
+	for (int y = rows.start; y < rows.end; ++y) {
+		const uchar* row = image.ptr<uchar>(y);
+
+		currentRuns.clear();
+
+		// Runs of the previous row before this one can not touch the current
+		// run or any later one
+		std::size_t first = 0;
+
+		int x = skipPixels(row, 0, image.cols, false);
+		while (x < image.cols) {
+			Run run;
+			run.begin = x;
+			run.end = skipPixels(row, x, image.cols, true);
+
+			while (first < previousRuns.size() && previousRuns[first].end < run.begin) {
+				++first;
+			}
+
+			unsigned int label = parents.size();
+			for (std::size_t i = first; i < previousRuns.size() && previousRuns[i].begin <= run.end; ++i) {
+				label = (label == parents.size()) ? find(parents, previousRuns[i].label) : unite(parents, statistics, label,
+					previousRuns[i].label);
+			}
+
+			if (label == parents.size()) {
+				Statistics component = Statistics();
+				component.minX = run.begin;
+				component.minY = y;
+				component.maxX = run.end - 1;
+				component.maxY = y;
+				component.start = cv::Point(run.begin, y);
+
+				parents.push_back(label);
+				statistics.push_back(component);
+			}
+
+			run.label = label;
+			addRun(statistics[label], y, run.begin, run.end);
+			currentRuns.push_back(run);
+
+			x = skipPixels(row, run.end, image.cols, false);
+		}
+
+		if (y == rows.start) {
+			stripe.firstRuns = currentRuns;
+		}
+
+		previousRuns.swap(currentRuns);
+	}
+
+	if (rows.start == rows.end) {
+		stripe.firstRuns.clear();
+	}
+}
+
+/*
+ * Numbers the components of all stripes consecutively and merges those
+ * touching across stripe boundaries. As the components of each stripe are
+ * numbered in scan order, the lowest label of merged components still
+ * belongs to the one which starts first.
+ */
+void ComponentLabeler::mergeStripes(unsigned int stripeCount)
+{
+	parents.clear();
+	statistics.clear();
+
+	for (unsigned int i = 0; i < stripeCount; ++i) {
+		Stripe& stripe = stripes[i];
+
+		stripe.mergedLabels.resize(stripe.parents.size());
+		for (unsigned int label = 0; label < stripe.parents.size(); ++label) {
+			unsigned int root = find(stripe.parents, label);
+			if (root == label) {
+				stripe.mergedLabels[label] = parents.size();
+				parents.push_back(parents.size());
+				statistics.push_back(stripe.statistics[label]);
+			} else {
+				stripe.mergedLabels[label] = stripe.mergedLabels[root];
+			}
+		}
+	}
+
+	for (unsigned int i = 1; i < stripeCount; ++i) {
+		const Stripe& upper = stripes[i - 1];
+		const Stripe& lower = stripes[i];
+
+		std::size_t first = 0;
+		for (std::vector<Run>::const_iterator run = lower.firstRuns.begin(); run != lower.firstRuns.end(); ++run) {
+			while (first < upper.lastRuns.size() && upper.lastRuns[first].end < run->begin) {
+				++first;
+			}
+
+			for (std::size_t j = first; j < upper.lastRuns.size() && upper.lastRuns[j].begin <= run->end; ++j) {
+				unite(parents, statistics, upper.mergedLabels[upper.lastRuns[j].label], lower.mergedLabels[run->label]);
+			}
+		}
+	}
+}
+
+unsigned int ComponentLabeler::find(std::vector<unsigned int>& parents, unsigned int label)
+{
+	unsigned int root = label;
+	while (parents[root] != root) {
+		root = parents[root];
+	}
+
+	while (parents[label] != root) {
+		unsigned int parent = parents[label];
+		parents[label] = root;
+		label = parent;
+	}
+
+	return root;
+}
+
+/*
+ * Merges the components of both labels into the one labeled first, which
+ * thus always is the root.
+ */
+unsigned int ComponentLabeler::unite(std::vector<unsigned int>& parents, std::vector<Statistics>& statistics, unsigned int a,
+	unsigned int b)
+{
+	a = find(parents, a);
+	b = find(parents, b);
+
+	if (a == b) {
+		return a;
+	}
+
+	unsigned int root = std::min(a, b);
+	unsigned int other = std::max(a, b);
+
+	Statistics& target = statistics[root];
+	const Statistics& source = statistics[other];
+
+	target.area += source.area;
+	target.sumX += source.sumX;
+	target.sumY += source.sumY;
+	target.sumXX += source.sumXX;
+	target.sumXY += source.sumXY;
+	target.sumYY += source.sumYY;
+	target.minX = std::min(target.minX, source.minX);
+	target.minY = std::min(target.minY, source.minY);
+	target.maxX = std::max(target.maxX, source.maxX);
+	target.maxY = std::max(target.maxY, source.maxY);
+
+	parents[other] = root;
+
+	return root;
+}
+
+void ComponentLabeler::addRun(Statistics& component, int y, int begin, int end)
+{
+	double length = end - begin;
+	double sumX = (double(begin) + end - 1) * length / 2;
+
+	component.area += end - begin;
+	component.sumX += sumX;
+	component.sumY += y * length;
+	component.sumXX += sumOfSquares(end - 1) - sumOfSquares(begin - 1);
+	component.sumXY += y * sumX;
+	component.sumYY += double(y) * y * length;
+	component.minX = std::min(component.minX, begin);
+	component.maxX = std::max(component.maxX, end - 1);
+	component.maxY = std::max(component.maxY, y);
+}
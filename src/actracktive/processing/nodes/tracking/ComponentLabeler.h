@@ -0,0 +1,140 @@
+/*
+ * ComponentLabeler.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef COMPONENTLABELER_H_
+#define COMPONENTLABELER_H_
+
+#include "opencv2/opencv.hpp"
+#include <vector>
+
+/**
+ * Finds the 8-connected components of the non-zero pixels of a binary image
+ * (CV_8UC1) in a single pass over its horizontal runs of pixels. The area,
+ * centroid and second order central moments of each component are
+ * accumulated while scanning, so components can be rejected without ever
+ * looking at their outline. Outlines are traced on demand, directly on the
+ * (unmodified) image.
+ *
+ * The image can be split into horizontal stripes which are labeled
+ * concurrently. Components touching across stripe boundaries are merged
+ * afterwards, so the result is the same as for a single stripe.
+ */
+class ComponentLabeler
+{
+public:
+	struct Component
+	{
+		unsigned int area;
+		double centroidX;
+		double centroidY;
+		double mu20;
+		double mu11;
+		double mu02;
+		cv::Rect bounds;
+
+		/**
+		 * The first pixel of the component in scan order, where tracing its
+		 * outline starts.
+		 */
+		cv::Point start;
+	};
+
+	ComponentLabeler();
+
+	/**
+	 * Labels the image, replacing all previously found components. Uses at
+	 * most the given number of stripes (limited by the threads of the shared
+	 * WorkerPool), each at least MIN_STRIPE_ROWS high. Components are ordered
+	 * by their start.
+	 */
+	void label(const cv::Mat& image, unsigned int stripeCount = 1);
+
+	const std::vector<Component>& getComponents() const;
+
+	/**
+	 * Traces the outer outline of the component starting at start in the
+	 * image it was found in, with horizontal, vertical and diagonal segments
+	 * compressed to their end points like cv::findContours() with
+	 * CV_CHAIN_APPROX_SIMPLE.
+	 */
+	static void traceOutline(const cv::Mat& image, const cv::Point& start, std::vector<cv::Point>& outline);
+
+	/**
+	 * Returns the eccentricity of the ellipse with the same second order
+	 * moments as the component.
+	 */
+	static double computeEccentricity(const Component& component);
+
+private:
+	static const int MIN_STRIPE_ROWS = 32;
+
+	struct Run
+	{
+		int begin;
+		int end;
+		unsigned int label;
+	};
+
+	struct Statistics
+	{
+		unsigned int area;
+		double sumX;
+		double sumY;
+		double sumXX;
+		double sumXY;
+		double sumYY;
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+		cv::Point start;
+	};
+
+	/**
+	 * Labels of a stripe are local to it until the stripes are merged.
+	 */
+	struct Stripe
+	{
+		std::vector<Run> firstRuns;
+		std::vector<Run> lastRuns;
+		std::vector<Run> currentRuns;
+		std::vector<unsigned int> parents;
+		std::vector<Statistics> statistics;
+		std::vector<unsigned int> mergedLabels;
+	};
+
+	std::vector<Stripe> stripes;
+	std::vector<unsigned int> parents;
+	std::vector<Statistics> statistics;
+	std::vector<Component> components;
+
+	static void labelStripe(const cv::Mat& image, const cv::Range& rows, Stripe& stripe);
+	void mergeStripes(unsigned int stripeCount);
+
+	static unsigned int find(std::vector<unsigned int>& parents, unsigned int label);
+	static unsigned int unite(std::vector<unsigned int>& parents, std::vector<Statistics>& statistics, unsigned int a,
+		unsigned int b);
+	static void addRun(Statistics& component, int y, int begin, int end);
+
+};
+
+#endif
@@ -26,6 +26,7 @@
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <log4cplus/logger.h>
+#include <algorithm>
 #include <cmath>
 
 static log4cplus::Logger logger = log4cplus::Logger::getInstance("FiducialDetector");
@@ -56,12 +57,16 @@ double Fiducial::getRotationAcceleration() const
 	return rotationAcceleration;
 }
 
-void Fiducial::transform(const Transformer& t)
+void Fiducial::transform(const Transformer::Snapshot::Ptr& snapshot)
 {
-	Object::transform(t);
+	if (!snapshot) {
+		return;
+	}
 
-	angle = t.transformAngle(angle);
-	previousAngle = t.transformAngle(previousAngle);
+	Object::transform(snapshot);
+
+	angle = snapshot->transformAngle(angle);
+	previousAngle = snapshot->transformAngle(previousAngle);
 
 	updateRotationAccelerationAndVelocity();
 }
@@ -90,9 +95,10 @@ double Fiducial::getDeltaAngle() const
 
 void Fiducial::updateRotationAccelerationAndVelocity()
 {
-	boost::posix_time::time_duration dt = getDeltaTime();
-	double rotationVelocity = getDeltaAngle() / dt.total_milliseconds();
-	this->rotationAcceleration = (rotationVelocity - this->rotationVelocity) / dt.total_milliseconds();
+	// Fractions of milliseconds, like the velocity of the position
+	double dt = getDeltaTime().total_microseconds() / 1000.0;
+	double rotationVelocity = getDeltaAngle() / dt;
+	this->rotationAcceleration = (rotationVelocity - this->rotationVelocity) / dt;
 	this->rotationVelocity = rotationVelocity;
 }
 
@@ -108,17 +114,30 @@ const Node::Type& FiducialDetector::getType() const
 }
 
 FiducialDetector::FiducialDetector(const std::string& id, const std::string& name)
-	: ObjectSource(id, name), enabled("enabled", "Enabled", mutex, true), trees("trees", "Trees", mutex), source("source", "Source", mutex),
-		width(0), height(0), segmenterInitialized(false), treeAndTrackerInitialized(false)
+	: ObjectSource(id, name), enabled("enabled", "Enabled", mutex, true), trees("trees", "Trees", mutex),
+		trackRegions("trackRegions", "Track Regions", mutex, false),
+		regionSize("regionSize", "Region Size", mutex, 160, Constraint<unsigned int>(32, 1024, 8)),
+		fullScanInterval("fullScanInterval", "Full Scan Interval (Frames)", mutex, 30, Constraint<unsigned int>(1, 1000)),
+		findFingers("findFingers", "Find Finger Candidates", mutex, false),
+		source("source", "Source", mutex), trackedFiducials("trackedFiducials", "Tracked Fiducials", mutex), width(0), height(0),
+		regionWidth(0), regionHeight(0), segmenterInitialized(false), regionSegmenterInitialized(false),
+		treeAndTrackerInitialized(false), regionImage(), regionCenters(), previousPositions(), framesSinceFullScan(0),
+		labeler(), fingerCandidates(), fingerCandidateScale(1)
 {
 	settings.add(enabled);
 	settings.add(trees);
+	settings.add(trackRegions);
+	settings.add(regionSize);
+	settings.add(fullScanInterval);
+	settings.add(findFingers);
 	connections.add(source);
+	connections.add(trackedFiducials);
 }
 
 FiducialDetector::~FiducialDetector()
 {
 	deinitSegmenter();
+	deinitRegionSegmenter();
 	deinitTreeAndTracker();
 }
 
@@ -126,12 +145,16 @@ void FiducialDetector::start()
 {
 	ObjectSource::start();
 	initTreeAndTracker();
+
+	previousPositions.clear();
+	framesSinceFullScan = 0;
 }
 
 void FiducialDetector::stop()
 {
 	ObjectSource::stop();
 	deinitSegmenter();
+	deinitRegionSegmenter();
 	deinitTreeAndTracker();
 }
 
@@ -142,8 +165,14 @@ void FiducialDetector::fetch(Objects& destination)
 	}
 
 	destination.clear();
+	fingerCandidates.clear();
 
 	if (enabled) {
+		// Coordinates are reported in full resolution
+		double scale = 1;
+		int fiducialCount = 0;
+		bool fullScan = true;
+
 		{
 			Lock lock(source);
 
@@ -163,34 +192,246 @@ void FiducialDetector::fetch(Objects& destination)
 				height = size.height;
 			}
 
-			if (!segmenterInitialized) {
-				initSegmenter();
+			scale = source->getScale();
+
+			// Between full scans only the regions around the fiducials of the
+			// previous frame are searched. A region which does not contain a
+			// fiducial any more triggers a full scan of the same frame. Finger
+			// candidates may appear anywhere, so they require a full scan.
+			if (trackRegions && !findFingers && framesSinceFullScan + 1 < fullScanInterval && collectRegionCenters(scale)) {
+				fiducialCount = findFiducialsInRegions(input);
+				fullScan = fiducialCount < 0;
 			}
 
-			step_segmenter(&segmenter, input.data);
+			if (fullScan) {
+				if (!segmenterInitialized) {
+					initSegmenter();
+				}
+
+				step_segmenter(&segmenter, input.data);
+
+				if (findFingers) {
+					collectFingerCandidates(input);
+					fingerCandidateScale = scale;
+				}
+			}
+		}
+
+		if (fullScan) {
+			fiducialCount = find_fiducialsX(foundFiducials, MAX_FIDUCIAL_COUNT, &tracker, &segmenter, width, height);
+			framesSinceFullScan = 0;
+		} else {
+			++framesSinceFullScan;
 		}
 
-		int fiducialCount = find_fiducialsX(foundFiducials, MAX_FIDUCIAL_COUNT, &tracker, &segmenter, width, height);
+		previousPositions.clear();
 
 		boost::posix_time::ptime time(boost::posix_time::microsec_clock::local_time());
 		for (int i = 0; i < fiducialCount; ++i) {
 			if (foundFiducials[i].id != INVALID_FIDUCIAL_ID) {
-				Vector2D position(foundFiducials[i].x, foundFiducials[i].y);
+				previousPositions.push_back(Vector2D(foundFiducials[i].x, foundFiducials[i].y));
+
+				Vector2D position = ImageSource::toFullResolution(Vector2D(foundFiducials[i].x, foundFiducials[i].y), scale);
+				double size = foundFiducials[i].root_size * scale;
 				std::vector<Vector2D> outline;
 				for (std::size_t corner = 0; corner < 4; ++corner) {
 					double angle = foundFiducials[i].angle + corner * M_PI_2;
-					outline.push_back(
-						position + Vector2D(std::cos(angle) * foundFiducials[i].root_size, std::sin(angle) * foundFiducials[i].root_size));
+					outline.push_back(position + Vector2D(std::cos(angle) * size, std::sin(angle) * size));
 				}
 
 				destination.add(new Fiducial(0, foundFiducials[i].id, time, position, foundFiducials[i].angle, outline));
 			}
 		}
 
-		destination.setBounds(Rectangle(0, 0, width, height));
+		destination.setBounds(Rectangle(0, 0, width * scale, height * scale));
+	}
+}
+
+/*
+ * The regions are centered on the fiducials the connected tracker saw in the
+ * previous frame (new or alive, but not lost), or on the fiducials found by
+ * this detector itself if no tracker is connected. The tracker's objects are
+ * read without fetching, as it depends on this detector. Returns false if
+ * there are no regions.
+ */
+bool FiducialDetector::collectRegionCenters(double scale)
+{
+	regionCenters.clear();
+
+	const ObjectSource* tracked = trackedFiducials;
+	if (tracked != NULL) {
+		Lock lock(tracked);
+
+		const Objects& objects = tracked->get();
+		Objects::Lock objectsLock(objects);
+
+		for (Objects::ConstIterator object = objects.begin(); object != objects.end(); ++object) {
+			// Lost fiducials would only make their empty region trigger a full
+			// scan in every frame until the tracker drops them
+			if ((*object)->isAlive() && (*object)->getFramesLost() == 0 && dynamic_cast<const Fiducial*>(*object) != NULL) {
+				regionCenters.push_back(ImageSource::fromFullResolution((*object)->getPosition(), scale));
+			}
+		}
+	} else {
+		regionCenters = previousPositions;
+	}
+
+	return !regionCenters.empty();
+}
+
+/*
+ * Searches square regions of the input around each region center, reusing a
+ * single segmenter of the region size for all of them. The fiducials are
+ * collected in foundFiducials in input coordinates. Returns their number, or
+ * -1 if one of the regions does not contain any fiducial.
+ */
+int FiducialDetector::findFiducialsInRegions(const cv::Mat& input)
+{
+	int size = std::min<int>(regionSize, std::min(width, height));
+	if (size != regionWidth || size != regionHeight) {
+		deinitRegionSegmenter();
+
+		regionWidth = size;
+		regionHeight = size;
+	}
+
+	if (!regionSegmenterInitialized) {
+		initRegionSegmenter();
+	}
+
+	int count = 0;
+	for (std::vector<Vector2D>::const_iterator center = regionCenters.begin(); center != regionCenters.end(); ++center) {
+		// Regions are shifted to lie inside the image, so they all have the
+		// size the segmenter was initialized with
+		int left = std::max(0, std::min(width - regionWidth, int(center->x) - regionWidth / 2));
+		int top = std::max(0, std::min(height - regionHeight, int(center->y) - regionHeight / 2));
+
+		input(cv::Rect(left, top, regionWidth, regionHeight)).copyTo(regionImage);
+		step_segmenter(&regionSegmenter, regionImage.data);
+
+		int regionCount = find_fiducialsX(regionFiducials, MAX_FIDUCIAL_COUNT, &tracker, &regionSegmenter, regionWidth,
+			regionHeight);
+
+		bool found = false;
+		for (int i = 0; i < regionCount; ++i) {
+			FiducialX& fiducial = regionFiducials[i];
+			if (fiducial.id == INVALID_FIDUCIAL_ID) {
+				continue;
+			}
+
+			found = true;
+
+			fiducial.x += left;
+			fiducial.y += top;
+			fiducial.left += left;
+			fiducial.right += left;
+			fiducial.top += top;
+			fiducial.bottom += top;
+
+			// Overlapping regions find the same fiducial more than once
+			if (count < MAX_FIDUCIAL_COUNT && !isDuplicate(fiducial, count)) {
+				foundFiducials[count++] = fiducial;
+			}
+		}
+
+		if (!found) {
+			return -1;
+		}
+	}
+
+	return count;
+}
+
+const std::vector<FiducialDetector::FingerCandidate>& FiducialDetector::getFingerCandidates() const
+{
+	return fingerCandidates;
+}
+
+double FiducialDetector::getFingerCandidateScale() const
+{
+	return fingerCandidateScale;
+}
+
+bool FiducialDetector::isDuplicate(const FiducialX& fiducial, int count) const
+{
+	for (int i = 0; i < count; ++i) {
+		if (foundFiducials[i].id == fiducial.id && std::fabs(foundFiducials[i].x - fiducial.x) < 1
+			&& std::fabs(foundFiducials[i].y - fiducial.y) < 1) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * The segmenter only keeps the bounds of its regions, so each candidate is
+ * measured as the largest component within the bounds of its region. This
+ * touches only the pixels around the candidates, instead of segmenting the
+ * whole image a second time.
+ */
+void FiducialDetector::collectFingerCandidates(const cv::Mat& input)
+{
+	for (int i = 0; i < segmenter.region_count; ++i) {
+		const Region* region = LOOKUP_SEGMENTER_REGION((&segmenter), i);
+		if (!isFingerRegion(*region)) {
+			continue;
+		}
+
+		cv::Rect bounds(region->left, region->top, region->right - region->left + 1, region->bottom - region->top + 1);
+		cv::Mat regionInput = input(bounds);
+
+		labeler.label(regionInput);
+
+		const std::vector<ComponentLabeler::Component>& components = labeler.getComponents();
+		std::vector<ComponentLabeler::Component>::const_iterator largest = components.end();
+		for (std::vector<ComponentLabeler::Component>::const_iterator component = components.begin();
+			component != components.end(); ++component) {
+			if (largest == components.end() || component->area > largest->area) {
+				largest = component;
+			}
+		}
+
+		if (largest == components.end()) {
+			continue;
+		}
+
+		fingerCandidates.push_back(FingerCandidate());
+		FingerCandidate& candidate = fingerCandidates.back();
+
+		ComponentLabeler::traceOutline(regionInput, largest->start, candidate.outline);
+		for (std::vector<cv::Point>::iterator point = candidate.outline.begin(); point != candidate.outline.end(); ++point) {
+			*point += bounds.tl();
+		}
+
+		candidate.component = *largest;
+		candidate.component.centroidX += bounds.x;
+		candidate.component.centroidY += bounds.y;
+		candidate.component.bounds += bounds.tl();
+		candidate.component.start += bounds.tl();
 	}
 }
 
+/*
+ * Fiducials are nested at least two levels below the background, so a bright
+ * leaf whose only adjacent region (its enclosing one) touches the image
+ * border cannot be part of one. Leaves of a region with too many adjacent
+ * regions for the trees are not recorded as adjacent, but such a region is
+ * no fiducial either.
+ */
+bool FiducialDetector::isFingerRegion(const Region& region) const
+{
+	if ((region.flags & (FREE_REGION_FLAG | ADJACENT_TO_ROOT_REGION_FLAG)) || region.colour == 0) {
+		return false;
+	}
+
+	if (region.adjacent_region_count == 0) {
+		return (region.flags & FRAGMENTED_REGION_FLAG) != 0;
+	}
+
+	return region.adjacent_region_count == 1 && (region.adjacent_regions[0]->flags & ADJACENT_TO_ROOT_REGION_FLAG) != 0;
+}
+
 void FiducialDetector::initSegmenter()
 {
 	deinitSegmenter();
@@ -213,10 +454,33 @@ void FiducialDetector::deinitSegmenter()
 	}
 }
 
+void FiducialDetector::initRegionSegmenter()
+{
+	deinitRegionSegmenter();
+
+	if (!treeAndTrackerInitialized) {
+		initTreeAndTracker();
+	}
+
+	initialize_segmenter(&regionSegmenter, regionWidth, regionHeight, tree.max_adjacencies);
+
+	regionSegmenterInitialized = true;
+}
+
+void FiducialDetector::deinitRegionSegmenter()
+{
+	if (regionSegmenterInitialized) {
+		terminate_segmenter(&regionSegmenter);
+
+		regionSegmenterInitialized = false;
+	}
+}
+
 void FiducialDetector::initTreeAndTracker()
 {
 	deinitTreeAndTracker();
 	deinitSegmenter();
+	deinitRegionSegmenter();
 
 	initialize_treeidmap_from_file(&tree, filesystem::toData(trees).string().c_str());
 	if (tree.max_adjacencies <= 0) {
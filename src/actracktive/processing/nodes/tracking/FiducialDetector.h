@@ -25,8 +25,11 @@
 #include "actracktive/processing/nodes/Object.h"
 #include "actracktive/processing/nodes/ObjectSource.h"
 #include "actracktive/processing/nodes/sources/ImageSource.h"
+#include "actracktive/processing/nodes/tracking/ComponentLabeler.h"
 #include "segment.h"
 #include "fidtrackX.h"
+#include "opencv2/opencv.hpp"
+#include <vector>
 
 #define MAX_FIDUCIAL_COUNT 512
 
@@ -34,6 +37,9 @@ class Fiducial: public Object
 {
 
 public:
+	friend class ObjectStreamWriter;
+	friend class ObjectStreamReader;
+
 	Fiducial(unsigned int id, unsigned int objectId, const boost::posix_time::ptime& time, const Vector2D& position, double angle,
 		const std::vector<Vector2D>& outline);
 
@@ -43,7 +49,7 @@ public:
 	double getRotationVelocity() const;
 	double getRotationAcceleration() const;
 
-	virtual void transform(const Transformer& t);
+	virtual void transform(const Transformer::Snapshot::Ptr& snapshot);
 
 	virtual void toOsc(osc::OutboundPacketStream& ops) const;
 
@@ -67,35 +73,83 @@ public:
 	static const Node::Type& TYPE();
 	const Node::Type& getType() const;
 
+	/**
+	 * A bright leaf region of the segmentation lying directly on the
+	 * background, i.e. not being part of any fiducial, in the coordinates of
+	 * the input image.
+	 */
+	struct FingerCandidate
+	{
+		ComponentLabeler::Component component;
+		std::vector<cv::Point> outline;
+	};
+
 	FiducialDetector(const std::string& id, const std::string& name = "Fiducial Detector");
 	virtual ~FiducialDetector();
 
 	virtual void start();
 	virtual void stop();
 
+	/**
+	 * Returns the finger candidates found in the same segmentation as the
+	 * fiducials of the last frame, if findFingers is set. Multiplying their
+	 * coordinates by getFingerCandidateScale() gives full resolution.
+	 */
+	const std::vector<FingerCandidate>& getFingerCandidates() const;
+	double getFingerCandidateScale() const;
+
 protected:
 	virtual void fetch(Objects& destination);
 
 private:
 	ValueProperty<bool> enabled;
 	ValueProperty<boost::filesystem::path> trees;
+	ValueProperty<bool> trackRegions;
+	ValueProperty<unsigned int> regionSize;
+	ValueProperty<unsigned int> fullScanInterval;
+	ValueProperty<bool> findFingers;
 	TypedNodeConnection<ImageSource> source;
+	TypedNodeConnection<ObjectSource> trackedFiducials;
 
 	int width;
 	int height;
+	int regionWidth;
+	int regionHeight;
 
 	bool segmenterInitialized;
+	bool regionSegmenterInitialized;
 	bool treeAndTrackerInitialized;
 
 	Segmenter segmenter;
+	Segmenter regionSegmenter;
 	TreeIdMap tree;
 	FidtrackerX tracker;
 
 	FiducialX foundFiducials[MAX_FIDUCIAL_COUNT];
+	FiducialX regionFiducials[MAX_FIDUCIAL_COUNT];
+
+	cv::Mat regionImage;
+	std::vector<Vector2D> regionCenters;
+	std::vector<Vector2D> previousPositions;
+	unsigned int framesSinceFullScan;
+
+	ComponentLabeler labeler;
+	std::vector<FingerCandidate> fingerCandidates;
+	double fingerCandidateScale;
+
+	bool collectRegionCenters(double scale);
+	int findFiducialsInRegions(const cv::Mat& input);
+	bool isDuplicate(const FiducialX& fiducial, int count) const;
+
+	void collectFingerCandidates(const cv::Mat& input);
+	bool isFingerRegion(const Region& region) const;
 
 	void initSegmenter();
 	void deinitSegmenter();
 
+	void initRegionSegmenter();
+	void deinitRegionSegmenter();
+
 	void initTreeAndTracker();
 	void deinitTreeAndTracker();
 
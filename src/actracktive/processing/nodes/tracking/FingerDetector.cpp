@@ -60,16 +60,41 @@ FingerDetector::FingerDetector(const std::string& id, const std::string& name)
 		minFingerSize("minFingerSize", "Minimum Size (Area)", mutex, 50, Constraint<unsigned int>(0, 2000)),
 		maxFingerSize("maxFingerSize", "Maximum Size (Area)", mutex, 400, Constraint<unsigned int>(0, 2000)),
 		maxEccentricity("maxEccentricity", "Max. Eccentricity", mutex, 0.5, Constraint<double>(0, 1)),
-		onlyConvex("onlyConvex", "Only Convex Shapes", mutex, false), source("source", "Source", mutex), inputCopy()
+		onlyConvex("onlyConvex", "Only Convex Shapes", mutex, false),
+		threads("threads", "Threads", mutex, 1, Constraint<unsigned int>(1, 16)), source("source", "Source", mutex), labeler(), contour(),
+		detections(), detectionBounds(), detectionsValid(false), detectionsSequenceNumber(0)
 {
 	settings.add(enabled);
 	settings.add(minFingerSize);
 	settings.add(maxFingerSize);
 	settings.add(maxEccentricity);
 	settings.add(onlyConvex);
+	settings.add(threads);
 	connections.add(source);
 }
 
+void FingerDetector::start()
+{
+	ObjectSource::start();
+
+	const Properties::Values& properties = settings.getAll();
+	for (Properties::Values::const_iterator property = properties.begin(); property != properties.end(); ++property) {
+		(*property)->onChange.connect(boost::bind(&FingerDetector::invalidateDetections, this));
+	}
+
+	invalidateDetections();
+}
+
+void FingerDetector::stop()
+{
+	ObjectSource::stop();
+
+	const Properties::Values& properties = settings.getAll();
+	for (Properties::Values::const_iterator property = properties.begin(); property != properties.end(); ++property) {
+		(*property)->onChange.disconnect(boost::bind(&FingerDetector::invalidateDetections, this));
+	}
+}
+
 void FingerDetector::fetch(Objects& destination)
 {
 	if (!source) {
@@ -79,6 +104,8 @@ void FingerDetector::fetch(Objects& destination)
 	destination.clear();
 
 	if (enabled) {
+		bool detected = true;
+
 		{
 			Lock lock(source);
 
@@ -86,61 +113,92 @@ void FingerDetector::fetch(Objects& destination)
 			const cv::Mat& input = source->get();
 			timer.resume();
 
-			input.copyTo(inputCopy);
+			// If no tile of the image changed, the previous detections still
+			// apply. Otherwise the image is labeled in place instead of being
+			// copied, which requires the source to stay locked.
+			if (!isSourceUnchanged()) {
+				detected = detectFingers(input, source->getScale());
+			}
+
+			detectionsSequenceNumber = source->getSequenceNumber();
 		}
 
-		if (inputCopy.empty()) {
+		if (!detected) {
 			return;
 		}
 
-		std::vector<std::vector<cv::Point> > contours;
-		cv::findContours(inputCopy, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
-
 		boost::posix_time::ptime time(boost::posix_time::microsec_clock::local_time());
-		for (std::vector<std::vector<cv::Point> >::iterator contourIt = contours.begin(); contourIt != contours.end(); ++contourIt) {
-			std::vector<cv::Point>& contour = *contourIt;
-			cv::Mat contourMat(contour);
-
-			if (!onlyConvex || cv::isContourConvex(contourMat)) {
-				cv::Moments moments = cv::moments(contourMat);
-				double area = moments.m00;
-				double eccentricity = computeEccentricity(moments);
-				if ((area >= minFingerSize) && (area <= maxFingerSize) && (eccentricity <= maxEccentricity)) {
-					std::vector<Vector2D> outline;
-					for (std::vector<cv::Point>::iterator point = contour.begin(); point != contour.end(); ++point) {
-						outline.push_back(Vector2D(point->x, point->y));
-					}
-
-					Vector2D position((moments.m10 / moments.m00), (moments.m01 / moments.m00));
-
-					destination.add(new Finger(0, time, position, outline));
-				}
-			}
+		for (std::vector<Detection>::const_iterator detection = detections.begin(); detection != detections.end(); ++detection) {
+			destination.add(new Finger(0, time, detection->position, detection->outline));
 		}
 
-		cv::Size size = inputCopy.size();
-		destination.setBounds(Rectangle(0, 0, size.width, size.height));
+		destination.setBounds(detectionBounds);
 	}
 }
 
-inline double FingerDetector::computeEccentricity(const cv::Moments& moments) const
+/*
+ * Components are rejected by their size and shape (from the moments
+ * accumulated while labeling) before their outline is traced.
+ */
+bool FingerDetector::detectFingers(const cv::Mat& input, double scale)
 {
-	double mu20norm = moments.mu20 / moments.m00;
-	double mu02norm = moments.mu02 / moments.m00;
-	double mu11norm = moments.mu11 / moments.m00;
+	detections.clear();
+	detectionsValid = false;
 
-	double partOne = mu20norm + mu02norm / 2;
-	double partTwo = sqrt(4 * square(mu11norm) + square(mu20norm - mu02norm)) / 2;
+	if (input.empty()) {
+		return false;
+	}
+
+	labeler.label(input, threads);
 
-	double lambda1 = partOne + partTwo;
-	double lambda2 = partOne - partTwo;
+	// Coordinates and areas are reported in full resolution
+	const std::vector<ComponentLabeler::Component>& components = labeler.getComponents();
+	for (std::vector<ComponentLabeler::Component>::const_iterator component = components.begin(); component != components.end();
+		++component) {
+		double area = component->area * scale * scale;
+		double eccentricity = ComponentLabeler::computeEccentricity(*component);
+		if ((area < minFingerSize) || (area > maxFingerSize) || !(eccentricity <= maxEccentricity)) {
+			continue;
+		}
+
+		ComponentLabeler::traceOutline(input, component->start, contour);
+		if (onlyConvex && !cv::isContourConvex(cv::Mat(contour))) {
+			continue;
+		}
+
+		Detection detection;
+		detection.position = ImageSource::toFullResolution(Vector2D(component->centroidX, component->centroidY), scale);
+		for (std::vector<cv::Point>::const_iterator point = contour.begin(); point != contour.end(); ++point) {
+			detection.outline.push_back(ImageSource::toFullResolution(Vector2D(point->x, point->y), scale));
+		}
+
+		detections.push_back(detection);
+	}
 
-	return sqrt(1 - lambda2 / lambda1);
+	cv::Size size = input.size();
+	detectionBounds = Rectangle(0, 0, size.width * scale, size.height * scale);
+	detectionsValid = true;
+
+	return true;
+}
+
+/*
+ * Must be called with the source locked, directly after fetching its image.
+ */
+bool FingerDetector::isSourceUnchanged() const
+{
+	const DirtyTiles* tiles = source->getDirtyTiles();
+	unsigned long sequenceNumber = source->getSequenceNumber();
+
+	return detectionsValid && tiles != NULL && tiles->getSequenceNumber() == sequenceNumber
+		&& detectionsSequenceNumber + 1 == sequenceNumber && tiles->getDirtyCount() == 0;
 }
 
-inline double FingerDetector::square(double value) const
+void FingerDetector::invalidateDetections()
 {
-	return value * value;
+	Lock lock(this);
+
+	detectionsValid = false;
 }
 
 static bool __registered = registerNodeType<FingerDetector>();
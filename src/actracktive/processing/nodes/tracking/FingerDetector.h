@@ -25,6 +25,7 @@
 #include "actracktive/processing/nodes/Object.h"
 #include "actracktive/processing/nodes/ObjectSource.h"
 #include "actracktive/processing/nodes/sources/ImageSource.h"
+#include "actracktive/processing/nodes/tracking/ComponentLabeler.h"
 
 class Finger: public Object
 {
@@ -48,6 +49,9 @@ public:
 
 	FingerDetector(const std::string& id, const std::string& name = "Finger Detector");
 
+	virtual void start();
+	virtual void stop();
+
 protected:
 	virtual void fetch(Objects& destination);
 
@@ -57,12 +61,26 @@ private:
 	ValueProperty<unsigned int> maxFingerSize;
 	ValueProperty<double> maxEccentricity;
 	ValueProperty<bool> onlyConvex;
+	ValueProperty<unsigned int> threads;
 	TypedNodeConnection<ImageSource> source;
 
-	cv::Mat inputCopy;
+	ComponentLabeler labeler;
+	std::vector<cv::Point> contour;
+
+	struct Detection
+	{
+		Vector2D position;
+		std::vector<Vector2D> outline;
+	};
+
+	std::vector<Detection> detections;
+	Rectangle detectionBounds;
+	bool detectionsValid;
+	unsigned long detectionsSequenceNumber;
 
-	double computeEccentricity(const cv::Moments& moments) const;
-	double square(double value) const;
+	bool detectFingers(const cv::Mat& input, double scale);
+	bool isSourceUnchanged() const;
+	void invalidateDetections();
 
 };
 
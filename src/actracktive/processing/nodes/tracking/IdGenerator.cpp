@@ -34,20 +34,121 @@ const Node::Type& IdGenerator::getType() const
 }
 
 IdGenerator::IdGenerator(const std::string& id, const std::string& name)
-	: Node(id, name), currentId(0)
+	: Node(id, name), recycleIds("recycleIds", "Recycle IDs", mutex, false),
+		quarantineFrames("quarantineFrames", "Quarantine (Frames)", mutex, 30, Constraint<unsigned int>(0, 1000)),
+		poolSize("poolSize", "Recycled IDs Pool Size", mutex, 1024, Constraint<unsigned int>(16, 65536)), currentId(0), currentFrame(0),
+		recycling(false), quarantine(0), slots(), mask(0), head(0), tail(0)
 {
+	settings.add(recycleIds);
+	settings.add(quarantineFrames);
+	settings.add(poolSize);
 }
 
 void IdGenerator::start()
 {
+	Node::start();
+
+	Lock lock(this);
+
 	currentId = 0;
+	currentFrame = 0;
+
+	recycling = recycleIds;
+	quarantine = quarantineFrames;
+
+	// The pool size is rounded up to a power of two
+	unsigned long size = 1;
+	while (size < poolSize) {
+		size *= 2;
+	}
+
+	slots.resize(recycling ? size : 0);
+	for (unsigned long position = 0; position < slots.size(); ++position) {
+		slots[position].sequence = position;
+	}
+
+	mask = size - 1;
+	head = 0;
+	tail = 0;
+}
+
+void IdGenerator::step()
+{
+	Node::step();
+
+	__sync_add_and_fetch(&currentFrame, 1);
 }
 
 unsigned int IdGenerator::nextId()
 {
-	Lock lock(this);
+	unsigned int id;
+	if (recycling && takeRecycledId(id)) {
+		return id;
+	}
+
+	return __sync_add_and_fetch(&currentId, 1);
+}
+
+void IdGenerator::releaseId(unsigned int id)
+{
+	if (!recycling) {
+		return;
+	}
+
+	unsigned long position = tail;
+	while (true) {
+		Slot& slot = slots[position & mask];
+		long difference = long(slot.sequence - position);
+
+		if (difference == 0) {
+			if (__sync_bool_compare_and_swap(&tail, position, position + 1)) {
+				slot.id = id;
+				slot.frame = currentFrame;
+				__sync_synchronize();
+				slot.sequence = position + 1;
+				return;
+			}
+		} else if (difference < 0) {
+			// The pool is full, so the ID is dropped
+			return;
+		}
+
+		position = tail;
+	}
+}
+
+/*
+ * IDs are released in the order of their frames, so if the oldest one is
+ * still in quarantine, all others are as well. The slot is read before it is
+ * claimed, which is safe because it can only be reused after it was claimed.
+ */
+bool IdGenerator::takeRecycledId(unsigned int& id)
+{
+	unsigned long position = head;
+	while (true) {
+		Slot& slot = slots[position & mask];
+		long difference = long(slot.sequence - (position + 1));
+
+		if (difference == 0) {
+			__sync_synchronize();
+
+			if (slot.frame + quarantine > currentFrame) {
+				return false;
+			}
+
+			unsigned int recycledId = slot.id;
+			if (__sync_bool_compare_and_swap(&head, position, position + 1)) {
+				slot.sequence = position + mask + 1;
+				id = recycledId;
+				return true;
+			}
+		} else if (difference < 0) {
+			// The pool is empty
+			return false;
+		}
 
-	return ++currentId;
+		position = head;
+	}
 }
 
 static bool __registered = registerNodeType<IdGenerator>();
@@ -23,7 +23,15 @@
 #define IDGENERATOR_H_
 
 #include "actracktive/processing/Node.h"
+#include <vector>
 
+/**
+ * Hands out object IDs without locking, so it can be shared by trackers
+ * running concurrently. Optionally, the IDs of dead objects are recycled once
+ * they have been dead for a number of frames, which keeps the IDs small for
+ * clients with fixed size tables. Recycling is configured when the graph is
+ * started.
+ */
 class IdGenerator: public Node
 {
 public:
@@ -33,11 +41,44 @@ public:
 	IdGenerator(const std::string& id, const std::string& name = "Id Generator");
 
 	virtual void start();
+	virtual void step();
 
 	virtual unsigned int nextId();
 
+	/**
+	 * Returns the ID of an object which died. The ID is only recycled if the
+	 * pool of released IDs is not full.
+	 */
+	virtual void releaseId(unsigned int id);
+
 private:
-	unsigned int currentId;
+	/**
+	 * The released IDs are kept in a bounded queue, in which each slot's
+	 * sequence tells whether it is free to write to (equal to the position
+	 * it is written at) or holds an ID (position + 1).
+	 */
+	struct Slot
+	{
+		volatile unsigned long sequence;
+		unsigned int id;
+		unsigned long frame;
+	};
+
+	ValueProperty<bool> recycleIds;
+	ValueProperty<unsigned int> quarantineFrames;
+	ValueProperty<unsigned int> poolSize;
+
+	volatile unsigned int currentId;
+	volatile unsigned long currentFrame;
+
+	bool recycling;
+	unsigned long quarantine;
+	std::vector<Slot> slots;
+	unsigned long mask;
+	volatile unsigned long head;
+	volatile unsigned long tail;
+
+	bool takeRecycledId(unsigned int& id);
 
 };
 
@@ -21,32 +21,20 @@
 
 #include "actracktive/processing/nodes/tracking/ObjectTracker.h"
 #include "actracktive/processing/NodeFactory.h"
+#include <algorithm>
+#include <cmath>
 
-const Distance Distance::INFINITE = Distance();
+// Objects are matched within this many standard deviations of the prediction
+static const double PREDICTION_DEVIATIONS = 3;
 
-Distance::Distance(const Object* first, const Object* second, double distance)
-	: first(first), second(second), distance(distance)
+bool ObjectTracker::Candidate::operator<(const Candidate& other) const
 {
+	return group < other.group;
 }
 
-Distance::Distance()
-	: first(NULL), second(NULL), distance(-1)
+bool ObjectTracker::Cell::operator<(const Cell& other) const
 {
-}
-
-bool Distance::operator==(const Distance& other) const
-{
-	return this->isInfinity() ? other.isInfinity() : distance == other.distance;
-}
-
-bool Distance::operator<(const Distance& other) const
-{
-	return this->isInfinity() ? false : distance < other.distance;
-}
-
-bool Distance::isInfinity() const
-{
-	return first == NULL || second == NULL || distance < 0;
+	return y < other.y || (y == other.y && x < other.x);
 }
 
 const Node::Type& ObjectTracker::TYPE()
@@ -63,12 +51,22 @@ const Node::Type & ObjectTracker::getType() const
 ObjectTracker::ObjectTracker(const std::string& id, const std::string& name)
 	: ObjectSource(id, name), enabled("enabled", "Enabled", mutex, true),
 		maxMatchingDistance("maxMatchingDistance", "Max. Matching Distance", mutex, 200, Constraint<double>(0, 400)),
-		framesToLive("framesToLive", "Frames To Live", mutex, 10, Constraint<unsigned int>(0, 100)), source("source", "Source", mutex),
-		idGenerator("idGenerator", "ID Generator", mutex)
+		framesToLive("framesToLive", "Frames To Live", mutex, 10, Constraint<unsigned int>(0, 100)),
+		predictMotion("predictMotion", "Predict Motion", mutex, false),
+		minMatchingDistance("minMatchingDistance", "Min. Matching Distance", mutex, 20, Constraint<double>(0, 400)),
+		accelerationNoise("accelerationNoise", "Acceleration Noise (px/s^2)", mutex, 5000, Constraint<double>(0, 100000)),
+		measurementNoise("measurementNoise", "Measurement Noise (px)", mutex, 2, Constraint<double>(0, 50)), source("source", "Source", mutex),
+		idGenerator("idGenerator", "ID Generator", mutex), trackedSource(NULL), trackedSequenceNumber(0), previousObjects(), previous(),
+		current(), predictedPositions(), matchingDistances(), grid(), candidates(), candidateCounts(), groups(), currentMatches(), previousMatches(), solver(), groupIndices(),
+		groupRows(), groupColumns(), costs(), assignment()
 {
 	settings.add(enabled);
 	settings.add(maxMatchingDistance);
 	settings.add(framesToLive);
+	settings.add(predictMotion);
+	settings.add(minMatchingDistance);
+	settings.add(accelerationNoise);
+	settings.add(measurementNoise);
 	connections.add(source);
 	connections.add(idGenerator);
 }
@@ -83,12 +81,22 @@ void ObjectTracker::fetch(Objects& destination)
 
 	timer.pause();
 	const Objects& objects = source->get();
+	unsigned long sequenceNumber = source->getSequenceNumber();
 	timer.resume();
 
+	// A rate limited source republishes its previous objects. Matching them
+	// again would count as a step without any movement, so the tracked
+	// objects are kept as they are instead.
+	if (source == trackedSource && sequenceNumber == trackedSequenceNumber) {
+		return;
+	}
+
+	trackedSource = source;
+	trackedSequenceNumber = sequenceNumber;
+
 	if (enabled) {
 		shiftTrackedToPrevious(destination);
-		enqueueCurrentObjects(objects);
-		matchCurrentObjects(destination);
+		matchCurrentObjects(objects, destination);
 		destination.setBounds(objects.getBounds());
 	} else {
 		destination = objects;
@@ -100,100 +108,288 @@ void ObjectTracker::shiftTrackedToPrevious(Objects& trackedObjects)
 	trackedObjects.moveTo(previousObjects);
 }
 
-void ObjectTracker::enqueueCurrentObjects(const Objects& objects)
+void ObjectTracker::matchCurrentObjects(const Objects& objects, Objects& trackedObjects)
 {
-	for (Objects::ConstIterator object = objects.begin(); object != objects.end(); ++object) {
-		currentObjects.push(*object);
-	}
-}
+	current.assign(objects.begin(), objects.end());
+	previous.assign(previousObjects.begin(), previousObjects.end());
 
-void ObjectTracker::matchCurrentObjects(Objects& trackedObjects)
-{
-	while (!currentObjects.empty()) {
-		const Object* object = currentObjects.front();
+	double maxDistance = predictPositions();
+	findCandidates(maxDistance);
+	assignCandidates(maxDistance);
 
-		if (!matchWithPreviousObject(object)) {
-			Object* newObject = foundObject(*object);
+	for (unsigned int i = 0; i < current.size(); ++i) {
+		if (currentMatches[i] < 0) {
+			Object* newObject = foundObject(*current[i]);
 			if (newObject != NULL) {
 				trackedObjects.add(newObject);
 			}
 		}
-
-		currentObjects.pop();
 	}
 
-	for (Objects::Iterator previousObject = previousObjects.begin(); previousObject != previousObjects.end(); ++previousObject) {
-		std::map<const Object*, Distance>::iterator matched = candidateMatches.find(*previousObject);
-		if (matched != candidateMatches.end()) {
-			Object* updatedObject = trackedObject(*previousObject, *(matched->second.first));
+	for (unsigned int j = 0; j < previous.size(); ++j) {
+		if (previousMatches[j] >= 0) {
+			Object* updatedObject = trackedObject(previous[j], *current[previousMatches[j]]);
 
 			if (updatedObject != NULL) {
 				trackedObjects.add(updatedObject);
 			}
 		} else {
-			Object* staleObject = lostObject(*previousObject);
+			Object* staleObject = lostObject(previous[j]);
 
 			if (staleObject != NULL) {
 				trackedObjects.add(staleObject);
 			}
 		}
 	}
+
 	previousObjects.clear();
-	candidateMatches.clear();
+	previous.clear();
+	current.clear();
 }
 
-bool ObjectTracker::matchWithPreviousObject(const Object* object)
+/*
+ * Without motion prediction, the previous objects are matched at their last
+ * positions within the maximum matching distance. Returns the largest
+ * matching distance of all previous objects.
+ */
+double ObjectTracker::predictPositions()
 {
-	std::priority_queue<Distance, std::vector<Distance>, std::greater<Distance> > candidateObjects;
-	for (Objects::Iterator previousObject = previousObjects.begin(); previousObject != previousObjects.end(); ++previousObject) {
-		Distance candidate = distance(*object, **previousObject);
-		if (!(candidate.isInfinity() || candidate.distance > (maxMatchingDistance * maxMatchingDistance))) {
-			candidateObjects.push(candidate);
+	double maxDistance = maxMatchingDistance;
+
+	predictedPositions.clear();
+	matchingDistances.clear();
+
+	if (!predictMotion || current.empty()) {
+		for (std::vector<Object*>::const_iterator object = previous.begin(); object != previous.end(); ++object) {
+			predictedPositions.push_back((*object)->getPosition());
+			matchingDistances.push_back(maxDistance);
 		}
+
+		return maxDistance;
 	}
 
-	while (!candidateObjects.empty()) {
-		const Distance & candidate = candidateObjects.top();
+	// All objects of a frame share the same time
+	const boost::posix_time::ptime& time = current.front()->getTime();
+	double minDistance = std::min<double>(minMatchingDistance, maxDistance);
+
+	double largestDistance = 0;
+	for (std::vector<Object*>::const_iterator object = previous.begin(); object != previous.end(); ++object) {
+		double distance = maxDistance;
+		if ((*object)->hasMotionModel()) {
+			double deviation = std::sqrt((*object)->getPredictionVariance(time));
+			distance = std::max(minDistance, std::min(maxDistance, PREDICTION_DEVIATIONS * deviation));
+		}
 
-		std::map<const Object*, Distance>::iterator existingMatch = candidateMatches.find(candidate.second);
+		predictedPositions.push_back((*object)->predictPosition(time));
+		matchingDistances.push_back(distance);
+		largestDistance = std::max(largestDistance, distance);
+	}
 
-		bool hasExistingMatch = (existingMatch != candidateMatches.end());
-		bool thisMatchBeatsExisting = hasExistingMatch && (candidate < existingMatch->second);
+	return largestDistance;
+}
 
-		if (thisMatchBeatsExisting) {
-			currentObjects.push(existingMatch->second.first);
-			candidateMatches.erase(existingMatch);
+/*
+ * With cells as large as the maximum matching distance, all previous objects
+ * in range of a current object lie in the cell of the current object or one
+ * of its eight neighbours.
+ */
+void ObjectTracker::findCandidates(double maxDistance)
+{
+	double cellSize = std::max(maxDistance, 1.0);
+
+	grid.clear();
+	for (unsigned int j = 0; j < previous.size(); ++j) {
+		const Vector2D& position = predictedPositions[j];
+		Cell cell = { int(std::floor(position.x / cellSize)), int(std::floor(position.y / cellSize)), j };
+		grid.push_back(cell);
+	}
+
+	std::sort(grid.begin(), grid.end());
+
+	candidates.clear();
+	for (unsigned int i = 0; i < current.size(); ++i) {
+		const Vector2D& position = current[i]->getPosition();
+		int x = int(std::floor(position.x / cellSize));
+		int y = int(std::floor(position.y / cellSize));
+
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				Cell key = { x + dx, y + dy, 0 };
+				std::pair<std::vector<Cell>::const_iterator, std::vector<Cell>::const_iterator> cells = std::equal_range(grid.begin(),
+					grid.end(), key);
+
+				for (std::vector<Cell>::const_iterator cell = cells.first; cell != cells.second; ++cell) {
+					const Object* candidate = previous[cell->previous];
+					if (candidate->getObjectId() != current[i]->getObjectId()) {
+						continue;
+					}
+
+					double distance = position.distanceSQ(predictedPositions[cell->previous]);
+					double matchingDistance = matchingDistances[cell->previous];
+					if (distance <= matchingDistance * matchingDistance) {
+						Candidate pair = { i, cell->previous, distance, 0 };
+						candidates.push_back(pair);
+					}
+				}
+			}
 		}
+	}
+}
 
-		if (!hasExistingMatch || thisMatchBeatsExisting) {
-			candidateMatches[candidate.second] = Distance(object, candidate.second, candidate.distance);
-			return true;
+/*
+ * Candidates are grouped into the connected components of the graph with the
+ * objects as nodes (current objects first) and the candidates as edges. A
+ * candidate which is the only one of both its objects is matched directly,
+ * which is the usual case for objects that are not close to each other. The
+ * remaining groups are assigned independently.
+ */
+void ObjectTracker::assignCandidates(double maxDistance)
+{
+	const unsigned int currentCount = current.size();
+	const unsigned int nodeCount = currentCount + previous.size();
+
+	currentMatches.assign(currentCount, -1);
+	previousMatches.assign(previous.size(), -1);
+
+	candidateCounts.assign(nodeCount, 0);
+	groups.resize(nodeCount);
+	for (unsigned int node = 0; node < nodeCount; ++node) {
+		groups[node] = node;
+	}
+
+	for (std::vector<Candidate>::const_iterator candidate = candidates.begin(); candidate != candidates.end(); ++candidate) {
+		++candidateCounts[candidate->current];
+		++candidateCounts[currentCount + candidate->previous];
+
+		unsigned int first = findGroup(candidate->current);
+		unsigned int second = findGroup(currentCount + candidate->previous);
+		if (first != second) {
+			groups[second] = first;
+		}
+	}
+
+	std::vector<Candidate>::iterator ambiguous = candidates.begin();
+	for (std::vector<Candidate>::const_iterator candidate = candidates.begin(); candidate != candidates.end(); ++candidate) {
+		if (candidateCounts[candidate->current] == 1 && candidateCounts[currentCount + candidate->previous] == 1) {
+			match(candidate->current, candidate->previous);
+		} else {
+			*ambiguous = *candidate;
+			ambiguous->group = findGroup(candidate->current);
+			++ambiguous;
+		}
+	}
+	candidates.erase(ambiguous, candidates.end());
+
+	std::sort(candidates.begin(), candidates.end());
+
+	groupIndices.assign(nodeCount, -1);
+
+	std::vector<Candidate>::const_iterator begin = candidates.begin();
+	while (begin != candidates.end()) {
+		std::vector<Candidate>::const_iterator end = begin;
+		while (end != candidates.end() && end->group == begin->group) {
+			++end;
+		}
+
+		assignGroup(begin, end, maxDistance);
+		begin = end;
+	}
+}
+
+void ObjectTracker::assignGroup(std::vector<Candidate>::const_iterator begin, std::vector<Candidate>::const_iterator end,
+	double maxDistance)
+{
+	const unsigned int currentCount = current.size();
+
+	groupRows.clear();
+	groupColumns.clear();
+	for (std::vector<Candidate>::const_iterator candidate = begin; candidate != end; ++candidate) {
+		if (groupIndices[candidate->current] < 0) {
+			groupIndices[candidate->current] = groupRows.size();
+			groupRows.push_back(candidate->current);
+		}
+		if (groupIndices[currentCount + candidate->previous] < 0) {
+			groupIndices[currentCount + candidate->previous] = groupColumns.size();
+			groupColumns.push_back(candidate->previous);
+		}
+	}
+
+	// The solver requires at most as many rows as columns
+	bool transposed = groupRows.size() > groupColumns.size();
+	unsigned int rows = transposed ? groupColumns.size() : groupRows.size();
+	unsigned int columns = transposed ? groupRows.size() : groupColumns.size();
+
+	// Pairs which are not candidates cost more than any sum of candidates, so
+	// that as many objects as possible are matched
+	double unmatched = (maxDistance * maxDistance + 1) * (columns + 1);
+
+	costs.assign(rows * columns, unmatched);
+	for (std::vector<Candidate>::const_iterator candidate = begin; candidate != end; ++candidate) {
+		unsigned int row = groupIndices[candidate->current];
+		unsigned int column = groupIndices[currentCount + candidate->previous];
+		if (transposed) {
+			std::swap(row, column);
 		}
 
-		candidateObjects.pop();
+		costs[row * columns + column] = candidate->distance;
+	}
+
+	solver.solve(costs, rows, columns, assignment);
+
+	for (unsigned int row = 0; row < rows; ++row) {
+		unsigned int column = assignment[row];
+		if (costs[row * columns + column] < unmatched) {
+			if (transposed) {
+				match(groupRows[column], groupColumns[row]);
+			} else {
+				match(groupRows[row], groupColumns[column]);
+			}
+		}
 	}
 
-	return false;
+	for (std::vector<unsigned int>::const_iterator row = groupRows.begin(); row != groupRows.end(); ++row) {
+		groupIndices[*row] = -1;
+	}
+	for (std::vector<unsigned int>::const_iterator column = groupColumns.begin(); column != groupColumns.end(); ++column) {
+		groupIndices[currentCount + *column] = -1;
+	}
+}
+
+void ObjectTracker::match(unsigned int currentIndex, unsigned int previousIndex)
+{
+	currentMatches[currentIndex] = previousIndex;
+	previousMatches[previousIndex] = currentIndex;
 }
 
-Distance ObjectTracker::distance(const Object& first, const Object& second) const
+unsigned int ObjectTracker::findGroup(unsigned int node)
 {
-	if (first.getObjectId() != second.getObjectId()) {
-		return Distance::INFINITE;
+	while (groups[node] != node) {
+		groups[node] = groups[groups[node]];
+		node = groups[node];
 	}
 
-	return Distance(&first, &second, first.getPosition().distanceSQ(second.getPosition()));
+	return node;
+}
+
+void ObjectTracker::applyMotionModel(Object& object)
+{
+	if (predictMotion) {
+		// The noise is configured per second, but objects measure time in ms
+		object.setMotionModel(accelerationNoise / 1e6, measurementNoise);
+	}
 }
 
 Object* ObjectTracker::foundObject(const Object& object)
 {
 	Object* copy = object.clone();
 	copy->setId(idGenerator->nextId());
+	applyMotionModel(*copy);
 	return copy;
 }
 
 Object* ObjectTracker::trackedObject(Object* previous, const Object& current)
 {
+	applyMotionModel(*previous);
 	previous->update(current);
 	return previous;
 }
@@ -207,6 +403,7 @@ Object* ObjectTracker::lostObject(Object* object)
 			object->kill();
 		}
 	} else {
+		idGenerator->releaseId(object->getId());
 		delete object;
 		object = NULL;
 	}
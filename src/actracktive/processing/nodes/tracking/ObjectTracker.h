@@ -23,34 +23,22 @@
 #define TRACKING_H_
 
 #include "actracktive/processing/nodes/ObjectSource.h"
+#include "actracktive/processing/nodes/tracking/AssignmentSolver.h"
 #include "actracktive/processing/nodes/tracking/IdGenerator.h"
-#include "actracktive/util/Comparable.h"
-#include <list>
-#include <map>
-#include <queue>
-#include <set>
-#include <utility>
-#include <boost/bind.hpp>
-
-class Distance: public Comparable<Distance>
-{
-public:
-	static const Distance INFINITE;
-
-	Distance();
-	Distance(const Object* first, const Object* second, double distance);
-
-	bool operator==(const Distance& other) const;
-	bool operator<(const Distance& other) const;
-
-	bool isInfinity() const;
-
-	const Object* first;
-	const Object* second;
-	double distance;
-
-};
-
+#include <vector>
+
+/**
+ * Matches the objects of its source to the objects tracked in the previous
+ * frame. Only pairs of objects within the maximum matching distance of each
+ * other are considered, which are found through a grid over the previous
+ * objects. Among these, the assignment matching most objects with the
+ * minimal sum of squared distances is chosen.
+ *
+ * With motion prediction, each tracked object estimates its velocity with a
+ * Kalman filter, and is matched at its predicted position within a distance
+ * depending on the uncertainty of the prediction. Fast objects can then be
+ * tracked with a small matching distance.
+ */
 class ObjectTracker: public ObjectSource
 {
 public:
@@ -63,22 +51,74 @@ protected:
 	virtual void fetch(Objects& destination);
 
 private:
+	/**
+	 * A pair of a current and a previous object which may be matched.
+	 */
+	struct Candidate
+	{
+		unsigned int current;
+		unsigned int previous;
+		double distance;
+		unsigned int group;
+
+		bool operator<(const Candidate& other) const;
+	};
+
+	struct Cell
+	{
+		int x;
+		int y;
+		unsigned int previous;
+
+		bool operator<(const Cell& other) const;
+	};
+
 	ValueProperty<bool> enabled;
 	ValueProperty<double> maxMatchingDistance;
 	ValueProperty<unsigned int> framesToLive;
+	ValueProperty<bool> predictMotion;
+	ValueProperty<double> minMatchingDistance;
+	ValueProperty<double> accelerationNoise;
+	ValueProperty<double> measurementNoise;
 	TypedNodeConnection<ObjectSource> source;
 	TypedNodeConnection<IdGenerator> idGenerator;
 
+	const ObjectSource* trackedSource;
+	unsigned long trackedSequenceNumber;
+
 	Objects::Set previousObjects;
-	std::queue<const Object*> currentObjects;
-	std::map<const Object*, Distance> candidateMatches;
+	std::vector<Object*> previous;
+	std::vector<const Object*> current;
+	std::vector<Vector2D> predictedPositions;
+	std::vector<double> matchingDistances;
+
+	std::vector<Cell> grid;
+	std::vector<Candidate> candidates;
+	std::vector<unsigned int> candidateCounts;
+	std::vector<unsigned int> groups;
+	std::vector<int> currentMatches;
+	std::vector<int> previousMatches;
+
+	AssignmentSolver solver;
+	std::vector<int> groupIndices;
+	std::vector<unsigned int> groupRows;
+	std::vector<unsigned int> groupColumns;
+	std::vector<double> costs;
+	std::vector<unsigned int> assignment;
 
 	void shiftTrackedToPrevious(Objects& trackedObjects);
-	void enqueueCurrentObjects(const Objects& objects);
-	void matchCurrentObjects(Objects& trackedObjects);
-	bool matchWithPreviousObject(const Object* object);
+	void matchCurrentObjects(const Objects& objects, Objects& trackedObjects);
+
+	double predictPositions();
+	void findCandidates(double maxDistance);
+	void assignCandidates(double maxDistance);
+	void assignGroup(std::vector<Candidate>::const_iterator begin, std::vector<Candidate>::const_iterator end, double maxDistance);
+	void match(unsigned int currentIndex, unsigned int previousIndex);
+
+	unsigned int findGroup(unsigned int node);
+
+	void applyMotionModel(Object& object);
 
-	Distance distance(const Object& previous, const Object& current) const;
 	Object* foundObject(const Object& object);
 	Object* trackedObject(Object* previous, const Object& current);
 	Object* lostObject(Object* object);
@@ -0,0 +1,103 @@
+/*
+ * SegmentedFingerDetector.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "actracktive/processing/nodes/tracking/SegmentedFingerDetector.h"
+#include "actracktive/processing/nodes/tracking/FingerDetector.h"
+#include "actracktive/processing/NodeFactory.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+const Node::Type& SegmentedFingerDetector::TYPE()
+{
+	static const Node::Type type = Node::Type::of<SegmentedFingerDetector>("SegmentedFingerDetector", ObjectSource::TYPE());
+	return type;
+}
+
+const Node::Type& SegmentedFingerDetector::getType() const
+{
+	return TYPE();
+}
+
+SegmentedFingerDetector::SegmentedFingerDetector(const std::string& id, const std::string& name)
+	: ObjectSource(id, name), enabled("enabled", "Enabled", mutex, true),
+		minFingerSize("minFingerSize", "Minimum Size (Area)", mutex, 50, Constraint<unsigned int>(0, 2000)),
+		maxFingerSize("maxFingerSize", "Maximum Size (Area)", mutex, 400, Constraint<unsigned int>(0, 2000)),
+		maxEccentricity("maxEccentricity", "Max. Eccentricity", mutex, 0.5, Constraint<double>(0, 1)),
+		onlyConvex("onlyConvex", "Only Convex Shapes", mutex, false), detector("detector", "Fiducial Detector", mutex)
+{
+	settings.add(enabled);
+	settings.add(minFingerSize);
+	settings.add(maxFingerSize);
+	settings.add(maxEccentricity);
+	settings.add(onlyConvex);
+	connections.add(detector);
+}
+
+void SegmentedFingerDetector::fetch(Objects& destination)
+{
+	if (!detector) {
+		return;
+	}
+
+	destination.clear();
+
+	if (enabled) {
+		Lock lock(detector);
+
+		timer.pause();
+		const Objects& fiducials = detector->get();
+		timer.resume();
+
+		// Coordinates and areas are reported in full resolution
+		double scale = detector->getFingerCandidateScale();
+
+		boost::posix_time::ptime time(boost::posix_time::microsec_clock::local_time());
+
+		const std::vector<FiducialDetector::FingerCandidate>& candidates = detector->getFingerCandidates();
+		for (std::vector<FiducialDetector::FingerCandidate>::const_iterator candidate = candidates.begin();
+			candidate != candidates.end(); ++candidate) {
+			const ComponentLabeler::Component& component = candidate->component;
+
+			double area = component.area * scale * scale;
+			double eccentricity = ComponentLabeler::computeEccentricity(component);
+			if ((area < minFingerSize) || (area > maxFingerSize) || !(eccentricity <= maxEccentricity)) {
+				continue;
+			}
+
+			if (onlyConvex && !cv::isContourConvex(cv::Mat(candidate->outline))) {
+				continue;
+			}
+
+			std::vector<Vector2D> outline;
+			for (std::vector<cv::Point>::const_iterator point = candidate->outline.begin(); point != candidate->outline.end();
+				++point) {
+				outline.push_back(ImageSource::toFullResolution(Vector2D(point->x, point->y), scale));
+			}
+
+			Vector2D position = ImageSource::toFullResolution(Vector2D(component.centroidX, component.centroidY), scale);
+			destination.add(new Finger(0, time, position, outline));
+		}
+
+		destination.setBounds(fiducials.getBounds());
+	}
+}
+
+static bool __registered = registerNodeType<SegmentedFingerDetector>();
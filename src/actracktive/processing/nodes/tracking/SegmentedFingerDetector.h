@@ -0,0 +1,56 @@
+/*
+ * SegmentedFingerDetector.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SEGMENTEDFINGERDETECTOR_H_
+#define SEGMENTEDFINGERDETECTOR_H_
+
+#include "actracktive/processing/nodes/ObjectSource.h"
+#include "actracktive/processing/nodes/tracking/FiducialDetector.h"
+
+/**
+ * Detects fingers among the finger candidates of a FiducialDetector (with
+ * findFingers set), which are found in the same segmentation as the
+ * fiducials. Unlike a FingerDetector, this needs neither a second threshold
+ * of the image nor erasing the fiducials from it.
+ */
+class SegmentedFingerDetector: public ObjectSource
+{
+public:
+	static const Node::Type& TYPE();
+	const Node::Type& getType() const;
+
+	SegmentedFingerDetector(const std::string& id, const std::string& name = "Segmented Finger Detector");
+
+protected:
+	virtual void fetch(Objects& destination);
+
+private:
+	ValueProperty<bool> enabled;
+	ValueProperty<unsigned int> minFingerSize;
+	ValueProperty<unsigned int> maxFingerSize;
+	ValueProperty<double> maxEccentricity;
+	ValueProperty<bool> onlyConvex;
+	TypedNodeConnection<FiducialDetector> detector;
+
+};
+
+#endif
@@ -100,4 +100,29 @@ void DaemonFrontend::logPerformanceData()
 
 	LOG4CPLUS_INFO(logger,
 		boost::format("Processing @ %.2f Hz (%.2f ms active, %2f ms idle)") % executionsPerSecond % nodeExecutionTime % idleTime);
+
+	if (AllocationCounter::isEnabled()) {
+		logAllocationData();
+	}
+}
+
+void DaemonFrontend::logAllocationData()
+{
+	ActracktiveApp& app = ActracktiveApp::getInstance();
+
+	const std::list<Node*>& nodes = app.graph->getNodes();
+	for (std::list<Node*>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+		const AllocationCounter& allocations = (*node)->timer.getAllocations();
+
+		LOG4CPLUS_INFO(logger,
+			boost::format("Node '%s' allocates %.1f times (%.0f bytes) per frame, %i bytes live (%i bytes peak)") % (*node)->getId()
+				% allocations.getAverageAllocations() % allocations.getAverageBytes() % allocations.getLiveBytes()
+				% allocations.getPeakLiveBytes());
+	}
+
+	const AllocationCounter& allocations = app.graph->timer.getAllocations();
+
+	LOG4CPLUS_INFO(logger,
+		boost::format("Processing graph allocates %.1f times (%.0f bytes) per frame outside of nodes")
+			% allocations.getAverageAllocations() % allocations.getAverageBytes());
 }
@@ -40,6 +40,7 @@ private:
 
 	static void terminate(int signal);
 	void logPerformanceData();
+	void logAllocationData();
 
 };
 
@@ -171,8 +171,9 @@ protected:
 	void drawCalibratedObjects(gluit::Graphics& g) const
 	{
 		Objects transformed = objects;
+		Transformer::Snapshot::Ptr snapshot = transformer->getSnapshot();
 		for (Objects::Iterator object = transformed.begin(); object != transformed.end(); ++object) {
-			(*object)->transform(*transformer);
+			(*object)->transform(snapshot);
 
 			gluit::Point position = convert((*object)->getPosition());
 
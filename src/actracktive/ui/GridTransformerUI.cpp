@@ -46,8 +46,12 @@ public:
 	GridTransformerRenderer(GridTransformer* transformer)
 		: transformer(transformer), inputPoints(), inputBounds(0, 0, 0, 0)
 	{
-		inputBounds = transformer->getInputBounds();
-		inputPoints = transformer->getInputPoints();
+		{
+			Node::Lock transformerLock(transformer);
+			inputBounds = transformer->getInputBounds();
+			inputPoints = transformer->getInputPoints();
+		}
+
 		transformer->transformerUpdated.connect(boost::bind(&GridTransformerRenderer::handleTransformerUpdate, this, _1));
 	}
 
@@ -95,8 +99,13 @@ private:
 	Rectangle inputBounds;
 	boost::mutex updateMutex;
 
+	/*
+	 * Called by the update thread of the transformer, so the grid has to be
+	 * copied with the transformer locked.
+	 */
 	void handleTransformerUpdate(const GridTransformer& transformer)
 	{
+		Node::Lock transformerLock(transformer);
 		boost::mutex::scoped_lock lock(updateMutex);
 
 		inputBounds = transformer.getInputBounds();
@@ -114,6 +114,12 @@ void NodeUI::updatePerformanceData()
 
 	std::string text = (boost::format("%.2f Hz (%.2f ms)") % executionsPerSecond % executionTime).str();
 
+	if (AllocationCounter::isEnabled()) {
+		const AllocationCounter& allocations = node->timer.getAllocations();
+		text += (boost::format(", %.1f allocs/frame, %i KiB peak") % allocations.getAverageAllocations()
+			% (allocations.getPeakLiveBytes() / 1024)).str();
+	}
+
 	gluit::invokeInEventLoop(boost::bind(&gluit::Label::setText, performanceData, text));
 }
 
@@ -0,0 +1,322 @@
+/*
+ * GridMapping.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/util/GridMapping.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Number of lookup cells per grid cell along each axis
+ */
+static const unsigned int LOOKUP_RESOLUTION = 4;
+
+/*
+ * Tolerance of the inside test, so points on the shared edge of two triangles
+ * are not missed due to rounding
+ */
+static const double EPSILON = 1e-9;
+
+GridMapping::GridMapping(unsigned int rows, unsigned int columns, const std::vector<Vector2D>& input, const Rectangle& inputBounds,
+	const std::vector<Vector2D>& output, const Vector2D& outputScale)
+	: rows(rows), columns(columns), inputBounds(inputBounds), pieces(), lookupColumns(0), lookupRows(0), lookupScaleX(0),
+		lookupScaleY(0), cellStarts(), cellPieces(), anchors(),
+		anchorStarts(), cellAnchors()
+{
+	if (rows == 0 || columns == 0 || input.size() != (rows + 1) * (columns + 1) || output.size() != input.size()) {
+		throw std::invalid_argument("Input and output points have to contain (rows + 1) * (columns + 1) points!");
+	}
+
+	pieces.reserve(2 * rows * columns);
+	for (unsigned int row = 0; row < rows; ++row) {
+		for (unsigned int column = 0; column < columns; ++column) {
+			unsigned int upperLeft = row * (columns + 1) + column;
+			unsigned int upperRight = upperLeft + 1;
+			unsigned int lowerLeft = upperLeft + columns + 1;
+			unsigned int lowerRight = lowerLeft + 1;
+
+			addPiece(input, output, outputScale, upperLeft, upperRight, lowerLeft);
+			addPiece(input, output, outputScale, upperRight, lowerRight, lowerLeft);
+		}
+	}
+
+	buildLookup(input);
+	buildAnchors();
+}
+
+const Rectangle& GridMapping::getInputBounds() const
+{
+	return inputBounds;
+}
+
+Vector2D GridMapping::map(const Vector2D& point) const
+{
+	unsigned int cell = findCell(point);
+
+	Vector2D result;
+	for (unsigned int i = cellStarts[cell]; i < cellStarts[cell + 1]; ++i) {
+		if (mapWithPiece(pieces[cellPieces[i]], point, result)) {
+			return result;
+		}
+	}
+
+	mapWithPiece(pieces[2 * findClosestAnchor(point, cell)], point, result);
+	return result;
+}
+
+std::size_t GridMapping::map(const Vector2D* input, Vector2D* output, std::size_t count) const
+{
+	std::size_t outside = 0;
+
+	for (std::size_t i = 0; i < count; ++i) {
+		if (!inputBounds.isPointInside(input[i])) {
+			++outside;
+		}
+
+		output[i] = map(input[i]);
+	}
+
+	return outside;
+}
+
+/*
+ * Maps the point with the affine transformation of the piece and returns
+ * whether it lies inside of the piece's input triangle. The barycentric
+ * coordinates (u, v) of the point are the columns inverseX and inverseY
+ * weighted by the offset from the input origin. With SSE2, x and y (as well as
+ * u and v) are computed together, the results are the same.
+ */
+inline bool GridMapping::mapWithPiece(const Piece& piece, const Vector2D& point, Vector2D& result)
+{
+#ifdef __SSE2__
+	__m128d offset = _mm_sub_pd(_mm_loadu_pd(&point.x), _mm_loadu_pd(&piece.inputOrigin.x));
+	__m128d coordinates = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(&piece.inverseX.x), _mm_unpacklo_pd(offset, offset)),
+		_mm_mul_pd(_mm_loadu_pd(&piece.inverseY.x), _mm_unpackhi_pd(offset, offset)));
+	__m128d u = _mm_unpacklo_pd(coordinates, coordinates);
+	__m128d v = _mm_unpackhi_pd(coordinates, coordinates);
+
+	__m128d mapped = _mm_add_pd(_mm_add_pd(_mm_loadu_pd(&piece.outputOrigin.x), _mm_mul_pd(_mm_loadu_pd(&piece.outputU.x), u)),
+		_mm_mul_pd(_mm_loadu_pd(&piece.outputV.x), v));
+	_mm_storeu_pd(&result.x, mapped);
+
+	bool positive = _mm_movemask_pd(_mm_cmpge_pd(coordinates, _mm_set1_pd(-EPSILON))) == 3;
+	return positive && (_mm_cvtsd_f64(_mm_add_sd(u, v)) <= 1 + EPSILON);
+#else
+	double dx = point.x - piece.inputOrigin.x;
+	double dy = point.y - piece.inputOrigin.y;
+	double u = piece.inverseX.x * dx + piece.inverseY.x * dy;
+	double v = piece.inverseX.y * dx + piece.inverseY.y * dy;
+
+	result.x = piece.outputOrigin.x + piece.outputU.x * u + piece.outputV.x * v;
+	result.y = piece.outputOrigin.y + piece.outputU.y * u + piece.outputV.y * v;
+
+	return (u >= -EPSILON) && (v >= -EPSILON) && (u + v <= 1 + EPSILON);
+#endif
+}
+
+void GridMapping::addPiece(const std::vector<Vector2D>& input, const std::vector<Vector2D>& output, const Vector2D& outputScale,
+	unsigned int a, unsigned int b, unsigned int c)
+{
+	Piece piece;
+
+	Vector2D inputU = input[b] - input[a];
+	Vector2D inputV = input[c] - input[a];
+	double determinant = inputU.cross(inputV);
+
+	piece.inputOrigin = input[a];
+	piece.degenerate = !(std::fabs(determinant) > std::numeric_limits<double>::epsilon());
+	if (!piece.degenerate) {
+		piece.inverseX = Vector2D(inputV.y, -inputU.y) / determinant;
+		piece.inverseY = Vector2D(-inputV.x, inputU.x) / determinant;
+	}
+
+	piece.outputOrigin = output[a].scale(outputScale.x, outputScale.y);
+	piece.outputU = (output[b] - output[a]).scale(outputScale.x, outputScale.y);
+	piece.outputV = (output[c] - output[a]).scale(outputScale.x, outputScale.y);
+
+	pieces.push_back(piece);
+}
+
+/*
+ * Lists the pieces overlapping each lookup cell (by their bounding box), in
+ * the order of the pieces.
+ */
+void GridMapping::buildLookup(const std::vector<Vector2D>& input)
+{
+	lookupColumns = columns * LOOKUP_RESOLUTION;
+	lookupRows = rows * LOOKUP_RESOLUTION;
+	lookupScaleX = (inputBounds.getWidth() > 0) ? lookupColumns / inputBounds.getWidth() : 0;
+	lookupScaleY = (inputBounds.getHeight() > 0) ? lookupRows / inputBounds.getHeight() : 0;
+
+	unsigned int cellCount = lookupColumns * lookupRows;
+	std::vector<unsigned int> cellRanges(4 * pieces.size());
+
+	cellStarts.assign(cellCount + 1, 0);
+	for (unsigned int index = 0; index < pieces.size(); ++index) {
+		if (pieces[index].degenerate) {
+			continue;
+		}
+
+		unsigned int cell = index / 2;
+		unsigned int upperLeft = (cell / columns) * (columns + 1) + cell % columns;
+		unsigned int corners[3] = { upperLeft + 1, upperLeft + columns + 1, (index % 2 == 0) ? upperLeft : upperLeft + columns + 2 };
+
+		Vector2D min = input[corners[0]];
+		Vector2D max = input[corners[0]];
+		for (unsigned int i = 1; i < 3; ++i) {
+			min.x = std::min(min.x, input[corners[i]].x);
+			min.y = std::min(min.y, input[corners[i]].y);
+			max.x = std::max(max.x, input[corners[i]].x);
+			max.y = std::max(max.y, input[corners[i]].y);
+		}
+
+		unsigned int first = findCell(min);
+		unsigned int last = findCell(max);
+		unsigned int* range = &cellRanges[4 * index];
+		range[0] = first % lookupColumns;
+		range[1] = first / lookupColumns;
+		range[2] = last % lookupColumns;
+		range[3] = last / lookupColumns;
+
+		for (unsigned int y = range[1]; y <= range[3]; ++y) {
+			for (unsigned int x = range[0]; x <= range[2]; ++x) {
+				++cellStarts[y * lookupColumns + x + 1];
+			}
+		}
+	}
+
+	for (unsigned int cell = 0; cell < cellCount; ++cell) {
+		cellStarts[cell + 1] += cellStarts[cell];
+	}
+
+	std::vector<unsigned int> cellEnds(cellStarts.begin(), cellStarts.end() - 1);
+	cellPieces.resize(cellStarts.back());
+	for (unsigned int index = 0; index < pieces.size(); ++index) {
+		if (pieces[index].degenerate) {
+			continue;
+		}
+
+		const unsigned int* range = &cellRanges[4 * index];
+		for (unsigned int y = range[1]; y <= range[3]; ++y) {
+			for (unsigned int x = range[0]; x <= range[2]; ++x) {
+				cellPieces[cellEnds[y * lookupColumns + x]++] = index;
+			}
+		}
+	}
+}
+
+/*
+ * The anchors are the upper left corners of the grid cells, i.e. all grid
+ * points except for the last row and column. For each lookup cell, only the
+ * anchors whose minimum distance to the cell does not exceed the smallest
+ * maximum distance of any anchor can be the closest one for a point inside
+ * the cell.
+ */
+void GridMapping::buildAnchors()
+{
+	anchors.clear();
+	for (unsigned int row = 0; row < rows; ++row) {
+		for (unsigned int column = 0; column < columns; ++column) {
+			anchors.push_back(pieces[2 * (row * columns + column)].inputOrigin);
+		}
+	}
+
+	double cellWidth = inputBounds.getWidth() / lookupColumns;
+	double cellHeight = inputBounds.getHeight() / lookupRows;
+
+	std::vector<double> minimumDistances(anchors.size());
+	anchorStarts.assign(1, 0);
+	cellAnchors.clear();
+
+	for (unsigned int y = 0; y < lookupRows; ++y) {
+		for (unsigned int x = 0; x < lookupColumns; ++x) {
+			Vector2D min = inputBounds.getMin() + Vector2D(x * cellWidth, y * cellHeight);
+			Vector2D max = min + Vector2D(cellWidth, cellHeight);
+
+			double bound = std::numeric_limits<double>::max();
+			for (unsigned int i = 0; i < anchors.size(); ++i) {
+				const Vector2D& anchor = anchors[i];
+
+				double nearX = std::max(0.0, std::max(min.x - anchor.x, anchor.x - max.x));
+				double nearY = std::max(0.0, std::max(min.y - anchor.y, anchor.y - max.y));
+				double farX = std::max(std::fabs(anchor.x - min.x), std::fabs(anchor.x - max.x));
+				double farY = std::max(std::fabs(anchor.y - min.y), std::fabs(anchor.y - max.y));
+
+				minimumDistances[i] = nearX * nearX + nearY * nearY;
+				bound = std::min(bound, farX * farX + farY * farY);
+			}
+
+			for (unsigned int i = 0; i < anchors.size(); ++i) {
+				if (minimumDistances[i] <= bound) {
+					cellAnchors.push_back(i);
+				}
+			}
+
+			anchorStarts.push_back(cellAnchors.size());
+		}
+	}
+}
+
+/*
+ * Points outside of the input bounds (or invalid ones) are assigned to the
+ * closest cell.
+ */
+inline unsigned int GridMapping::findCell(const Vector2D& point) const
+{
+	double x = std::floor((point.x - inputBounds.getMin().x) * lookupScaleX);
+	double y = std::floor((point.y - inputBounds.getMin().y) * lookupScaleY);
+
+	unsigned int column = (x > 0) ? (unsigned int) std::min(x, double(lookupColumns - 1)) : 0;
+	unsigned int row = (y > 0) ? (unsigned int) std::min(y, double(lookupRows - 1)) : 0;
+
+	return row * lookupColumns + column;
+}
+
+/*
+ * Returns the index of the anchor closest to the point. Points outside of the
+ * input bounds are not covered by the anchors of their cell, so all anchors
+ * have to be searched.
+ */
+unsigned int GridMapping::findClosestAnchor(const Vector2D& point, unsigned int cell) const
+{
+	bool inside = inputBounds.isPointInside(point);
+	unsigned int begin = inside ? anchorStarts[cell] : 0;
+	unsigned int end = inside ? anchorStarts[cell + 1] : anchors.size();
+
+	double closestDistance = std::numeric_limits<double>::max();
+	unsigned int closest = 0;
+
+	for (unsigned int i = begin; i < end; ++i) {
+		unsigned int anchor = inside ? cellAnchors[i] : i;
+		double distance = anchors[anchor].distanceSQ(point);
+		if (distance < closestDistance) {
+			closestDistance = distance;
+			closest = anchor;
+		}
+	}
+
+	return closest;
+}
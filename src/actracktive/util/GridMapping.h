@@ -0,0 +1,102 @@
+/*
+ * GridMapping.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GRIDMAPPING_H_
+#define GRIDMAPPING_H_
+
+#include "actracktive/util/Geometry.h"
+#include <cstddef>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+/**
+ * Maps points from a grid of (rows + 1) * (columns + 1) input points onto the
+ * corresponding output points. Each grid cell is split into two triangles and
+ * every triangle is mapped by its own affine transformation. A lookup grid
+ * over the input bounds lists the triangles overlapping each of its cells, so
+ * mapping a point only has to test a few triangles. Points outside of all
+ * triangles are extrapolated from the upper triangle of the closest grid
+ * point, which is searched among the few grid points that may be closest to
+ * any point of the lookup cell.
+ *
+ * Instances are immutable once constructed and may be shared between threads.
+ */
+class GridMapping: private boost::noncopyable
+{
+public:
+	/**
+	 * The output points are scaled by outputScale (horizontally and
+	 * vertically), which allows normalizing the output without extra cost.
+	 */
+	GridMapping(unsigned int rows, unsigned int columns, const std::vector<Vector2D>& input, const Rectangle& inputBounds,
+		const std::vector<Vector2D>& output, const Vector2D& outputScale = Vector2D(1, 1));
+
+	const Rectangle& getInputBounds() const;
+
+	Vector2D map(const Vector2D& point) const;
+
+	/**
+	 * Maps count points from input to output, which may be the same array.
+	 * Returns the number of points outside of the input bounds.
+	 */
+	std::size_t map(const Vector2D* input, Vector2D* output, std::size_t count) const;
+
+private:
+	struct Piece
+	{
+		Vector2D inputOrigin;
+		Vector2D inverseX;
+		Vector2D inverseY;
+		Vector2D outputOrigin;
+		Vector2D outputU;
+		Vector2D outputV;
+		bool degenerate;
+	};
+
+	unsigned int rows;
+	unsigned int columns;
+	Rectangle inputBounds;
+
+	std::vector<Piece> pieces;
+
+	unsigned int lookupColumns;
+	unsigned int lookupRows;
+	double lookupScaleX;
+	double lookupScaleY;
+	std::vector<unsigned int> cellStarts;
+	std::vector<unsigned int> cellPieces;
+
+	std::vector<Vector2D> anchors;
+	std::vector<unsigned int> anchorStarts;
+	std::vector<unsigned int> cellAnchors;
+
+	void addPiece(const std::vector<Vector2D>& input, const std::vector<Vector2D>& output, const Vector2D& outputScale,
+		unsigned int a, unsigned int b, unsigned int c);
+	void buildLookup(const std::vector<Vector2D>& input);
+	void buildAnchors();
+	unsigned int findCell(const Vector2D& point) const;
+	unsigned int findClosestAnchor(const Vector2D& point, unsigned int cell) const;
+
+	static bool mapWithPiece(const Piece& piece, const Vector2D& point, Vector2D& result);
+
+};
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * WorkerPool.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actracktive/util/WorkerPool.h"
+#include <algorithm>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <log4cplus/logger.h>
+
+static log4cplus::Logger logger = log4cplus::Logger::getInstance("WorkerPool");
+
+WorkerPool::Group::Group(WorkerPool& pool)
+	: pool(pool), pending(0)
+{
+}
+
+WorkerPool::Group::~Group()
+{
+	wait();
+}
+
+void WorkerPool::Group::run(const Task& task)
+{
+	boost::lock_guard<boost::mutex> lock(pool.mutex);
+
+	QueuedTask queuedTask;
+	queuedTask.task = task;
+	queuedTask.group = this;
+	queuedTask.allocations = AllocationCounter::getActive();
+
+	pool.tasks.push_back(queuedTask);
+	++pending;
+
+	pool.taskAvailable.notify_one();
+}
+
+void WorkerPool::Group::wait()
+{
+	boost::unique_lock<boost::mutex> lock(pool.mutex);
+
+	while (pending > 0) {
+		// Only tasks of this group are executed while waiting. Picking up
+		// unrelated (possibly long running) tasks would delay the return and
+		// could nest tasks waiting for resources held further up the stack.
+		std::deque<QueuedTask>::iterator task = pool.tasks.begin();
+		while (task != pool.tasks.end() && task->group != this) {
+			++task;
+		}
+
+		if (task != pool.tasks.end()) {
+			pool.execute(lock, task);
+		} else {
+			pool.taskFinished.wait(lock);
+		}
+	}
+}
+
+WorkerPool& WorkerPool::getShared()
+{
+	static WorkerPool pool(std::max(1u, boost::thread::hardware_concurrency()));
+	return pool;
+}
+
+WorkerPool::WorkerPool(unsigned int threadCount)
+	: mutex(), taskAvailable(), taskFinished(), tasks(), threads(), threadCount(threadCount), stopping(false)
+{
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		threads.create_thread(boost::bind(&WorkerPool::work, this));
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		boost::lock_guard<boost::mutex> lock(mutex);
+
+		stopping = true;
+		taskAvailable.notify_all();
+	}
+
+	threads.join_all();
+}
+
+unsigned int WorkerPool::getThreadCount() const
+{
+	return threadCount;
+}
+
+void WorkerPool::work()
+{
+	boost::unique_lock<boost::mutex> lock(mutex);
+
+	while (true) {
+		if (!tasks.empty()) {
+			execute(lock, tasks.begin());
+		} else if (stopping) {
+			break;
+		} else {
+			taskAvailable.wait(lock);
+		}
+	}
+}
+
+void WorkerPool::execute(boost::unique_lock<boost::mutex>& lock, std::deque<QueuedTask>::iterator task)
+{
+	QueuedTask queuedTask = *task;
+	tasks.erase(task);
+
+	lock.unlock();
+
+	try {
+		// Allocations are counted for the node which submitted the task
+		AllocationCounter::Scope allocationScope(queuedTask.allocations);
+
+		queuedTask.task();
+	} catch (std::exception& e) {
+		LOG4CPLUS_ERROR(logger, "Task failed: " << e.what());
+	} catch (...) {
+		LOG4CPLUS_ERROR(logger, "Task failed with unknown error!");
+	}
+
+	lock.lock();
+
+	--queuedTask.group->pending;
+	taskFinished.notify_all();
+}
@@ -0,0 +1,91 @@
+/*
+ * WorkerPool.h
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKERPOOL_H_
+#define WORKERPOOL_H_
+
+#include "actracktive/processing/AllocationCounter.h"
+#include <deque>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+/**
+ * A fixed set of threads executing tasks. Tasks are always submitted as part
+ * of a group, which allows waiting for the completion of all tasks of that
+ * group. While waiting, the waiting thread executes pending tasks of that group
+ * itself, so tasks may safely submit and wait for further tasks on the same
+ * pool. The heap allocations of a task are counted by the AllocationCounter
+ * which was active when the task was submitted.
+ */
+class WorkerPool: public boost::noncopyable
+{
+public:
+	typedef boost::function<void()> Task;
+
+	class Group: public boost::noncopyable
+	{
+	public:
+		Group(WorkerPool& pool = WorkerPool::getShared());
+		~Group();
+
+		void run(const Task& task);
+		void wait();
+
+	private:
+		friend class WorkerPool;
+
+		WorkerPool& pool;
+		unsigned int pending;
+
+	};
+
+	static WorkerPool& getShared();
+
+	WorkerPool(unsigned int threadCount);
+	~WorkerPool();
+
+	unsigned int getThreadCount() const;
+
+private:
+	struct QueuedTask
+	{
+		Task task;
+		Group* group;
+		AllocationCounter::Token allocations;
+	};
+
+	boost::mutex mutex;
+	boost::condition_variable taskAvailable;
+	boost::condition_variable taskFinished;
+	std::deque<QueuedTask> tasks;
+	boost::thread_group threads;
+	unsigned int threadCount;
+	bool stopping;
+
+	void work();
+	void execute(boost::unique_lock<boost::mutex>& lock, std::deque<QueuedTask>::iterator task);
+
+};
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * ChangeDetectorTest.cpp
+ *
+ * Copyright (C) 2012 Simon Lehmann
+ *
+ * This file is part of Actracktive.
+ *
+ * Actracktive is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Actracktive is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Standalone test of ChangeDetector, built and run outside of the
+ * application, e.g.:
+ *
+ *   g++ -iquote src test/ChangeDetectorTest.cpp \
+ *     src/actracktive/processing/nodes/sources/ChangeDetector.cpp \
+ *     src/actracktive/processing/nodes/sources/DirtyTiles.cpp \
+ *     `pkg-config --cflags --libs opencv` && ./a.out
+ */
+
+#include "actracktive/processing/nodes/sources/ChangeDetector.h"
+#include <iostream>
+
+static const int TILE_SIZE = 32;
+static const unsigned int NOISE = 8;
+static const unsigned long THRESHOLD = 0;
+
+static int failures = 0;
+
+static void check(bool condition, const char* message)
+{
+	if (!condition) {
+		std::cerr << "FAILED: " << message << std::endl;
+		++failures;
+	}
+}
+
+static void brighten(cv::Mat& image, const cv::Rect& region)
+{
+	for (int y = region.y; y < region.y + region.height; ++y) {
+		uchar* row = image.ptr<uchar>(y);
+		for (int x = region.x; x < region.x + region.width; ++x) {
+			++row[x];
+		}
+	}
+}
+
+/*
+ * The first tile brightens by a single level per frame, which stays below
+ * the noise threshold from frame to frame, but must eventually exceed it
+ * compared to the reference of the tile.
+ */
+static void testSlowRamp()
+{
+	ChangeDetector detector;
+	DirtyTiles changes;
+
+	cv::Mat image(2 * TILE_SIZE, 2 * TILE_SIZE, CV_8UC1, cv::Scalar(100));
+	detector.detect(image, TILE_SIZE, NOISE, THRESHOLD, changes);
+	check(changes.getDirtyCount() == 4, "first image is completely dirty");
+
+	int dirtyFrame = -1;
+	for (int frame = 1; frame <= 2 * int(NOISE) && dirtyFrame < 0; ++frame) {
+		brighten(image, cv::Rect(0, 0, TILE_SIZE, TILE_SIZE));
+		detector.detect(image, TILE_SIZE, NOISE, THRESHOLD, changes);
+
+		check(!changes.isDirty(1, 0) && !changes.isDirty(0, 1) && !changes.isDirty(1, 1), "unchanged tiles stay clean");
+		if (changes.isDirty(0, 0)) {
+			dirtyFrame = frame;
+		}
+	}
+
+	check(dirtyFrame == int(NOISE) + 1, "ramp dirties its tile once it exceeds the noise threshold");
+
+	// The dirty tile became the new reference
+	brighten(image, cv::Rect(0, 0, TILE_SIZE, TILE_SIZE));
+	detector.detect(image, TILE_SIZE, NOISE, THRESHOLD, changes);
+	check(changes.getDirtyCount() == 0, "reference is refreshed for dirty tiles");
+}
+
+static void testReset()
+{
+	ChangeDetector detector;
+	DirtyTiles changes;
+
+	cv::Mat image(TILE_SIZE, TILE_SIZE, CV_8UC3, cv::Scalar(50, 60, 70));
+	detector.detect(image, TILE_SIZE, NOISE, THRESHOLD, changes);
+	detector.detect(image, TILE_SIZE, NOISE, THRESHOLD, changes);
+	check(changes.getDirtyCount() == 0, "identical images are clean");
+
+	detector.reset();
+	detector.detect(image, TILE_SIZE, NOISE, THRESHOLD, changes);
+	check(changes.getDirtyCount() == 1, "images are dirty after a reset");
+}
+
+int main()
+{
+	testSlowRamp();
+	testReset();
+
+	if (failures == 0) {
+		std::cout << "ChangeDetectorTest passed" << std::endl;
+	}
+
+	return failures == 0 ? 0 : 1;
+}